@@ -0,0 +1,162 @@
+// Text map parse throughput: writes a size x size map with a floor
+// section to a temporary file, then loads it repeatedly.
+//
+// With --compare, instead edits random boxes of random maps and fails
+// unless map_update_region leaves the same occupancy, distances and free
+// cells as a full map_update.
+//
+// Usage: map_parse_bench [size] [runs]
+//        map_parse_bench --compare [maps] [edits]
+
+#include "map.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define COMPARE_MAX_SIZE 300    // Room for open areas past MAP_DISTANCE_MAX
+
+// Write a random map; returns its size in bytes, or 0 on failure
+static long write_map(FILE* file, int size) {
+    srand(1);
+    fprintf(file, "# Parse benchmark map\n%d %d\n", size, size);
+    for (int x = 0; x < size; x++) {
+        for (int y = 0; y < size; y++) {
+            bool wall = x == 0 || y == 0 || x == size - 1 || y == size - 1 || rand() % 8 == 0;
+            fprintf(file, y ? " %d" : "%d", wall ? 1 + rand() % 8 : 0);
+        }
+        fputc('\n', file);
+    }
+    fprintf(file, "floor\n");
+    for (int x = 0; x < size; x++) {
+        for (int y = 0; y < size; y++) {
+            fprintf(file, y ? " %d" : "%d", rand() % 16);
+        }
+        fputc('\n', file);
+    }
+    fprintf(file, "%.1f %.1f\n", size / 2.0f, size / 2.0f);
+    return fflush(file) == 0 ? ftell(file) : 0;
+}
+
+// Fill rows x0-x1, columns y0-y1 of both maps with the same walls, one
+// tile in density on average (0 clears the box)
+static void fill_box(Map* a, Map* b, int x0, int y0, int x1, int y1, int density) {
+    for (int x = x0; x <= x1; x++) {
+        for (int y = y0; y <= y1; y++) {
+            uint8_t tile = density > 0 && rand() % density == 0 ? (uint8_t)(1 + rand() % 8) : 0;
+            a->tiles[x * a->width + y] = tile;
+            b->tiles[x * b->width + y] = tile;
+        }
+    }
+}
+
+static bool maps_match(const Map* a, const Map* b) {
+    return memcmp(a->distance, b->distance, (size_t)a->tile_count) == 0 &&
+           memcmp(a->solid, b->solid, ((size_t)a->block_count + 1) * sizeof(uint64_t)) == 0 &&
+           a->free_cell_count == b->free_cell_count &&
+           memcmp(a->free_cells, b->free_cells, (size_t)a->free_cell_count * sizeof(uint32_t)) == 0;
+}
+
+// Edit random boxes of random maps, updating one copy with
+// map_update_region and the other with map_update; false on any difference
+static bool compare_region_updates(int maps, int edits) {
+    srand(7);
+    for (int m = 0; m < maps; m++) {
+        static Map region;
+        static Map full;
+        int width = 1 + rand() % COMPARE_MAX_SIZE;
+        int height = 1 + rand() % COMPARE_MAX_SIZE;
+        if (!map_create(&region, width, height) || !map_create(&full, width, height)) {
+            map_free(&region);
+            map_free(&full);
+            return false;
+        }
+        fill_box(&region, &full, 0, 0, height - 1, width - 1, rand() % 12);
+        map_update(&region);
+        map_update(&full);
+
+        for (int e = 0; e < edits; e++) {
+            int x0 = rand() % height;
+            int y0 = rand() % width;
+            int x1 = x0 + rand() % (height - x0 < 40 ? height - x0 : 40);
+            int y1 = y0 + rand() % (width - y0 < 40 ? width - y0 : 40);
+            fill_box(&region, &full, x0, y0, x1, y1, rand() % 6);
+            map_update_region(&region, x0, y0, x1, y1);
+            map_update(&full);
+
+            if (!maps_match(&region, &full)) {
+                fprintf(stderr, "Map %d (%dx%d), edit %d of rows %d-%d, columns %d-%d differs from map_update\n",
+                        m, width, height, e, x0, x1, y0, y1);
+                map_free(&region);
+                map_free(&full);
+                return false;
+            }
+        }
+        map_free(&region);
+        map_free(&full);
+    }
+
+    printf("Region updates: %d maps, %d edits each, identical to map_update\n", maps, edits);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--compare") == 0) {
+        int maps = argc > 2 ? atoi(argv[2]) : 400;
+        int edits = argc > 3 ? atoi(argv[3]) : 20;
+        if (maps <= 0 || edits <= 0) {
+            fprintf(stderr, "Usage: %s --compare [maps] [edits]\n", argv[0]);
+            return 1;
+        }
+        return compare_region_updates(maps, edits) ? 0 : 1;
+    }
+
+    int size = argc > 1 ? atoi(argv[1]) : 2048;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+    if (size < 1 || size > MAP_MAX_SIZE || runs <= 0) {
+        fprintf(stderr, "Usage: %s [size] [runs]\n", argv[0]);
+        return 1;
+    }
+
+    char path[] = "/tmp/map_parse_bench_XXXXXX";
+    int fd = mkstemp(path);
+    FILE* file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!file) {
+        fprintf(stderr, "Failed to create a temporary map file\n");
+        return 1;
+    }
+    long bytes = write_map(file, size);
+    fclose(file);
+    if (bytes <= 0) {
+        fprintf(stderr, "Failed to write %s\n", path);
+        remove(path);
+        return 1;
+    }
+
+    printf("Map parse benchmark: %dx%d map with floor, %.1f MB of text, %d runs\n",
+           size, size, bytes / 1e6, runs);
+
+    double best_ms = 0.0;
+    bool ok = true;
+    for (int i = 0; i < runs && ok; i++) {
+        static Map map;
+        Uint64 start = SDL_GetPerformanceCounter();
+        ok = map_load(&map, path);
+        double ms = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        map_free(&map);
+        if (i == 0 || ms < best_ms) {
+            best_ms = ms;
+        }
+    }
+    remove(path);
+
+    if (!ok) {
+        return 1;
+    }
+    double tiles = 2.0 * size * size;
+    printf("  Best load:  %9.3f ms (parsing plus occupancy and distance build)\n", best_ms);
+    printf("  Throughput: %9.1f MB/s, %.1f Mtiles/s\n", bytes / 1e3 / best_ms, tiles / 1e3 / best_ms);
+    return 0;
+}
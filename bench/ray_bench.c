@@ -0,0 +1,135 @@
+// Headless ray casting benchmark on a large open arena: plain DDA, one
+// tile per step, against DDA that jumps through open space using the
+// map's distance field. Both runs must find the same walls.
+//
+// Usage: ray_bench [size] [rays] [frames]
+
+#include "map.h"
+#include "ray.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define PILLAR_SPACING 32    // Tiles between the 2x2 pillars of the arena
+#define CLUTTER_PERCENT 0.2  // Share of the floor covered by random blocks
+
+// Square arena: border walls, a grid of pillars and some scattered blocks
+static bool build_arena(Map* map, int size) {
+    if (!map_create(map, size, size)) {
+        return false;
+    }
+
+    srand(1);
+    for (int x = 0; x < size; x++) {
+        for (int y = 0; y < size; y++) {
+            bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+            bool pillar = x % PILLAR_SPACING < 2 && y % PILLAR_SPACING < 2 && x > 1 && y > 1;
+            bool clutter = rand() % 1000 < (int)(CLUTTER_PERCENT * 10);
+            if (border || pillar || clutter) {
+                map->tiles[x * size + y] = (uint8_t)(1 + (x + y) % 4);
+            }
+        }
+    }
+    map_update(map);
+    return true;
+}
+
+// Cast a screen's worth of rays from random open tiles, packets first like
+// the renderer; returns ms per frame and a checksum of every hit
+static double bench_cast(const Map* map, int rays, int frames, unsigned long long* checksum, long long* tiles_walked) {
+    RayHit hits[RAY_PACKET_WIDTH];
+    float ray_dir_x[RAY_PACKET_WIDTH];
+    float ray_dir_y[RAY_PACKET_WIDTH];
+    unsigned long long sum = 0;
+    long long walked = 0;
+
+    srand(2);
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int f = 0; f < frames; f++) {
+        float pos_x, pos_y;
+        do {
+            pos_x = 1.0f + (float)rand() / RAND_MAX * (map->height - 2);
+            pos_y = 1.0f + (float)rand() / RAND_MAX * (map->width - 2);
+        } while (map_solid(map, (int)pos_x, (int)pos_y));
+
+        float angle = 2.0f * (float)M_PI * rand() / RAND_MAX;
+        float dir_x = cosf(angle);
+        float dir_y = sinf(angle);
+        float plane_x = -0.66f * dir_y;
+        float plane_y = 0.66f * dir_x;
+
+        for (int x = 0; x < rays; x += RAY_PACKET_WIDTH) {
+            int count = rays - x < RAY_PACKET_WIDTH ? rays - x : RAY_PACKET_WIDTH;
+            for (int i = 0; i < count; i++) {
+                float camera_x = 2.0f * (x + i) / rays - 1.0f;
+                ray_dir_x[i] = dir_x + plane_x * camera_x;
+                ray_dir_y[i] = dir_y + plane_y * camera_x;
+            }
+            if (count == RAY_PACKET_WIDTH) {
+                ray_cast_packet(map, pos_x, pos_y, ray_dir_x, ray_dir_y, hits);
+            } else {
+                for (int i = 0; i < count; i++) {
+                    ray_cast(map, pos_x, pos_y, ray_dir_x[i], ray_dir_y[i], &hits[i]);
+                }
+            }
+            for (int i = 0; i < count; i++) {
+                sum = sum * 31 + (unsigned)(hits[i].map_x * 65599 + hits[i].map_y * 2 + hits[i].side);
+                walked += abs(hits[i].map_x - (int)pos_x) + abs(hits[i].map_y - (int)pos_y);
+            }
+        }
+    }
+
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+    *checksum = sum;
+    *tiles_walked = walked;
+    return 1000.0 * elapsed / SDL_GetPerformanceFrequency() / frames;
+}
+
+int main(int argc, char* argv[]) {
+    int size = argc > 1 ? atoi(argv[1]) : 512;
+    int rays = argc > 2 ? atoi(argv[2]) : 1920;
+    int frames = argc > 3 ? atoi(argv[3]) : 200;
+
+    if (size < 3 || rays <= 0 || frames <= 0) {
+        fprintf(stderr, "Usage: %s [size] [rays] [frames]\n", argv[0]);
+        return 1;
+    }
+
+    static Map map;
+    if (!build_arena(&map, size)) {
+        map_free(&map);
+        return 1;
+    }
+
+    printf("Ray benchmark: %dx%d arena, %d rays x %d frames, %d-wide packets\n",
+           size, size, rays, frames, RAY_PACKET_WIDTH);
+
+    unsigned long long plain_sum, skip_sum;
+    long long walked;
+
+    ray_empty_skipping = false;
+    double plain_ms = bench_cast(&map, rays, frames, &plain_sum, &walked);
+    ray_empty_skipping = true;
+    double skip_ms = bench_cast(&map, rays, frames, &skip_sum, &walked);
+
+    double mrays = (double)rays / 1000.0;
+    printf("  Average ray length:     %7.1f tiles\n", (double)walked / ((double)rays * frames));
+    printf("  Plain DDA:              %7.3f ms/frame (%6.1f Mrays/s)\n", plain_ms, mrays / plain_ms);
+    printf("  Distance field skips:   %7.3f ms/frame (%6.1f Mrays/s), %.1fx faster\n",
+           skip_ms, mrays / skip_ms, plain_ms / skip_ms);
+
+    map_free(&map);
+
+    if (plain_sum != skip_sum) {
+        fprintf(stderr, "Hits differ between plain and skipping DDA\n");
+        return 1;
+    }
+    printf("  Hits identical\n");
+    return 0;
+}
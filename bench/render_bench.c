@@ -0,0 +1,365 @@
+// Headless render benchmark: frame time with and without the textured
+// floor/ceiling pass, with and without mipmaps, and with coarse or
+// brute-force column casting, standing still and turning with the wall
+// hit cache, with interlaced wall columns turning and aiming slowly, and
+// with thousands of billboards drawn front to back and back to front.
+//
+// With --compare, renders frames random poses with brute-force casting
+// on one thread and again with each optimization on, and fails unless
+// every frame is identical.
+//
+// Usage: render_bench [--compare] [map_file] [width height] [frames] [sprites]
+
+#include "engine.h"
+#include "player.h"
+#include "raycaster.h"
+#include "texture.h"
+#include "map.h"
+#include "render_pool.h"
+#include "ray.h"
+#include "sprite.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define BENCH_WARMUP_FRAMES 10
+#define BENCH_SPRITES 10000
+#define BENCH_CIRCLE (2.0f * (float)M_PI)
+#define BENCH_SLOW_AIM 0.0005f  // Radians per frame, under the interlaced fallback
+#define BENCH_AIM_HEADINGS 8
+
+// Optimized settings that must render exactly what brute force does
+typedef struct {
+    const char* name;
+    bool ray_packets;
+    bool coarse_casting;
+    bool textured_floors;
+    bool column_major;
+    bool hit_cache;
+    bool interlaced;
+    float turn;                 // Hit cache: radians turned in place before the pose
+} CompareMode;
+
+static const CompareMode compare_modes[] = {
+    { "ray packets",           true, false, true,  false, false, false, 0.0f },
+    { "coarse casting",        true, true,  true,  false, false, false, 0.0f },
+    { "column-major",          true, true,  false, true,  false, false, 0.0f },
+    { "hit cache, still",      true, true,  true,  false, true,  false, 0.0f },
+    { "hit cache, turning",    true, true,  true,  false, true,  false, 0.02f },
+    { "interlaced, still",     true, true,  true,  false, false, true,  0.0f },
+    { "interlaced, flat",      true, true,  false, true,  false, true,  0.0f },
+};
+
+// Turn the player in place by angle radians
+static void turn_player(Player* player, float angle) {
+    float c = cosf(angle);
+    float s = sinf(angle);
+    float dir_x = player->dir_x;
+    float plane_x = player->plane_x;
+    player->dir_x = dir_x * c - player->dir_y * s;
+    player->dir_y = dir_x * s + player->dir_y * c;
+    player->plane_x = plane_x * c - player->plane_y * s;
+    player->plane_y = plane_x * s + player->plane_y * c;
+}
+
+// Render frames while turning turn radians in place (a full circle is
+// 2 pi); returns ms per frame. With sprites, the player also circles a
+// little so their depths change.
+static double bench_render(Engine* engine, Player* player, const Map* map, TextureManager* tm, SpriteManager* sm,
+                           int frames, float turn) {
+    float spawn_x = player->x;
+    float spawn_y = player->y;
+    float spawn_dir_x = player->dir_x;
+    float spawn_dir_y = player->dir_y;
+    float spawn_plane_x = player->plane_x;
+    float spawn_plane_y = player->plane_y;
+    Uint64 start = 0;
+
+    for (int i = -BENCH_WARMUP_FRAMES; i < frames; i++) {
+        if (i == 0) {
+            start = SDL_GetPerformanceCounter();
+        }
+
+        float angle = turn * (i < 0 ? 0 : i) / frames;
+        float c = cosf(angle);
+        float s = sinf(angle);
+        player->dir_x = spawn_dir_x * c - spawn_dir_y * s;
+        player->dir_y = spawn_dir_x * s + spawn_dir_y * c;
+        player->plane_x = spawn_plane_x * c - spawn_plane_y * s;
+        player->plane_y = spawn_plane_x * s + spawn_plane_y * c;
+        if (sm) {
+            player->x = spawn_x + 0.3f * c;
+            player->y = spawn_y + 0.3f * s;
+        }
+
+        raycaster_render(engine, player, map, tm, sm, NULL, NULL);
+    }
+
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+    player->x = spawn_x;
+    player->y = spawn_y;
+    player->dir_x = spawn_dir_x;
+    player->dir_y = spawn_dir_y;
+    player->plane_x = spawn_plane_x;
+    player->plane_y = spawn_plane_y;
+
+    return 1000.0 * elapsed / SDL_GetPerformanceFrequency() / frames;
+}
+
+// Place the player on a random free tile facing a random direction
+static void random_pose(const Map* map, Player* player) {
+    float x, y;
+    if (map_random_free_cell(map, &x, &y)) {
+        player->x = x;
+        player->y = y;
+    }
+    float angle = 2.0f * (float)M_PI * rand() / RAND_MAX;
+    player->dir_x = cosf(angle);
+    player->dir_y = sinf(angle);
+    player->plane_x = -0.66f * player->dir_y;
+    player->plane_y = 0.66f * player->dir_x;
+}
+
+// Render each pose with brute-force casting on one thread, then with each
+// compare mode on the configured threads; returns false on any difference.
+// Hit cache modes first render the pose turned back by the mode's angle,
+// then the pose three times: reprojected or copied hits, then the frame
+// saved while standing still, then that frame reused. Interlaced modes
+// also render the pose once first, since that frame still shows half the
+// columns from the previous pose.
+static bool compare_render(Engine* engine, Player* player, const Map* map, TextureManager* tm, int poses) {
+    size_t size = (size_t)engine->view_width * engine->view_height;
+    uint32_t* reference = (uint32_t*)malloc(size * sizeof(uint32_t));
+    if (!reference) {
+        fprintf(stderr, "Failed to allocate the reference frame\n");
+        return false;
+    }
+
+    int threads = engine->render_threads;
+    int mode_count = (int)(sizeof(compare_modes) / sizeof(compare_modes[0]));
+    bool identical = true;
+
+    for (int m = 0; m < mode_count; m++) {
+        const CompareMode* mode = &compare_modes[m];
+        int differing = 0;
+
+        srand(3);
+        for (int i = 0; i < poses; i++) {
+            random_pose(map, player);
+
+            engine->render_threads = 1;
+            engine->ray_packets = false;
+            engine->coarse_casting = false;
+            engine->textured_floors = mode->textured_floors;
+            engine->column_major = false;
+            engine->hit_cache = false;
+            engine->interlaced = false;
+            raycaster_render(engine, player, map, tm, NULL, NULL, NULL);
+            memcpy(reference, engine->view_pixels, size * sizeof(uint32_t));
+
+            engine->render_threads = threads;
+            engine->ray_packets = mode->ray_packets && RAY_PACKET_WIDTH > 1;
+            engine->coarse_casting = mode->coarse_casting;
+            engine->column_major = mode->column_major;
+            engine->hit_cache = mode->hit_cache;
+            engine->interlaced = mode->interlaced;
+            if (mode->hit_cache || mode->interlaced) {
+                Player pose = *player;
+                turn_player(player, -mode->turn);
+                raycaster_render(engine, player, map, tm, NULL, NULL, NULL);
+                *player = pose;
+            }
+
+            bool same = true;
+            for (int repeat = 0; repeat < (mode->hit_cache || mode->interlaced ? 3 : 1); repeat++) {
+                // Nothing may survive from the previous frame in the framebuffer
+                memset(engine->view_pixels, 0xA5, size * sizeof(uint32_t));
+                raycaster_render(engine, player, map, tm, NULL, NULL, NULL);
+                same = same && memcmp(reference, engine->view_pixels, size * sizeof(uint32_t)) == 0;
+            }
+            if (!same && differing++ == 0) {
+                fprintf(stderr, "%s: pose %d at (%.3f, %.3f) differs from brute force\n",
+                        mode->name, i, player->x, player->y);
+            }
+        }
+
+        if (differing > 0) {
+            fprintf(stderr, "%s: %d of %d frames differ\n", mode->name, differing, poses);
+            identical = false;
+        } else {
+            printf("  %-22s %d poses identical\n", mode->name, poses);
+        }
+    }
+
+    engine->render_threads = threads;
+    engine->hit_cache = false;
+    engine->interlaced = false;
+    free(reference);
+    return identical;
+}
+
+int main(int argc, char* argv[]) {
+    bool compare = argc > 1 && strcmp(argv[1], "--compare") == 0;
+    if (compare) {
+        argv++;
+        argc--;
+    }
+
+    const char* map_file = argc > 1 ? argv[1] : "data/maps/test.map";
+    int width = argc > 3 ? atoi(argv[2]) : DEFAULT_SCREEN_WIDTH;
+    int height = argc > 3 ? atoi(argv[3]) : DEFAULT_SCREEN_HEIGHT;
+    int frames = argc > 4 ? atoi(argv[4]) : 500;
+    int sprites = argc > 5 ? atoi(argv[5]) : BENCH_SPRITES;
+
+    if (width <= 0 || height <= 0 || frames <= 0 || sprites < 0 || sprites > MAX_SPRITES) {
+        fprintf(stderr, "Usage: %s [--compare] [map_file] [width height] [frames] [sprites]\n", argv[0]);
+        return 1;
+    }
+
+    static Engine engine;
+    static Player player;
+    static TextureManager tm;
+    static SpriteManager sm;
+    static Map map;
+
+    if (!texture_manager_init(&tm)) {
+        return 1;
+    }
+    if (!map_load(&map, map_file)) {
+        map_free(&map);
+        texture_manager_cleanup(&tm);
+        return 1;
+    }
+
+    engine.screen_width = width;
+    engine.screen_height = height;
+    engine.pixels = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+    if (!engine.pixels) {
+        fprintf(stderr, "Failed to allocate %dx%d framebuffer\n", width, height);
+        map_free(&map);
+        texture_manager_cleanup(&tm);
+        return 1;
+    }
+    engine.view_pixels = engine.pixels;
+    engine.view_width = width;
+    engine.view_height = height;
+    engine.render_threads = render_pool_default_threads();
+    engine.ray_packets = RAY_PACKET_WIDTH > 1;
+    engine.column_major = false;
+    engine.mipmaps = true;
+    engine.coarse_casting = true;
+    engine.hit_cache = false;
+
+    player_init(&player, map.player_spawn_x, map.player_spawn_y);
+
+    if (compare) {
+        printf("Render comparison: %dx%d, %d poses, %d threads\n", width, height, frames, engine.render_threads);
+        bool identical = compare_render(&engine, &player, &map, &tm, frames);
+        raycaster_cleanup();
+        free(engine.pixels);
+        map_free(&map);
+        texture_manager_cleanup(&tm);
+        return identical ? 0 : 1;
+    }
+
+    printf("Render benchmark: %dx%d, %d frames, %d threads\n",
+           width, height, frames, engine.render_threads);
+
+    engine.textured_floors = false;
+    double flat_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, BENCH_CIRCLE);
+    long long flat_pixels = engine.stats.wall_pixels + engine.stats.floor_pixels;
+
+    engine.textured_floors = true;
+    double textured_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, BENCH_CIRCLE);
+    long long floor_pixels = engine.stats.floor_pixels;
+
+    printf("  Flat floor/ceiling:     %7.3f ms/frame (%6.1f fps), %lld pixels\n",
+           flat_ms, 1000.0 / flat_ms, flat_pixels);
+    printf("  Textured floor/ceiling: %7.3f ms/frame (%6.1f fps), %lld from the floor pass\n",
+           textured_ms, 1000.0 / textured_ms, floor_pixels);
+    printf("  Floor pass cost:        %7.3f ms/frame\n", textured_ms - flat_ms);
+
+    engine.mipmaps = false;
+    double no_mip_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, BENCH_CIRCLE);
+    printf("  Textured, no mipmaps:   %7.3f ms/frame (%6.1f fps)\n", no_mip_ms, 1000.0 / no_mip_ms);
+
+    // Coarse casting was on for the runs above
+    long long saved = engine.stats.rays_saved;
+    engine.mipmaps = true;
+    engine.coarse_casting = false;
+    double brute_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, BENCH_CIRCLE);
+    printf("  Brute-force casting:    %7.3f ms/frame (%6.1f fps), coarse saves %lld of %d traversals\n",
+           brute_ms, 1000.0 / brute_ms, saved, width);
+
+    // Standing still: the first frame is rendered and kept, the rest copy it
+    engine.coarse_casting = true;
+    double standing_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, 0.0f);
+    engine.hit_cache = true;
+    double still_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, 0.0f);
+    printf("  Standing, no hit cache: %7.3f ms/frame (%6.1f fps)\n", standing_ms, 1000.0 / standing_ms);
+    printf("  Standing with hit cache:%7.3f ms/frame (%6.1f fps)\n", still_ms, 1000.0 / still_ms);
+
+    // Each frame turns a little from the same spot, like aiming
+    double cached_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, BENCH_CIRCLE);
+    printf("  Turning with hit cache: %7.3f ms/frame (%6.1f fps), %lld of %d columns reused\n",
+           cached_ms, 1000.0 / cached_ms, engine.stats.rays_reused, width);
+
+    engine.interlaced = true;
+    double interlaced_ms = bench_render(&engine, &player, &map, &tm, NULL, frames, BENCH_CIRCLE);
+    printf("  Interlaced walls:       %7.3f ms/frame (%6.1f fps), %lld of %d columns cast\n",
+           interlaced_ms, 1000.0 / interlaced_ms, engine.stats.interlaced_columns, width);
+
+    // Aiming slowly, where last frame's columns can stand in for this
+    // one's, from eight headings around the spawn
+    engine.hit_cache = false;
+    Player spawn = player;
+    double aim_ms = 0.0;
+    double aim_interlaced_ms = 0.0;
+    for (int i = 0; i < BENCH_AIM_HEADINGS; i++) {
+        int aim_frames = frames / BENCH_AIM_HEADINGS > 0 ? frames / BENCH_AIM_HEADINGS : 1;
+        engine.interlaced = false;
+        aim_ms += bench_render(&engine, &player, &map, &tm, NULL, aim_frames, BENCH_SLOW_AIM * aim_frames);
+        engine.interlaced = true;
+        aim_interlaced_ms += bench_render(&engine, &player, &map, &tm, NULL, aim_frames, BENCH_SLOW_AIM * aim_frames);
+        turn_player(&player, BENCH_CIRCLE / BENCH_AIM_HEADINGS);
+    }
+    player = spawn;
+    aim_ms /= BENCH_AIM_HEADINGS;
+    aim_interlaced_ms /= BENCH_AIM_HEADINGS;
+    printf("  Slow aim:               %7.3f ms/frame (%6.1f fps)\n", aim_ms, 1000.0 / aim_ms);
+    printf("  Slow aim, interlaced:   %7.3f ms/frame (%6.1f fps), %lld of %d columns cast\n",
+           aim_interlaced_ms, 1000.0 / aim_interlaced_ms, engine.stats.interlaced_columns, width);
+
+    // Billboards scattered over the empty tiles, from the same seed each run
+    if (sprite_manager_init(&sm)) {
+        srand(1);
+        for (int i = 0; i < sprites; i++) {
+            float x, y;
+            if (map_random_free_cell(&map, &x, &y)) {
+                sprite_add(&sm, x + (rand() % 81 - 40) * 0.01f, y + (rand() % 81 - 40) * 0.01f, i % sm.texture_count);
+            }
+        }
+        // Nearest first with coverage masks, as the game starts, then
+        // painter's order
+        engine.interlaced = false;
+        for (int order = 0; order < 2; order++) {
+            engine.sprites_front_to_back = order == 0;
+            double sprite_ms = bench_render(&engine, &player, &map, &tm, &sm, frames, BENCH_CIRCLE);
+            printf("  %5d sprites, %s: %7.3f ms/frame (%6.1f fps), %lld listed, %lld radix sorts\n",
+                   sm.count, engine.sprites_front_to_back ? "front to back" : "back to front",
+                   sprite_ms, 1000.0 / sprite_ms, engine.stats.sprites_listed, engine.stats.sprite_radix_sorts);
+        }
+    }
+    sprite_manager_cleanup(&sm);
+
+    raycaster_cleanup();
+    free(engine.pixels);
+    map_free(&map);
+    texture_manager_cleanup(&tm);
+    return 0;
+}
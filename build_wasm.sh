@@ -35,10 +35,16 @@ emcc -O3 \
     ../src/player/player.c \
     ../src/input/input.c \
     ../src/renderer/raycaster.c \
+    ../src/renderer/render_pool.c \
+    ../src/renderer/ray.c \
+    ../src/renderer/render_target.c \
+    ../src/renderer/floor_caster.c \
     ../src/renderer/sprite_renderer.c \
+    ../src/renderer/render_list.c \
     ../src/renderer/minimap.c \
     ../src/renderer/hud.c \
     ../src/assets/texture.c \
+    ../src/assets/palette.c \
     ../src/assets/sprite.c \
     ../src/assets/image_loader.c \
     ../src/entities/enemy.c \
@@ -48,6 +54,9 @@ emcc -O3 \
     ../src/systems/pickup.c \
     ../src/map/map.c \
     ../src/map/map_loader.c \
+    ../src/map/map_binary.c \
+    ../src/map/map_stream.c \
+    ../src/map/map_watch.c \
     -o raycaster.html
 
 echo "Build complete! Output files in build-wasm/"
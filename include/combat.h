@@ -15,9 +15,9 @@ typedef struct {
 } ShotResult;
 
 // Fire a raycast shot and check for enemy hits
-ShotResult combat_fire_shot(Player* player, EnemyManager* em, float angle_offset);
+ShotResult combat_fire_shot(Player* player, const Map* map, EnemyManager* em, float angle_offset);
 
 // Fire weapon and handle all combat logic
-void combat_player_shoot(Player* player, EnemyManager* em, SoundManager* sm, PickupManager* pm);
+void combat_player_shoot(Player* player, const Map* map, EnemyManager* em, SoundManager* sm, PickupManager* pm);
 
 #endif
@@ -8,8 +8,9 @@
 #include "engine.h"
 #include "sound.h"
 #include "pickup.h"
+#include "render_list.h"
 
-#define MAX_ENEMIES 32
+#define MAX_ENEMIES 1024
 #define MAX_ENEMY_TEXTURES 8
 
 typedef enum {
@@ -29,8 +30,10 @@ typedef enum {
 typedef struct {
     float x;                    // Position X
     float y;                    // Position Y
-    float spawn_x;              // Original spawn position X
-    float spawn_y;              // Original spawn position Y
+    float spawn_x;              // Respawn position X (moved out of walls on map edits)
+    float spawn_y;              // Respawn position Y
+    float decl_x;               // Position declared in the map, for enemy_remove_bulk
+    float decl_y;
     float dir_x;                // Direction X (normalized)
     float dir_y;                // Direction Y (normalized)
     float speed;                // Movement speed
@@ -56,14 +59,27 @@ typedef struct {
     float animation_speed;      // Frames per second
     float respawn_time;         // Time in seconds before enemies respawn
     bool respawn_enabled;       // Should enemies respawn
+    RenderList render_list;     // Active enemies in draw order
 } EnemyManager;
 
 // Enemy manager functions
 bool enemy_manager_init(EnemyManager* em);
 void enemy_manager_cleanup(EnemyManager* em);
-void enemy_manager_update(EnemyManager* em, Player* player, SoundManager* sm, PickupManager* pm, float delta_time);
+void enemy_manager_update(EnemyManager* em, const Map* map, Player* player, SoundManager* sm, PickupManager* pm, float delta_time);
 bool enemy_add(EnemyManager* em, float x, float y, EnemyType type);
 
+// Add map-declared enemies in one pass over the free slots; other kinds of
+// entity and unknown types are skipped. Returns the number added.
+int enemy_add_bulk(EnemyManager* em, const MapEntity* entities, int count);
+
+// Remove the enemies spawned by these declarations, alive or dead
+void enemy_remove_bulk(EnemyManager* em, const MapEntity* entities, int count);
+
+// After the map changes, move enemies and their spawn points out of walls
+// to the nearest empty tile; enemies with none nearby are removed. The
+// declared position stays, so a later enemy_remove_bulk still finds them.
+void enemy_manager_revalidate(EnemyManager* em, const Map* map);
+
 // Load enemy textures from directory
 bool enemy_load_textures(EnemyManager* em, const char* sprite_dir);
 
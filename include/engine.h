@@ -4,19 +4,53 @@
 #include <SDL2/SDL.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "palette.h"
 
 // Default screen dimensions
 #define DEFAULT_SCREEN_WIDTH 640
 #define DEFAULT_SCREEN_HEIGHT 480
 
+// Dynamic resolution limits
+#define DEFAULT_TARGET_FRAME_MS 16.6f   // 60 fps
+#define RENDER_SCALE_MIN 0.25f          // Smallest view size per axis, as a fraction of the window
+#define ENGINE_MAX_OVERLAYS 8           // Native-resolution HUD rectangles per frame
+
+// Per-frame render counters (printed with F1)
+typedef struct {
+    long long wall_pixels;      // Pixels written by the wall pass (ceiling, walls, floor)
+    long long floor_pixels;     // Pixels written by the textured floor/ceiling pass
+    long long rays_saved;       // Columns resolved from neighbouring hits instead of a full DDA
+    long long rays_reused;      // Columns taken from the previous frame's hits
+    long long interlaced_columns;   // Columns not drawn this frame in interlaced mode
+    long long sprites_listed;   // Billboards in the managers' render lists
+    long long sprite_radix_sorts;   // Render lists too far out of order for the insertion sort alone
+    long long sprites_occluded; // Sprites the depth pyramid found hidden behind walls or nearer sprites
+    long long sprite_pixels;    // Pixels written by the sprite pass
+} RenderStats;
+
 // Engine state structure
 typedef struct {
     SDL_Window* window;
     SDL_Renderer* renderer;
     SDL_Texture* texture;
     uint32_t* pixels;
+    uint8_t* indexed;           // 8-bit framebuffer used in palette mode
     int screen_width;
     int screen_height;
+
+    // 3D view, drawn at view_width x view_height and stretched to the window
+    // by SDL. At full scale these alias pixels/indexed; when scaled down they
+    // point into scaled_pixels/scaled_indexed and the HUD and minimap are
+    // presented on top from the native-resolution pixels as overlays.
+    uint32_t* view_pixels;
+    uint8_t* view_indexed;
+    int view_width;
+    int view_height;
+    uint32_t* scaled_pixels;
+    uint8_t* scaled_indexed;
+    SDL_Texture* view_texture;
+    SDL_Rect overlays[ENGINE_MAX_OVERLAYS];
+    int overlay_count;
     bool running;
     uint32_t last_time;
     float delta_time;
@@ -32,9 +66,29 @@ typedef struct {
     int shake_offset_x;         // Screen shake offset X
     int shake_offset_y;         // Screen shake offset Y
 
+    // Render settings
+    int render_threads;         // Worker threads for the wall pass (1 = serial)
+    bool ray_packets;           // Trace adjacent columns together with SIMD
+    bool column_major;          // Draw the 3D view transposed, then transpose to pixels (flat floors only)
+    bool textured_floors;       // Texture floor and ceiling from the map (flat colors otherwise)
+    bool palette_mode;          // Render 8-bit palette indices, expand to ARGB when presenting
+    bool mipmaps;               // Sample distant walls and sprites from smaller mip levels
+    bool coarse_casting;        // Full DDA on every few columns, the rest from neighbouring hits
+    bool hit_cache;             // Reuse last frame's wall hits, or its whole view, while the player stands still
+    bool interlaced;            // Draw odd and even wall columns on alternate frames
+    bool sprites_front_to_back; // Draw sprites nearest first, writing each pixel at most once
+    bool dynamic_resolution;    // Scale the 3D view to keep frames within target_frame_ms
+    float target_frame_ms;      // CPU time budget per frame
+    float render_scale_x;       // View width / screen width
+    float render_scale_y;       // View height / screen height
+    float frame_ms;             // Smoothed CPU time per frame (present excluded)
+    Uint64 frame_start;         // Performance counter at the start of the frame
+    RenderStats stats;          // Counters from the last rendered frame
+
     // Game state
     bool game_over;             // Is game over
     bool restart_requested;     // Player pressed R to restart
+    bool stats_requested;       // Player pressed F1; the game prints its own counters
 } Engine;
 
 // Engine functions
@@ -44,6 +98,33 @@ void engine_handle_events(Engine* engine);
 void engine_update(Engine* engine);
 void engine_render(Engine* engine);
 void engine_render_low_health_warning(Engine* engine, int player_health, int max_health);
+void engine_print_render_stats(Engine* engine);
+
+// True when the 3D view is rendered below screen resolution
+static inline bool engine_view_scaled(const Engine* engine) {
+    return engine->view_pixels != engine->pixels;
+}
+
+// Mark a screen rectangle as HUD for this frame. When the view is scaled the
+// rectangle is cleared to transparent and presented at native resolution
+// over the stretched view; pixels drawn outside every overlay are not shown.
+void engine_add_overlay(Engine* engine, int x, int y, int width, int height);
+
+// Write one 2D overlay pixel (quantized to the palette in palette mode)
+static inline void engine_put_pixel(Engine* engine, int index, uint32_t color) {
+    if (engine_view_scaled(engine)) {
+        // Overlay texels are ARGB with opaque alpha, blended over the view
+        if (engine->palette_mode) {
+            const Palette* palette = palette_get();
+            color = palette->colors[palette_quantize(palette, color)];
+        }
+        engine->pixels[index] = 0xFF000000 | color;
+    } else if (engine->palette_mode) {
+        engine->indexed[index] = palette_quantize(palette_get(), color);
+    } else {
+        engine->pixels[index] = color;
+    }
+}
 
 // Visual effect triggers
 void engine_trigger_muzzle_flash(Engine* engine);
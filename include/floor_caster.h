@@ -0,0 +1,45 @@
+#ifndef FLOOR_CASTER_H
+#define FLOOR_CASTER_H
+
+#include <stdint.h>
+#include "player.h"
+#include "map.h"
+#include "texture.h"
+#include "render_target.h"
+
+// Number of adjacent floor pixels shaded together by floor_cast_rows
+#if defined(__AVX2__)
+#define FLOOR_LANES 8
+#elif defined(__SSE2__)
+#define FLOOR_LANES 4
+#else
+#define FLOOR_LANES 1
+#endif
+
+// Inputs for one floor/ceiling pass. The wall pass leaves rows
+// [wall_top[x], wall_bottom[x]) of column x covered; rows above are
+// ceiling and rows below are floor.
+typedef struct {
+    RenderTarget* target;
+    const Player* player;
+    const Map* map;
+    const TextureManager* tm;
+    const int* wall_top;
+    const int* wall_bottom;
+    uint32_t ceiling_color;     // Used where the map's ceiling grid has no texture
+    uint32_t floor_color;       // Used where the map's floor grid has no texture
+} FloorPass;
+
+// Draw the floor and ceiling pixels of rows [start, end) that walls do not
+// cover. Each row has a single distance and its texture coordinates step
+// linearly across the screen, so FLOOR_LANES pixels are shaded at once.
+// Returns pixels written.
+long long floor_cast_rows(const FloorPass* pass, int start, int end);
+
+// Fill the same pixels with the flat ceiling and floor colors, one run of
+// adjacent pixels at a time, for row-major targets where filling below
+// and above each wall column would step a whole row per pixel. Returns
+// pixels written.
+long long floor_fill_rows(const FloorPass* pass, int start, int end);
+
+#endif
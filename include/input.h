@@ -12,7 +12,7 @@ typedef struct {
     int weapon_switch;       // Weapon number (1-4) or -1 for no switch
 } InputState;
 
-void input_handle(Player* player, float delta_time, InputState* input_state, SoundManager* sm);
+void input_handle(Player* player, const Map* map, float delta_time, InputState* input_state, SoundManager* sm);
 void input_handle_mouse(Player* player, Engine* engine);
 
 #endif
@@ -2,23 +2,224 @@
 #define MAP_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-#define MAP_WIDTH 24
-#define MAP_HEIGHT 24
+// Largest width or height map_create accepts; keeps tile indices in an int
+#define MAP_MAX_SIZE 16384
+
+// Occupancy is kept in 8x8 tile blocks, one 64-bit word per block
+#define MAP_BLOCK_SHIFT 3
+
+// Distances stop counting here; a ray skips at most this many tiles at once
+#define MAP_DISTANCE_MAX 255
+
+// Streamed maps are paged in and out in square chunks of this many tiles
+#define MAP_CHUNK_SHIFT 6
+#define MAP_CHUNK_SIZE (1 << MAP_CHUNK_SHIFT)
+
+// Random spawns pick from an evenly spaced sample of at most this many
+// empty tiles, so huge maps don't need a list entry per tile
+#define MAP_FREE_CELL_SAMPLE 65536
+
+// Entities a map declares, one line each after the tile grid
+typedef enum {
+    MAP_ENTITY_SPRITE,      // "sprite x y texture"
+    MAP_ENTITY_ENEMY,       // "enemy x y type" (EnemyType)
+    MAP_ENTITY_PICKUP,      // "pickup x y type" (PickupType)
+    MAP_ENTITY_KINDS
+} MapEntityKind;
 
 typedef struct {
-    int width;
-    int height;
-    int data[MAP_WIDTH][MAP_HEIGHT];
+    float x;
+    float y;
+    uint16_t kind;          // MapEntityKind
+    uint16_t type;          // Sprite texture, EnemyType or PickupType
+} MapEntity;
+
+// Tile grids are stored row by row as in the map file. World x runs down
+// the rows and world y along them, so tile (x, y) is at x * width + y for
+// x < height and y < width. Every grid has one extra entry past the end
+// that the accessors read for tiles outside the map, so a bounds-safe
+// lookup is a compare, a select and a single load.
+//
+// Streamed maps (see map_stream.h) keep only a window of chunks around the
+// player: their grids are a square of chunk slots that world coordinates
+// wrap around, (x & mask_x) * stride + (y & mask_y). For every other map
+// the masks are all ones and stride is width.
+typedef struct {
+    int width;              // Tiles per row (world y extent)
+    int height;             // Rows (world x extent)
+    int tile_count;         // Entries per grid (width * height unless streamed), also the outside entry
+    int stride;             // Grid entries per row
+    int mask_x;             // Wraps tile coordinates into the grids
+    int mask_y;
+    uint8_t* tiles;         // Wall texture per tile (0 = empty, 1-8 = texture)
+    uint8_t* floor;         // Floor texture per tile (0 = flat color, 1-8 = texture)
+    uint8_t* ceiling;       // Ceiling texture per tile (0 = flat color, 1-8 = texture)
+
+    // Derived from tiles by map_update. A block word covers an 8x8 square,
+    // so a ray in any direction touches a new word at most every 8 steps,
+    // and a 4096x4096 map needs 2 MB of occupancy bits.
+    int blocks_y;           // Blocks per row of blocks
+    int block_count;        // Also the index of the all-solid outside word
+    uint64_t* solid;        // Block (x >> 3, y >> 3) at (x >> 3) * blocks_y + (y >> 3), bit (x & 7) * 8 + (y & 7)
+
+    // Chebyshev distance from each tile to the nearest solid tile (the
+    // outside of the map counts as solid), so every tile within
+    // distance - 1 of it, in both x and y, is empty. Streamed maps measure
+    // it within each chunk, so a skip never crosses into another chunk.
+    uint8_t* distance;
+
+    // Streamed maps only: nonzero per resident chunk, chunk (x >> 6, y >> 6)
+    // at (x >> 6) * chunks_y + (y >> 6). Occupancy always covers the whole
+    // world, with chunks that aren't resident marked solid.
+    const uint8_t* resident;
+    int chunks_y;
+
     float player_spawn_x;
     float player_spawn_y;
+
+    // Declared entities, grouped by kind in MapEntityKind order (see
+    // map_entities), so each manager bulk-inserts one contiguous run
+    MapEntity* entities;
+    int entity_total;
+    int entity_count[MAP_ENTITY_KINDS];
+
+    // Empty tiles as x * width + y, rebuilt by map_update; streamed maps
+    // only list tiles of the chunks resident when the stream opened
+    uint32_t* free_cells;
+    int free_cell_count;
+
+    // Binary map file the grids point into, mapped copy-on-write (NULL
+    // when every grid is on the heap)
+    void* file_data;
+    size_t file_size;
 } Map;
 
-// Map data (legacy)
-extern int world_map[MAP_WIDTH][MAP_HEIGHT];
+// Bumped whenever any map's tiles change, so cached ray hits can be dropped
+extern unsigned int map_revision;
+
+// Empty width x height map with the spawn in the middle. Returns false
+// for bad sizes or when out of memory.
+bool map_create(Map* map, int width, int height);
 
-// Map functions
+// Fill in the size fields of an empty width x height map without
+// allocating anything. Returns false for bad sizes.
+bool map_set_size(Map* map, int width, int height);
+
+// Allocate zeroed grids for a map sized by map_set_size. Call map_update
+// once the tiles are filled in.
+bool map_allocate(Map* map);
+
+// Load a text or binary map file; map_free it afterwards even if this fails
 bool map_load(Map* map, const char* filename);
+
+// Map the grids of a binary map file straight into memory. Occupancy and
+// distances stored in the file are used as they are; missing ones are
+// built. Map_free it afterwards even if this fails.
+bool map_load_binary(Map* map, const char* filename);
+
+// Write a map, with its occupancy and distances, in the binary format
+bool map_save_binary(const Map* map, const char* filename);
+
+// True if the file starts with the binary map magic
+bool map_is_binary(const char* filename);
+
+// The built-in 24x24 level
+bool map_load_default(Map* map);
+
+// Rebuild occupancy and distances and bump map_revision. Call after
+// changing tiles. Streamed maps build these per chunk as chunks arrive.
+void map_update(Map* map);
+
+// Fill in the free-cell sample from the occupancy grid
+void map_build_free_cells(Map* map);
+
+// Centre of a random empty tile in O(1); false if the map has none
+bool map_random_free_cell(const Map* map, float* x, float* y);
+
+// Group entities by kind and fill in the counts. Returns false when out
+// of memory (the entities are left as they were) or map_check_entities
+// rejects one.
+bool map_sort_entities(Map* map);
+
+// True if (x, y) lies on the map, where an entity may be declared
+bool map_entity_inside(const Map* map, float x, float y);
+
+// Check that every entity has a known kind, is grouped in MapEntityKind
+// order and lies on the map, and fill in the counts. Returns the index of
+// the first bad entity, or -1 when they are all fine.
+int map_check_entities(Map* map);
+
+// Rebuild occupancy and distances after changing the tiles in rows x0-x1,
+// columns y0-y1 (inclusive), touching only what the change can affect,
+// and bump map_revision
+void map_update_region(Map* map, int x0, int y0, int x1, int y1);
+
+// Leave (x, y) alone if its tile is empty, else move it to the centre of
+// the nearest empty tile within max_radius. False if there is none.
+bool map_nearest_free(const Map* map, float* x, float* y, int max_radius);
+
+// Chebyshev distances for a rows x cols block of tiles, counting anything
+// outside the block as solid. Rebuilds rows x0-x1, columns y0-y1
+// (inclusive), seeded from the distances already around them; pass the
+// whole block to build it from scratch.
+void map_build_distance(const uint8_t* tiles, int tile_stride, uint8_t* distance, int distance_stride,
+                        int rows, int cols, int x0, int y0, int x1, int y1);
+
 void map_free(Map* map);
 
+static inline bool map_inside(const Map* map, int x, int y) {
+    return (unsigned)x < (unsigned)map->height && (unsigned)y < (unsigned)map->width;
+}
+
+// Index of tile (x, y) in the tile grids, or of the outside entry
+static inline int map_index(const Map* map, int x, int y) {
+    return map_inside(map, x, y) ? (x & map->mask_x) * map->stride + (y & map->mask_y) : map->tile_count;
+}
+
+// Word and bit of map->solid holding tile (x, y)
+static inline int map_block_index(const Map* map, int x, int y) {
+    return map_inside(map, x, y)
+        ? (x >> MAP_BLOCK_SHIFT) * map->blocks_y + (y >> MAP_BLOCK_SHIFT)
+        : map->block_count;
+}
+
+static inline int map_block_bit(int x, int y) {
+    return ((x & 7) << 3) | (y & 7);
+}
+
+// True for walls and for anything outside the map
+static inline bool map_solid(const Map* map, int x, int y) {
+    return (map->solid[map_block_index(map, x, y)] >> map_block_bit(x, y)) & 1;
+}
+
+// Wall texture id at (x, y); 0 outside the map
+static inline int map_tile(const Map* map, int x, int y) {
+    return map->tiles[map_index(map, x, y)];
+}
+
+// Chebyshev distance from (x, y) to the nearest solid tile; 0 outside the map
+static inline int map_distance(const Map* map, int x, int y) {
+    return map->distance[map_index(map, x, y)];
+}
+
+// The run of declared entities of one kind
+static inline const MapEntity* map_entities(const Map* map, MapEntityKind kind, int* count) {
+    int start = 0;
+    for (int k = 0; k < (int)kind; k++) {
+        start += map->entity_count[k];
+    }
+    *count = map->entity_count[kind];
+    return map->entities ? map->entities + start : NULL;
+}
+
+// False inside chunks of a streamed map that aren't resident; entities
+// there are left alone until their chunk comes back
+static inline bool map_loaded(const Map* map, int x, int y) {
+    return !map->resident ||
+           (map_inside(map, x, y) && map->resident[(x >> MAP_CHUNK_SHIFT) * map->chunks_y + (y >> MAP_CHUNK_SHIFT)]);
+}
+
 #endif
@@ -0,0 +1,80 @@
+#ifndef MAP_STREAM_H
+#define MAP_STREAM_H
+
+#include "map.h"
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Chunked world files hold each 64x64 chunk's tiles, floor, ceiling,
+// occupancy and chunk-local distances in one fixed-size record, so a chunk
+// is one read at a computed offset. A background thread reads the chunks
+// around the player; the game thread installs them between frames into a
+// window of chunk slots (see Map) and evicts the farthest ones once more
+// than the budget are resident. Chunks that aren't resident are solid.
+
+#define MAP_STREAM_RADIUS 4              // Default load range in chunks around the player
+#define MAP_STREAM_BUDGET 144            // Default resident chunks (about 2.4 MB of chunk data)
+#define MAP_STREAM_QUEUE 32              // Chunk reads in flight
+#define MAP_STREAM_UNLOADED_TILE 1       // Wall texture shown where chunks are missing
+
+typedef struct {
+    long long hits;             // Chunks in load range that were resident
+    long long misses;           // Chunks in load range that were not
+    long long loads;            // Chunks installed
+    long long evictions;
+    long long failures;         // Chunk reads that failed
+    double latency_total_ms;    // Request to install, summed over loads
+    double latency_max_ms;
+    int resident;               // Chunks resident now
+} MapStreamStats;
+
+typedef struct {
+    int chunk;                  // World chunk index
+    int state;                  // Free, queued, loading or done (map_stream.c)
+    bool ok;
+    Uint64 requested;           // Performance counter when queued
+    uint8_t* data;              // One chunk record
+} MapStreamRequest;
+
+typedef struct {
+    Map* map;
+    int fd;
+    int radius;                 // Chunks kept loaded around the player, in each direction
+    int budget;                 // Most chunks resident at once
+    int chunks_x;               // Chunks per world column
+    int chunks_y;               // Chunks per world row
+    int window_shift;           // Window is 1 << window_shift chunk slots per side
+    uint8_t* resident;          // Per world chunk, shared with the map
+    uint8_t* pending;           // Per world chunk: a request is queued or loading
+    int* slots;                 // World chunk in each window slot, or -1
+    MapStreamRequest requests[MAP_STREAM_QUEUE];
+
+    SDL_Thread* thread;         // NULL when chunks are read on the game thread
+    SDL_mutex* lock;            // Guards request states
+    SDL_cond* wake;
+    bool quit;
+
+    MapStreamStats stats;
+} MapStream;
+
+// True if the file is a chunked world
+bool map_stream_is_chunked(const char* filename);
+
+// Open a chunked world as a streamed map and load the chunks within radius
+// of the spawn before returning. Budget is a chunk count (raised to cover
+// the load range). Call map_stream_close even if this fails.
+bool map_stream_open(MapStream* stream, Map* map, const char* filename, int radius, int budget);
+
+// Install finished chunks, queue missing ones near (x, y) and evict beyond
+// the budget. Call once per frame while no rendering is in progress.
+void map_stream_update(MapStream* stream, float x, float y);
+
+// Stop the loader and free the map
+void map_stream_close(MapStream* stream);
+
+void map_stream_print_stats(const MapStream* stream);
+
+// Write a fully loaded map as a chunked world
+bool map_stream_save(const Map* map, const char* filename);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MAP_WATCH_H
+#define MAP_WATCH_H
+
+#include "map.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hot reload for text maps. The loader keeps the file's text with what
+// each line holds (a grid row, an entity, the spawn...), so a reload
+// compares the new text line by line and re-parses only the lines that
+// changed. Tile edits rebuild occupancy and distances around the edited
+// tiles only; edits that change the map's structure (size, sections,
+// added or removed lines) parse the whole file but still rebuild only
+// around the tiles that differ.
+
+// Text of the last good load of a map file
+typedef struct {
+    char* text;                 // Every line ends in '\n'
+    size_t size;
+    size_t* line_start;         // Offset of each line in text
+    int32_t* line_role;         // What each line holds (map_loader.c)
+    int line_count;
+
+    // Entity declarations that went away or appeared in the last reload,
+    // grouped by kind
+    MapEntity* removed;
+    int removed_count;
+    MapEntity* added;
+    int added_count;
+} MapSource;
+
+// What a reload changed
+typedef struct {
+    bool tiles;                 // Wall tiles changed within rows x0-x1, columns y0-y1
+    int x0, y0, x1, y1;
+    bool resized;               // The map was replaced by one of another size
+    bool textures;              // Floor or ceiling textures changed
+    bool spawn;                 // The player spawn moved
+    bool entities;              // See MapSource removed / added
+} MapReloadChanges;
+
+// Load a map like map_load, keeping the text in source for map_reload
+// when it is a text map (source->text stays NULL for binary maps).
+// Map_free the map and map_source_free the source even if this fails.
+bool map_load_source(Map* map, const char* filename, MapSource* source);
+
+// Re-read a text map loaded with map_load_source and apply the changes to
+// map. On errors the map and source are left as they were.
+bool map_reload(Map* map, MapSource* source, const char* filename, MapReloadChanges* changes);
+
+void map_source_free(MapSource* source);
+
+// Watches a map file for saves, including editors that save by writing a
+// new file and renaming it over the old one (Linux inotify only)
+typedef struct {
+    int fd;                     // inotify descriptor, -1 when not watching
+    char name[256];             // File name within the watched directory
+} MapWatch;
+
+// Start watching; false (with a message) where inotify is unavailable
+bool map_watch_open(MapWatch* watch, const char* filename);
+
+// True if the file was saved since the last call. Never blocks.
+bool map_watch_poll(MapWatch* watch);
+
+void map_watch_close(MapWatch* watch);
+
+#endif
@@ -8,7 +8,8 @@
 
 #define MINIMAP_SCALE 8
 #define MINIMAP_MARGIN 10
+#define MINIMAP_TILES 24    // Tiles shown along each side; bigger maps scroll with the player
 
-void minimap_render(Engine* engine, Player* player, Map* map, bool enabled);
+void minimap_render(Engine* engine, Player* player, const Map* map, bool enabled);
 
 #endif
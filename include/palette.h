@@ -0,0 +1,42 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+#include "texture.h"
+
+#define PALETTE_SIZE 256
+#define PALETTE_TRANSPARENT 255     // Index reserved for see-through sprite texels
+#define PALETTE_TINT_LEVELS 16      // Steps of the flash and damage colormaps
+
+// Fixed 8-bit palette with Doom-style colormaps. Every table maps a
+// palette index to the palette index of the modified color, so lighting
+// and tints cost one 256-byte lookup per pixel.
+typedef struct {
+    uint32_t colors[PALETTE_SIZE];                          // 0x00RRGGBB
+    uint8_t inverse[32 * 32 * 32];                          // RGB555 -> nearest index
+    uint8_t shade[TEXTURE_SHADE_LEVELS][PALETTE_SIZE];      // Same levels as texture_shade_pixel
+    uint8_t brighten[PALETTE_TINT_LEVELS][PALETTE_SIZE];    // Toward white (muzzle and hit flash)
+    uint8_t redden[PALETTE_TINT_LEVELS][PALETTE_SIZE];      // Toward red (damage and low health)
+    uint8_t game_over[PALETTE_SIZE];                        // Darkened red game over overlay
+} Palette;
+
+// Shared palette, built on first use
+const Palette* palette_get(void);
+
+// Nearest palette index for an ARGB color (alpha ignored)
+static inline uint8_t palette_quantize(const Palette* palette, uint32_t color) {
+    return palette->inverse[((color >> 9) & 0x7C00) | ((color >> 6) & 0x03E0) | ((color >> 3) & 0x001F)];
+}
+
+// Colormap level for a tint amount in [0, 1]
+static inline int palette_tint_level(float amount) {
+    int level = (int)(amount * (PALETTE_TINT_LEVELS - 1) + 0.5f);
+    if (level < 0) level = 0;
+    if (level >= PALETTE_TINT_LEVELS) level = PALETTE_TINT_LEVELS - 1;
+    return level;
+}
+
+// Expand count palette indices to ARGB pixels
+void palette_expand(const Palette* palette, const uint8_t* src, uint32_t* dst, int count);
+
+#endif
@@ -3,9 +3,11 @@
 
 #include <stdbool.h>
 #include "player.h"
+#include "map.h"
 #include "texture.h"
+#include "render_list.h"
 
-#define MAX_PICKUPS 32
+#define MAX_PICKUPS 1024
 
 typedef enum {
     PICKUP_AMMO_SMALL,   // +20 ammo
@@ -27,6 +29,7 @@ typedef struct {
     Pickup pickups[MAX_PICKUPS];
     int count;
     Texture textures[4];  // Textures for each pickup type
+    RenderList render_list;  // Active pickups in draw order
 } PickupManager;
 
 // Initialize pickup manager
@@ -36,11 +39,20 @@ bool pickup_manager_init(PickupManager* pm);
 void pickup_manager_cleanup(PickupManager* pm);
 
 // Update pickups (handle lifetime)
-void pickup_manager_update(PickupManager* pm, float delta_time);
+void pickup_manager_update(PickupManager* pm, const Map* map, float delta_time);
 
 // Add a pickup to the world
 bool pickup_add(PickupManager* pm, float x, float y, PickupType type, float lifetime);
 
+// Add map-declared permanent pickups in one pass over the free slots;
+// other kinds of entity and unknown types are skipped. Returns the number
+// added.
+int pickup_add_bulk(PickupManager* pm, const MapEntity* entities, int count);
+
+// Remove the permanent pickups placed by these declarations, if they
+// haven't been picked up
+void pickup_remove_bulk(PickupManager* pm, const MapEntity* entities, int count);
+
 // Check for pickup collision with player
 void pickup_check_collision(PickupManager* pm, Player* player);
 
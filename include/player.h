@@ -4,6 +4,7 @@
 #include <math.h>
 #include "weapon.h"
 #include "sound.h"
+#include "map.h"
 
 // Player structure
 typedef struct {
@@ -34,8 +35,8 @@ typedef struct {
 } Player;
 
 void player_init(Player* player, float x, float y);
-void player_move_forward(Player* player, float delta_time, SoundManager* sm);
-void player_move_backward(Player* player, float delta_time, SoundManager* sm);
+void player_move_forward(Player* player, const Map* map, float delta_time, SoundManager* sm);
+void player_move_backward(Player* player, const Map* map, float delta_time, SoundManager* sm);
 void player_rotate_left(Player* player, float delta_time);
 void player_rotate_right(Player* player, float delta_time);
 
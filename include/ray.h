@@ -0,0 +1,40 @@
+#ifndef RAY_H
+#define RAY_H
+
+#include <stdbool.h>
+#include "map.h"
+
+// Number of adjacent rays traced together by ray_cast_packet
+#if defined(__AVX2__)
+#define RAY_PACKET_WIDTH 8
+#elif defined(__SSE2__)
+#define RAY_PACKET_WIDTH 4
+#else
+#define RAY_PACKET_WIDTH 1
+#endif
+
+// Result of tracing one ray through the tile grid
+typedef struct {
+    float perp_wall_dist;   // Distance projected on camera direction
+    float wall_x;           // Where exactly the wall was hit (0..1)
+    int map_x;              // Tile that was hit
+    int map_y;
+    int side;               // 0 = x-side (NS wall), 1 = y-side (EW wall)
+} RayHit;
+
+// Jump through open space using the map's distance field (on by default).
+// Hits are identical either way; this only exists for benchmarking.
+extern bool ray_empty_skipping;
+
+// Trace a single ray with DDA until it hits a wall
+void ray_cast(const Map* map, float pos_x, float pos_y, float ray_dir_x, float ray_dir_y, RayHit* hit);
+
+// Trace RAY_PACKET_WIDTH rays in lockstep (SSE2/AVX2 when available).
+// Results are bit-identical to calling ray_cast for each lane.
+void ray_cast_packet(const Map* map, float pos_x, float pos_y, const float* ray_dir_x, const float* ray_dir_y, RayHit* hits);
+
+// Complete a hit whose tile and side are already known, without walking
+// the grid. Gives the same result as ray_cast for a ray that hits them.
+void ray_resolve(float pos_x, float pos_y, float ray_dir_x, float ray_dir_y, int map_x, int map_y, int side, RayHit* hit);
+
+#endif
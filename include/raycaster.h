@@ -3,11 +3,15 @@
 
 #include "engine.h"
 #include "player.h"
+#include "map.h"
 #include "texture.h"
 #include "sprite.h"
 #include "enemy.h"
 #include "pickup.h"
 
-void raycaster_render(Engine* engine, Player* player, TextureManager* tm, SpriteManager* sm, EnemyManager* em, PickupManager* pm);
+void raycaster_render(Engine* engine, Player* player, const Map* map, TextureManager* tm, SpriteManager* sm, EnemyManager* em, PickupManager* pm);
+
+// Stop render worker threads and free per-frame buffers
+void raycaster_cleanup(void);
 
 #endif
@@ -0,0 +1,51 @@
+#ifndef RENDER_LIST_H
+#define RENDER_LIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Persistent far-to-near draw order for one manager's billboards. The
+// manager adds and removes slots as they activate and deactivate; each
+// frame the renderer refreshes the depths and re-sorts. The order barely
+// changes between frames, so an insertion sort is close to linear; when
+// it has changed a lot (many new entries, a teleport) a radix sort on a
+// quantized depth runs first.
+
+// Lists shorter than this never use the radix sort
+#define RENDER_LIST_RADIX_MIN 256
+
+// Average shifts per entry the insertion sort may make before the radix
+// sort takes over
+#define RENDER_LIST_MOVES 8
+
+typedef struct {
+    float depth;    // Squared distance to the camera when last sorted
+    int index;      // Slot in the owning manager, -1 once removed
+} RenderEntry;
+
+typedef struct {
+    RenderEntry* entries;   // Far to near after render_list_sort
+    RenderEntry* scratch;   // Radix sort buffer
+    int* position;          // Entry of each manager slot, -1 if not listed
+    int count;              // Entries, including removed ones until the next sort
+    int capacity;
+    bool radix_used;        // The last sort needed the radix pass
+} RenderList;
+
+bool render_list_init(RenderList* list, int capacity);
+void render_list_free(RenderList* list);
+
+// Drop every entry
+void render_list_clear(RenderList* list);
+
+// List a manager slot (ignored if already listed); it sorts in on the
+// next render_list_sort
+void render_list_add(RenderList* list, int index);
+
+// Unlist a manager slot; removed entries are compacted by the next sort
+void render_list_remove(RenderList* list, int index);
+
+// Drop removed entries and restore far-to-near order by depth
+void render_list_sort(RenderList* list);
+
+#endif
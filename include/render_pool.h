@@ -0,0 +1,48 @@
+#ifndef RENDER_POOL_H
+#define RENDER_POOL_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#define MAX_RENDER_THREADS 16
+
+// Renders items [start, end) of the current job; band is 0..thread_count-1
+typedef void (*RenderJobFunc)(void* ctx, int band, int start, int end);
+
+typedef struct RenderPool RenderPool;
+
+typedef struct {
+    RenderPool* pool;
+    int band;                   // Band index handled by this worker
+    SDL_Thread* thread;
+    SDL_sem* start;             // Posted when a new job is ready
+} RenderWorker;
+
+// Persistent worker pool that splits a job into contiguous bands.
+// The calling thread always renders band 0, so a pool of N threads
+// owns N-1 workers.
+struct RenderPool {
+    RenderWorker workers[MAX_RENDER_THREADS];
+    int thread_count;           // Bands per job (workers + calling thread)
+    SDL_sem* done;              // Posted by each worker when its band is finished
+    bool quit;
+
+    // Current job
+    RenderJobFunc func;
+    void* ctx;
+    int item_count;
+};
+
+// Start a pool with the given number of threads (falls back to fewer if
+// thread creation fails, e.g. on a WASM build without pthreads)
+bool render_pool_init(RenderPool* pool, int thread_count);
+void render_pool_cleanup(RenderPool* pool);
+
+// Run func over item_count items split into thread_count bands and wait
+// for all bands to finish
+void render_pool_run(RenderPool* pool, RenderJobFunc func, void* ctx, int item_count);
+
+// Default thread count for this machine
+int render_pool_default_threads(void);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <stdint.h>
+
+// Destination for the 3D view. Pixel (x, y) lives at
+// pixels[x * x_stride + y * y_stride], so the same column kernels can
+// draw into the row-major SDL framebuffer or a column-major buffer.
+// Indexed targets use indices[] (8-bit palette) instead of pixels.
+typedef struct {
+    uint32_t* pixels;
+    uint8_t* indices;
+    int width;
+    int height;
+    int x_stride;   // Distance between horizontally adjacent pixels
+    int y_stride;   // Distance between vertically adjacent pixels
+} RenderTarget;
+
+// Row-major target over an existing framebuffer
+void render_target_init_rows(RenderTarget* target, uint32_t* pixels, int width, int height);
+
+// Row-major 8-bit palette target over an existing index buffer
+void render_target_init_indexed(RenderTarget* target, uint8_t* indices, int width, int height);
+
+// Column-major (transposed) target over a width * height buffer
+void render_target_init_columns(RenderTarget* target, uint32_t* pixels, int width, int height);
+
+// Copy rows [row_start, row_end) of a column-major target into a
+// row-major framebuffer using cache-sized blocks and 4x4 SIMD transposes
+void render_target_transpose(const RenderTarget* src, uint32_t* dst, int row_start, int row_end);
+
+#endif
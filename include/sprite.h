@@ -4,8 +4,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "texture.h"
+#include "map.h"
+#include "render_list.h"
 
-#define MAX_SPRITES 128
+#define MAX_SPRITES 16384
 
 typedef struct {
     float x;          // Position X
@@ -19,11 +21,19 @@ typedef struct {
     int count;
     Texture sprite_textures[8];  // Sprite textures
     int texture_count;
+    RenderList render_list;      // Active sprites in draw order
 } SpriteManager;
 
 bool sprite_manager_init(SpriteManager* sm);
 void sprite_manager_cleanup(SpriteManager* sm);
 void sprite_add(SpriteManager* sm, float x, float y, int texture_id);
+
+// Add map-declared sprites in one pass over the free slots; other kinds of
+// entity and unknown textures are skipped. Returns the number added.
+int sprite_add_bulk(SpriteManager* sm, const MapEntity* entities, int count);
+
+// Remove the sprites placed by these declarations (other kinds are skipped)
+void sprite_remove_bulk(SpriteManager* sm, const MapEntity* entities, int count);
 void sprite_generate_procedural(Texture* texture, int type);
 
 #endif
@@ -8,13 +8,35 @@
 #define TEXTURE_HEIGHT 64
 #define MAX_TEXTURES 8
 
+// Mip chain: level L is (TEXTURE_WIDTH >> L) x (TEXTURE_HEIGHT >> L), box
+// filtered from level L-1, down to 4x4. Levels are stored one after the
+// other in the column-major copies, level 0 first.
+#define TEXTURE_MIP_LEVELS 5
+#define TEXTURE_CHAIN_TEXELS (TEXTURE_WIDTH * TEXTURE_HEIGHT * (1 + 4 + 16 + 64 + 256) / 256)
+#define TEXTURE_CHAIN_COLUMNS (TEXTURE_WIDTH * (1 + 2 + 4 + 8 + 16) / 16)
+
+// Precomputed brightness levels per wall texture. Level 0 is the
+// unmodified texture; level L scales each channel by (LEVELS - L) / LEVELS.
+#define TEXTURE_SHADE_LEVELS 4
+#define TEXTURE_SHADE_SIDE (TEXTURE_SHADE_LEVELS / 2)  // y-side walls (half brightness)
+#define TEXTURE_SHADE_SIZE (TEXTURE_SHADE_LEVELS * TEXTURE_CHAIN_TEXELS)  // Texels per texture in shade_data
+
 typedef struct {
-    uint32_t data[TEXTURE_WIDTH * TEXTURE_HEIGHT];
+    uint32_t data[TEXTURE_WIDTH * TEXTURE_HEIGHT];     // Row-major: data[y * TEXTURE_WIDTH + x]
+    uint32_t columns[TEXTURE_CHAIN_TEXELS];            // Column-major mip chain: columns[x * TEXTURE_HEIGHT + y] at level 0
+    uint8_t indices[TEXTURE_CHAIN_TEXELS];             // Column-major palette indices for the 8-bit pipeline
+
+    // Opaque runs of every column of the mip chain, for sprites: (first,
+    // end) row pairs, level 0 columns first (see texture_build_spans)
+    uint8_t spans[TEXTURE_CHAIN_TEXELS];
+    uint16_t span_start[TEXTURE_CHAIN_COLUMNS + 1];    // First pair of each column
 } Texture;
 
 typedef struct {
     Texture textures[MAX_TEXTURES];
     int count;
+    uint32_t* shade_data;            // One block holding every shaded copy (gather base)
+    uint32_t* shades[MAX_TEXTURES];  // Shaded mip chains, TEXTURE_SHADE_LEVELS per texture
 } TextureManager;
 
 bool texture_manager_init(TextureManager* tm);
@@ -23,4 +45,68 @@ void texture_generate_procedural(Texture* texture, int type);
 bool texture_load_from_file(Texture* texture, const char* filepath);
 uint32_t texture_get_pixel(Texture* texture, int x, int y);
 
+// Rebuild the column-major and palette-indexed mip chains after writing to data
+void texture_build_columns(Texture* texture);
+
+// Find the opaque runs of each column (after texture_build_columns) so
+// sprites draw only those. Opaque means not PALETTE_TRANSPARENT in the
+// palette chain: alpha above 128, or any texel of a texture without alpha.
+void texture_build_spans(Texture* texture);
+
+// Offset of mip level within a chain
+static inline int texture_mip_offset(int mip) {
+    int offset = 0;
+    for (int i = 0; i < mip; i++) {
+        offset += (TEXTURE_WIDTH >> i) * (TEXTURE_HEIGHT >> i);
+    }
+    return offset;
+}
+
+// Mip level whose texel density is closest to (and not below) one texel
+// per pixel for a surface drawn size pixels tall
+static inline int texture_mip_level(int size) {
+    int mip = 0;
+    while (mip < TEXTURE_MIP_LEVELS - 1 && size * (2 << mip) <= TEXTURE_HEIGHT) {
+        mip++;
+    }
+    return mip;
+}
+
+// Contiguous texels of column x (TEXTURE_HEIGHT entries)
+static inline const uint32_t* texture_column(const Texture* texture, int x) {
+    return texture->columns + x * TEXTURE_HEIGHT;
+}
+
+// Contiguous palette indices of column x (TEXTURE_HEIGHT entries)
+static inline const uint8_t* texture_index_column(const Texture* texture, int x) {
+    return texture->indices + x * TEXTURE_HEIGHT;
+}
+
+// Column x of mip level mip (TEXTURE_HEIGHT >> mip entries, x < TEXTURE_WIDTH >> mip)
+static inline const uint32_t* texture_mip_column(const Texture* texture, int mip, int x) {
+    return texture->columns + texture_mip_offset(mip) + x * (TEXTURE_HEIGHT >> mip);
+}
+
+static inline const uint8_t* texture_index_mip_column(const Texture* texture, int mip, int x) {
+    return texture->indices + texture_mip_offset(mip) + x * (TEXTURE_HEIGHT >> mip);
+}
+
+// Opaque runs of column x of mip level mip: *count (first, end) row pairs
+static inline const uint8_t* texture_mip_spans(const Texture* texture, int mip, int x, int* count) {
+    int column = 2 * TEXTURE_WIDTH - ((2 * TEXTURE_WIDTH) >> mip) + x;  // Levels before mip hold 2W - 2W/2^mip
+    *count = texture->span_start[column + 1] - texture->span_start[column];
+    return texture->spans + 2 * texture->span_start[column];
+}
+
+// Apply shade level to a single color
+uint32_t texture_shade_pixel(uint32_t color, int level);
+
+// Rebuild shaded copies of every wall texture (call after changing one)
+void texture_manager_build_shades(TextureManager* tm);
+
+// Contiguous texels of column x of a wall texture at the given shade and mip level
+static inline const uint32_t* texture_manager_shaded_column(const TextureManager* tm, int tex_num, int level, int mip, int x) {
+    return tm->shades[tex_num] + level * TEXTURE_CHAIN_TEXELS + texture_mip_offset(mip) + x * (TEXTURE_HEIGHT >> mip);
+}
+
 #endif
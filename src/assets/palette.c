@@ -0,0 +1,151 @@
+#include "palette.h"
+#include <stdbool.h>
+#include <limits.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Color cube with more green than red and more red than blue, as the eye
+// is most sensitive to green; the remaining entries are extra grays
+#define CUBE_R 6
+#define CUBE_G 8
+#define CUBE_B 5
+#define CUBE_SIZE (CUBE_R * CUBE_G * CUBE_B)
+#define GRAY_COUNT (PALETTE_TRANSPARENT - CUBE_SIZE)
+
+static Palette shared_palette;
+static bool shared_palette_ready = false;
+
+static uint32_t palette_rgb(int r, int g, int b) {
+    if (r > 255) r = 255;
+    if (g > 255) g = 255;
+    if (b > 255) b = 255;
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+}
+
+// Closest opaque entry using green-weighted squared distance
+static uint8_t palette_nearest(const Palette* palette, int r, int g, int b) {
+    int best = 0;
+    long best_dist = LONG_MAX;
+
+    for (int i = 0; i < PALETTE_TRANSPARENT; i++) {
+        uint32_t c = palette->colors[i];
+        long dr = (long)((c >> 16) & 0xFF) - r;
+        long dg = (long)((c >> 8) & 0xFF) - g;
+        long db = (long)(c & 0xFF) - b;
+        long dist = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+        if (dist < best_dist) {
+            best_dist = dist;
+            best = i;
+        }
+    }
+    return (uint8_t)best;
+}
+
+// Fill a colormap from a per-channel color transform at amount t
+static void palette_build_tint(Palette* palette, uint8_t* map, float t, int kind) {
+    for (int i = 0; i < PALETTE_SIZE; i++) {
+        if (i == PALETTE_TRANSPARENT || t <= 0.0f) {
+            map[i] = (uint8_t)i;
+            continue;
+        }
+
+        uint32_t c = palette->colors[i];
+        int r = (c >> 16) & 0xFF;
+        int g = (c >> 8) & 0xFF;
+        int b = c & 0xFF;
+
+        if (kind == 0) {
+            // Brighten toward white
+            r = r + (int)((255 - r) * t);
+            g = g + (int)((255 - g) * t);
+            b = b + (int)((255 - b) * t);
+        } else {
+            // Push red up, green and blue down
+            r = r + (int)((255 - r) * t);
+            g = (int)(g * (1.0f - t));
+            b = (int)(b * (1.0f - t));
+        }
+        map[i] = palette_quantize(palette, palette_rgb(r, g, b));
+    }
+}
+
+static void palette_build(Palette* palette) {
+    int n = 0;
+
+    for (int r = 0; r < CUBE_R; r++) {
+        for (int g = 0; g < CUBE_G; g++) {
+            for (int b = 0; b < CUBE_B; b++) {
+                palette->colors[n++] = palette_rgb(r * 255 / (CUBE_R - 1), g * 255 / (CUBE_G - 1),
+                                                   b * 255 / (CUBE_B - 1));
+            }
+        }
+    }
+    for (int k = 1; k <= GRAY_COUNT; k++) {
+        int gray = k * 256 / (GRAY_COUNT + 1);
+        palette->colors[n++] = palette_rgb(gray, gray, gray);
+    }
+    palette->colors[PALETTE_TRANSPARENT] = 0xFF00FF;  // Never drawn
+
+    // Nearest entry for every RGB555 color (bucket value widened to 8 bits)
+    for (int i = 0; i < 32 * 32 * 32; i++) {
+        int r = (i >> 10) & 31;
+        int g = (i >> 5) & 31;
+        int b = i & 31;
+        palette->inverse[i] = palette_nearest(palette, (r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2));
+    }
+
+    // Lighting levels match the 32-bit shaded textures
+    for (int level = 0; level < TEXTURE_SHADE_LEVELS; level++) {
+        for (int i = 0; i < PALETTE_SIZE; i++) {
+            palette->shade[level][i] = (level == 0 || i == PALETTE_TRANSPARENT)
+                ? (uint8_t)i
+                : palette_quantize(palette, texture_shade_pixel(palette->colors[i], level));
+        }
+    }
+
+    for (int level = 0; level < PALETTE_TINT_LEVELS; level++) {
+        float t = (float)level / (PALETTE_TINT_LEVELS - 1);
+        palette_build_tint(palette, palette->brighten[level], t, 0);
+        palette_build_tint(palette, palette->redden[level], t, 1);
+    }
+
+    for (int i = 0; i < PALETTE_SIZE; i++) {
+        uint32_t c = palette->colors[i];
+        palette->game_over[i] = palette_quantize(palette,
+            palette_rgb((int)((c >> 16) & 0xFF) / 2 + 64, (int)((c >> 8) & 0xFF) / 2, (int)(c & 0xFF) / 2));
+    }
+}
+
+const Palette* palette_get(void) {
+    if (!shared_palette_ready) {
+        palette_build(&shared_palette);
+        shared_palette_ready = true;
+    }
+    return &shared_palette;
+}
+
+void palette_expand(const Palette* palette, const uint8_t* src, uint32_t* dst, int count) {
+    const uint32_t* colors = palette->colors;
+    int i = 0;
+
+#if defined(__AVX2__)
+    // Widen 8 indices to 32 bits and gather their colors
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_i32gather_epi32((const int*)colors, index, 4));
+    }
+#elif defined(__SSE2__)
+    // No gather: scalar table lookups, 16-byte stores
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_setr_epi32((int)colors[src[i]], (int)colors[src[i + 1]],
+                                                             (int)colors[src[i + 2]], (int)colors[src[i + 3]]));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = colors[src[i]];
+    }
+}
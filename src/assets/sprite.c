@@ -108,6 +108,9 @@ void sprite_generate_procedural(Texture* texture, int type) {
             }
             break;
     }
+
+    texture_build_columns(texture);
+    texture_build_spans(texture);
 }
 
 bool sprite_manager_init(SpriteManager* sm) {
@@ -124,12 +127,13 @@ bool sprite_manager_init(SpriteManager* sm) {
         sm->sprites[i].active = false;
     }
 
-    return true;
+    return render_list_init(&sm->render_list, MAX_SPRITES);
 }
 
 void sprite_manager_cleanup(SpriteManager* sm) {
     sm->count = 0;
     sm->texture_count = 0;
+    render_list_free(&sm->render_list);
 }
 
 void sprite_add(SpriteManager* sm, float x, float y, int texture_id) {
@@ -144,7 +148,53 @@ void sprite_add(SpriteManager* sm, float x, float y, int texture_id) {
             sm->sprites[i].texture_id = texture_id;
             sm->sprites[i].active = true;
             sm->count++;
+            render_list_add(&sm->render_list, i);
+            break;
+        }
+    }
+}
+
+int sprite_add_bulk(SpriteManager* sm, const MapEntity* entities, int count) {
+    int added = 0;
+    int slot = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (entities[i].kind != MAP_ENTITY_SPRITE || entities[i].type >= sm->texture_count) {
+            continue;
+        }
+        while (slot < MAX_SPRITES && sm->sprites[slot].active) {
+            slot++;
+        }
+        if (slot == MAX_SPRITES) {
             break;
         }
+        Sprite* sprite = &sm->sprites[slot];
+        sprite->x = entities[i].x;
+        sprite->y = entities[i].y;
+        sprite->texture_id = entities[i].type;
+        sprite->active = true;
+        render_list_add(&sm->render_list, slot);
+        added++;
+    }
+
+    sm->count += added;
+    return added;
+}
+
+void sprite_remove_bulk(SpriteManager* sm, const MapEntity* entities, int count) {
+    for (int i = 0; i < count; i++) {
+        if (entities[i].kind != MAP_ENTITY_SPRITE) {
+            continue;
+        }
+        for (int j = 0; j < MAX_SPRITES; j++) {
+            Sprite* sprite = &sm->sprites[j];
+            if (sprite->active && sprite->x == entities[i].x && sprite->y == entities[i].y &&
+                sprite->texture_id == entities[i].type) {
+                sprite->active = false;
+                sm->count--;
+                render_list_remove(&sm->render_list, j);
+                break;
+            }
+        }
     }
 }
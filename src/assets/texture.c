@@ -1,5 +1,6 @@
 #include "texture.h"
 #include "image_loader.h"
+#include "palette.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -11,6 +12,85 @@ uint32_t texture_get_pixel(Texture* texture, int x, int y) {
     return texture->data[y * TEXTURE_WIDTH + x];
 }
 
+// Average of four colors, per channel (alpha included)
+static uint32_t texture_box_filter(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        result |= ((sum + 2) / 4) << shift;
+    }
+    return result;
+}
+
+void texture_build_columns(Texture* texture) {
+    const Palette* palette = palette_get();
+
+    // Procedural wall textures carry no alpha and are fully opaque;
+    // sprite textures use alpha > 128 for opaque texels
+    bool has_alpha = false;
+    for (int i = 0; i < TEXTURE_WIDTH * TEXTURE_HEIGHT; i++) {
+        if (texture->data[i] >> 24) {
+            has_alpha = true;
+            break;
+        }
+    }
+
+    for (int x = 0; x < TEXTURE_WIDTH; x++) {
+        for (int y = 0; y < TEXTURE_HEIGHT; y++) {
+            texture->columns[x * TEXTURE_HEIGHT + y] = texture->data[y * TEXTURE_WIDTH + x];
+        }
+    }
+
+    // Each mip level box-filters 2x2 texels of the previous one
+    for (int mip = 1; mip < TEXTURE_MIP_LEVELS; mip++) {
+        const uint32_t* src = texture->columns + texture_mip_offset(mip - 1);
+        uint32_t* dst = texture->columns + texture_mip_offset(mip);
+        int src_height = TEXTURE_HEIGHT >> (mip - 1);
+        int height = TEXTURE_HEIGHT >> mip;
+
+        for (int x = 0; x < (TEXTURE_WIDTH >> mip); x++) {
+            const uint32_t* left = src + 2 * x * src_height;
+            const uint32_t* right = left + src_height;
+            for (int y = 0; y < height; y++) {
+                dst[x * height + y] = texture_box_filter(left[2 * y], left[2 * y + 1], right[2 * y], right[2 * y + 1]);
+            }
+        }
+    }
+
+    for (int i = 0; i < TEXTURE_CHAIN_TEXELS; i++) {
+        uint32_t color = texture->columns[i];
+        texture->indices[i] = (has_alpha && (color >> 24) <= 128)
+            ? PALETTE_TRANSPARENT
+            : palette_quantize(palette, color);
+    }
+}
+
+void texture_build_spans(Texture* texture) {
+    int pairs = 0;
+    int column = 0;
+    for (int mip = 0; mip < TEXTURE_MIP_LEVELS; mip++) {
+        int height = TEXTURE_HEIGHT >> mip;
+        for (int x = 0; x < (TEXTURE_WIDTH >> mip); x++) {
+            const uint8_t* indices = texture_index_mip_column(texture, mip, x);
+            texture->span_start[column++] = (uint16_t)pairs;
+            for (int y = 0; y < height;) {
+                if (indices[y] == PALETTE_TRANSPARENT) {
+                    y++;
+                    continue;
+                }
+                int first = y;
+                while (y < height && indices[y] != PALETTE_TRANSPARENT) {
+                    y++;
+                }
+                texture->spans[2 * pairs] = (uint8_t)first;
+                texture->spans[2 * pairs + 1] = (uint8_t)y;
+                pairs++;
+            }
+        }
+    }
+    texture->span_start[column] = (uint16_t)pairs;
+}
+
 // Generate procedural textures
 void texture_generate_procedural(Texture* texture, int type) {
     memset(texture->data, 0, sizeof(texture->data));
@@ -91,6 +171,32 @@ void texture_generate_procedural(Texture* texture, int type) {
             }
             break;
     }
+
+    texture_build_columns(texture);
+}
+
+uint32_t texture_shade_pixel(uint32_t color, int level) {
+    if (level <= 0) {
+        return color;
+    }
+
+    uint32_t scale = TEXTURE_SHADE_LEVELS - level;
+    uint32_t r = ((color >> 16) & 0xFF) * scale / TEXTURE_SHADE_LEVELS;
+    uint32_t g = ((color >> 8) & 0xFF) * scale / TEXTURE_SHADE_LEVELS;
+    uint32_t b = (color & 0xFF) * scale / TEXTURE_SHADE_LEVELS;
+    return (r << 16) | (g << 8) | b;
+}
+
+void texture_manager_build_shades(TextureManager* tm) {
+    for (int i = 0; i < MAX_TEXTURES; i++) {
+        const uint32_t* src = tm->textures[i].columns;
+        for (int level = 0; level < TEXTURE_SHADE_LEVELS; level++) {
+            uint32_t* dst = tm->shades[i] + level * TEXTURE_CHAIN_TEXELS;
+            for (int j = 0; j < TEXTURE_CHAIN_TEXELS; j++) {
+                dst[j] = texture_shade_pixel(src[j], level);
+            }
+        }
+    }
 }
 
 bool texture_manager_init(TextureManager* tm) {
@@ -101,10 +207,27 @@ bool texture_manager_init(TextureManager* tm) {
         texture_generate_procedural(&tm->textures[i], i);
     }
 
+    // Allocate shaded copies so the wall kernel never shades per pixel.
+    // One block for all textures lets SIMD kernels gather from any of them.
+    tm->shade_data = (uint32_t*)malloc(MAX_TEXTURES * TEXTURE_SHADE_SIZE * sizeof(uint32_t));
+    if (!tm->shade_data) {
+        fprintf(stderr, "Memory allocation failed for texture shades\n");
+        return false;
+    }
+    for (int i = 0; i < MAX_TEXTURES; i++) {
+        tm->shades[i] = tm->shade_data + i * TEXTURE_SHADE_SIZE;
+    }
+    texture_manager_build_shades(tm);
+
     return true;
 }
 
 void texture_manager_cleanup(TextureManager* tm) {
+    free(tm->shade_data);
+    tm->shade_data = NULL;
+    for (int i = 0; i < MAX_TEXTURES; i++) {
+        tm->shades[i] = NULL;
+    }
     tm->count = 0;
 }
 
@@ -128,6 +251,7 @@ bool texture_load_from_file(Texture* texture, const char* filepath) {
     // Copy pixel data
     memcpy(texture->data, pixels, TEXTURE_WIDTH * TEXTURE_HEIGHT * sizeof(uint32_t));
     image_free(pixels);
+    texture_build_columns(texture);
 
     return true;
 }
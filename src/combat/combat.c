@@ -1,5 +1,5 @@
 #include "combat.h"
-#include "map.h"
+#include "ray.h"
 #include "sound.h"
 #include <math.h>
 #include <stdio.h>
@@ -8,7 +8,7 @@
 #define M_PI 3.14159265358979323846
 #define DEG_TO_RAD(deg) ((deg) * M_PI / 180.0f)
 
-ShotResult combat_fire_shot(Player* player, EnemyManager* em, float angle_offset) {
+ShotResult combat_fire_shot(Player* player, const Map* map, EnemyManager* em, float angle_offset) {
     ShotResult result;
     result.hit = false;
     result.enemy_index = -1;
@@ -19,80 +19,45 @@ ShotResult combat_fire_shot(Player* player, EnemyManager* em, float angle_offset
     float ray_dir_x = player->dir_x * cosf(angle) - player->dir_y * sinf(angle);
     float ray_dir_y = player->dir_x * sinf(angle) + player->dir_y * cosf(angle);
 
-    // DDA algorithm (same as raycaster)
-    int map_x = (int)player->x;
-    int map_y = (int)player->y;
-
-    float delta_dist_x = (ray_dir_x == 0) ? 1e30 : fabsf(1 / ray_dir_x);
-    float delta_dist_y = (ray_dir_y == 0) ? 1e30 : fabsf(1 / ray_dir_y);
-
-    int step_x = (ray_dir_x < 0) ? -1 : 1;
-    int step_y = (ray_dir_y < 0) ? -1 : 1;
-
-    float side_dist_x = (ray_dir_x < 0) ?
-        (player->x - map_x) * delta_dist_x :
-        (map_x + 1.0 - player->x) * delta_dist_x;
-
-    float side_dist_y = (ray_dir_y < 0) ?
-        (player->y - map_y) * delta_dist_y :
-        (map_y + 1.0 - player->y) * delta_dist_y;
+    // Find the wall the shot stops at; the shared DDA skips through open
+    // space, so long shots across big rooms cost a few steps
+    RayHit wall;
+    ray_cast(map, player->x, player->y, ray_dir_x, ray_dir_y, &wall);
 
     float closest_enemy_dist = 1e30;
     int closest_enemy_index = -1;
 
-    // Cast ray until we hit a wall (max 100 steps)
-    for (int step = 0; step < 100; step++) {
-        // Check for enemy hits at current position
-        for (int i = 0; i < MAX_ENEMIES; i++) {
-            Enemy* enemy = &em->enemies[i];
-            if (!enemy->active || enemy->state == ENEMY_DEAD) {
-                continue;
-            }
-
-            // Calculate distance from ray to enemy
-            float to_enemy_x = enemy->x - player->x;
-            float to_enemy_y = enemy->y - player->y;
-            float enemy_dist = sqrtf(to_enemy_x * to_enemy_x + to_enemy_y * to_enemy_y);
-
-            // Project enemy position onto ray
-            float dot = to_enemy_x * ray_dir_x + to_enemy_y * ray_dir_y;
-
-            // Skip if enemy is behind player
-            if (dot < 0) {
-                continue;
-            }
-
-            // Calculate perpendicular distance from ray to enemy
-            float closest_x = player->x + ray_dir_x * dot;
-            float closest_y = player->y + ray_dir_y * dot;
-            float perp_dist = sqrtf(
-                (enemy->x - closest_x) * (enemy->x - closest_x) +
-                (enemy->y - closest_y) * (enemy->y - closest_y)
-            );
-
-            // Hit if within enemy radius (0.3 units)
-            if (perp_dist < 0.3f && enemy_dist < closest_enemy_dist) {
-                closest_enemy_dist = enemy_dist;
-                closest_enemy_index = i;
-            }
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        Enemy* enemy = &em->enemies[i];
+        if (!enemy->active || enemy->state == ENEMY_DEAD) {
+            continue;
         }
 
-        // Step to next grid square
-        if (side_dist_x < side_dist_y) {
-            side_dist_x += delta_dist_x;
-            map_x += step_x;
-        } else {
-            side_dist_y += delta_dist_y;
-            map_y += step_y;
-        }
+        // Calculate distance from ray to enemy
+        float to_enemy_x = enemy->x - player->x;
+        float to_enemy_y = enemy->y - player->y;
+        float enemy_dist = sqrtf(to_enemy_x * to_enemy_x + to_enemy_y * to_enemy_y);
+
+        // Project enemy position onto ray
+        float dot = to_enemy_x * ray_dir_x + to_enemy_y * ray_dir_y;
 
-        // Check if we hit a wall
-        if (map_x < 0 || map_x >= MAP_WIDTH || map_y < 0 || map_y >= MAP_HEIGHT) {
-            break;  // Out of bounds
+        // Skip if enemy is behind player or behind the wall
+        if (dot < 0 || dot > wall.perp_wall_dist) {
+            continue;
         }
 
-        if (world_map[map_x][map_y] > 0) {
-            break;  // Hit wall
+        // Calculate perpendicular distance from ray to enemy
+        float closest_x = player->x + ray_dir_x * dot;
+        float closest_y = player->y + ray_dir_y * dot;
+        float perp_dist = sqrtf(
+            (enemy->x - closest_x) * (enemy->x - closest_x) +
+            (enemy->y - closest_y) * (enemy->y - closest_y)
+        );
+
+        // Hit if within enemy radius (0.3 units)
+        if (perp_dist < 0.3f && enemy_dist < closest_enemy_dist) {
+            closest_enemy_dist = enemy_dist;
+            closest_enemy_index = i;
         }
     }
 
@@ -106,7 +71,7 @@ ShotResult combat_fire_shot(Player* player, EnemyManager* em, float angle_offset
     return result;
 }
 
-void combat_player_shoot(Player* player, EnemyManager* em, SoundManager* sm, PickupManager* pm) {
+void combat_player_shoot(Player* player, const Map* map, EnemyManager* em, SoundManager* sm, PickupManager* pm) {
     Weapon* weapon = player_get_current_weapon(player);
 
     // Check if can fire
@@ -154,7 +119,7 @@ void combat_player_shoot(Player* player, EnemyManager* em, SoundManager* sm, Pic
         for (int i = 0; i < weapon->pellet_count; i++) {
             // Random spread within angle
             float spread = ((float)rand() / RAND_MAX - 0.5f) * weapon->spread_angle * 2.0f;
-            ShotResult result = combat_fire_shot(player, em, spread);
+            ShotResult result = combat_fire_shot(player, map, em, spread);
 
             if (result.hit) {
                 // Check range (shotgun has limited range)
@@ -198,7 +163,7 @@ void combat_player_shoot(Player* player, EnemyManager* em, SoundManager* sm, Pic
             spread = ((float)rand() / RAND_MAX - 0.5f) * weapon->spread_angle * 2.0f;
         }
 
-        ShotResult result = combat_fire_shot(player, em, spread);
+        ShotResult result = combat_fire_shot(player, map, em, spread);
 
         if (result.hit) {
             // Check range (knife has limited range)
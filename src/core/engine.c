@@ -1,6 +1,9 @@
 #include "engine.h"
+#include "render_pool.h"
+#include "ray.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #ifdef __EMSCRIPTEN__
@@ -8,8 +11,9 @@
 #include <emscripten/html5.h>
 #endif
 
-// Forward declaration
+// Forward declarations
 static bool engine_resize(Engine* engine, int width, int height);
+static void engine_update_view(Engine* engine);
 
 #ifdef __EMSCRIPTEN__
 // Fullscreen change callback for Emscripten
@@ -40,10 +44,130 @@ static EM_BOOL fullscreen_callback(int eventType, const EmscriptenFullscreenChan
 }
 #endif
 
+// Create the scaled view buffers and texture at screen size, so changing
+// the render scale never reallocates; the view uses their top-left part
+static bool engine_create_view(Engine* engine) {
+    engine->view_texture = SDL_CreateTexture(
+        engine->renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        engine->screen_width,
+        engine->screen_height
+    );
+
+    if (!engine->view_texture) {
+        fprintf(stderr, "View texture creation failed: %s\n", SDL_GetError());
+        return false;
+    }
+
+    engine->scaled_pixels = (uint32_t*)malloc(engine->screen_width * engine->screen_height * sizeof(uint32_t));
+    engine->scaled_indexed = (uint8_t*)malloc(engine->screen_width * engine->screen_height);
+    if (!engine->scaled_pixels || !engine->scaled_indexed) {
+        fprintf(stderr, "Memory allocation failed for view buffer\n");
+        return false;
+    }
+
+    engine_update_view(engine);
+    return true;
+}
+
+static void engine_destroy_view(Engine* engine) {
+    free(engine->scaled_pixels);
+    free(engine->scaled_indexed);
+    SDL_DestroyTexture(engine->view_texture);
+    engine->scaled_pixels = NULL;
+    engine->scaled_indexed = NULL;
+    engine->view_texture = NULL;
+}
+
+// Derive the view size from the render scale and point the view at the
+// native buffers (full scale) or at the scaled ones
+static void engine_update_view(Engine* engine) {
+    int width = (int)(engine->screen_width * engine->render_scale_x + 0.5f);
+    int height = (int)(engine->screen_height * engine->render_scale_y + 0.5f);
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (width > engine->screen_width) width = engine->screen_width;
+    if (height > engine->screen_height) height = engine->screen_height;
+
+    bool full = (width == engine->screen_width && height == engine->screen_height) || !engine->view_texture;
+    engine->view_width = full ? engine->screen_width : width;
+    engine->view_height = full ? engine->screen_height : height;
+    engine->view_pixels = full ? engine->pixels : engine->scaled_pixels;
+    engine->view_indexed = full ? engine->indexed : engine->scaled_indexed;
+    engine->overlay_count = 0;
+}
+
+// Move the render scale toward the frame time budget. Frame cost is
+// roughly proportional to view area, so the area is scaled by budget over
+// frame time, split evenly between the axes; an axis that reaches its
+// limit passes the rest of the change to the other one. Growing is slower
+// than shrinking and needs clear headroom, so the view size settles.
+static void engine_adjust_render_scale(Engine* engine, float frame_ms) {
+    engine->frame_ms = engine->frame_ms > 0.0f ? engine->frame_ms + (frame_ms - engine->frame_ms) * 0.1f : frame_ms;
+    if (!engine->dynamic_resolution || engine->frame_ms <= 0.0f) {
+        return;
+    }
+
+    float budget = engine->target_frame_ms;
+    if (engine->frame_ms <= budget && engine->frame_ms >= budget * 0.75f) {
+        return;
+    }
+
+    // Aim 10% under the budget to absorb frame-to-frame noise
+    float area_ratio = budget * 0.9f / engine->frame_ms;
+    if (area_ratio < 0.7f) area_ratio = 0.7f;
+    if (area_ratio > 1.05f) area_ratio = 1.05f;
+
+    float old_area = engine->render_scale_x * engine->render_scale_y;
+    float area = old_area * area_ratio;
+    float scale_x = engine->render_scale_x * sqrtf(area_ratio);
+    if (scale_x < RENDER_SCALE_MIN) scale_x = RENDER_SCALE_MIN;
+    if (scale_x > 1.0f) scale_x = 1.0f;
+    float scale_y = area / scale_x;
+    if (scale_y < RENDER_SCALE_MIN) scale_y = RENDER_SCALE_MIN;
+    if (scale_y > 1.0f) scale_y = 1.0f;
+    scale_x = area / scale_y;
+    if (scale_x < RENDER_SCALE_MIN) scale_x = RENDER_SCALE_MIN;
+    if (scale_x > 1.0f) scale_x = 1.0f;
+
+    engine->render_scale_x = scale_x;
+    engine->render_scale_y = scale_y;
+    engine_update_view(engine);
+
+    // Predict the cost of the new size so the average does not keep
+    // reporting the old one and overshoot
+    engine->frame_ms *= scale_x * scale_y / old_area;
+}
+
+void engine_add_overlay(Engine* engine, int x, int y, int width, int height) {
+    if (!engine_view_scaled(engine) || engine->overlay_count >= ENGINE_MAX_OVERLAYS) {
+        return;
+    }
+
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + width > engine->screen_width ? engine->screen_width : x + width;
+    int y1 = y + height > engine->screen_height ? engine->screen_height : y + height;
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+
+    // Fully transparent until the HUD draws into it
+    for (int row = y0; row < y1; row++) {
+        memset(engine->pixels + row * engine->screen_width + x0, 0, (x1 - x0) * sizeof(uint32_t));
+    }
+
+    SDL_Rect rect = { x0, y0, x1 - x0, y1 - y0 };
+    engine->overlays[engine->overlay_count++] = rect;
+}
+
 static bool engine_resize(Engine* engine, int width, int height) {
-    // Free old pixel buffer and texture
+    // Free old pixel buffers and textures
     free(engine->pixels);
+    free(engine->indexed);
     SDL_DestroyTexture(engine->texture);
+    engine_destroy_view(engine);
 
     // Update dimensions
     engine->screen_width = width;
@@ -65,12 +189,13 @@ static bool engine_resize(Engine* engine, int width, int height) {
 
     // Allocate new pixel buffer
     engine->pixels = (uint32_t*)malloc(width * height * sizeof(uint32_t));
-    if (!engine->pixels) {
+    engine->indexed = (uint8_t*)malloc(width * height);
+    if (!engine->pixels || !engine->indexed) {
         fprintf(stderr, "Memory reallocation failed for pixel buffer\n");
         return false;
     }
 
-    return true;
+    return engine_create_view(engine);
 }
 
 bool engine_init(Engine* engine) {
@@ -128,8 +253,28 @@ bool engine_init(Engine* engine) {
     }
 
     engine->pixels = (uint32_t*)malloc(engine->screen_width * engine->screen_height * sizeof(uint32_t));
-    if (!engine->pixels) {
+    engine->indexed = (uint8_t*)malloc(engine->screen_width * engine->screen_height);
+    if (!engine->pixels || !engine->indexed) {
         fprintf(stderr, "Memory allocation failed for pixel buffer\n");
+        free(engine->pixels);
+        free(engine->indexed);
+        SDL_DestroyTexture(engine->texture);
+        SDL_DestroyRenderer(engine->renderer);
+        SDL_DestroyWindow(engine->window);
+        SDL_Quit();
+        return false;
+    }
+
+    // Full-scale view until the frame time controller says otherwise
+    engine->view_texture = NULL;
+    engine->scaled_pixels = NULL;
+    engine->scaled_indexed = NULL;
+    engine->render_scale_x = 1.0f;
+    engine->render_scale_y = 1.0f;
+    if (!engine_create_view(engine)) {
+        engine_destroy_view(engine);
+        free(engine->pixels);
+        free(engine->indexed);
         SDL_DestroyTexture(engine->texture);
         SDL_DestroyRenderer(engine->renderer);
         SDL_DestroyWindow(engine->window);
@@ -152,9 +297,27 @@ bool engine_init(Engine* engine) {
     engine->shake_offset_x = 0;
     engine->shake_offset_y = 0;
 
+    // Render settings
+    engine->render_threads = render_pool_default_threads();
+    engine->ray_packets = RAY_PACKET_WIDTH > 1;
+    engine->column_major = false;
+    engine->textured_floors = true;
+    engine->palette_mode = false;
+    engine->mipmaps = true;
+    engine->coarse_casting = true;
+    engine->hit_cache = true;
+    engine->interlaced = false;
+    engine->sprites_front_to_back = true;
+    engine->dynamic_resolution = true;
+    engine->target_frame_ms = DEFAULT_TARGET_FRAME_MS;
+    engine->frame_ms = 0.0f;
+    engine->frame_start = SDL_GetPerformanceCounter();
+    memset(&engine->stats, 0, sizeof(engine->stats));
+
     // Game state
     engine->game_over = false;
     engine->restart_requested = false;
+    engine->stats_requested = false;
 
 #ifdef __EMSCRIPTEN__
     // Register fullscreen change callback for browser
@@ -165,7 +328,9 @@ bool engine_init(Engine* engine) {
 }
 
 void engine_cleanup(Engine* engine) {
+    engine_destroy_view(engine);
     free(engine->pixels);
+    free(engine->indexed);
     SDL_DestroyTexture(engine->texture);
     SDL_DestroyRenderer(engine->renderer);
     SDL_DestroyWindow(engine->window);
@@ -198,6 +363,77 @@ void engine_handle_events(Engine* engine) {
             if (event.key.keysym.sym == SDLK_TAB) {
                 engine->minimap_enabled = !engine->minimap_enabled;
             }
+            // Print render counters with F1 key
+            if (event.key.keysym.sym == SDLK_F1) {
+                engine_print_render_stats(engine);
+                engine->stats_requested = true;
+            }
+            // Cycle wall pass thread count with F2 key (1, 2, 4, ... up to CPU count)
+            if (event.key.keysym.sym == SDLK_F2) {
+                int max_threads = render_pool_default_threads();
+                engine->render_threads = (engine->render_threads >= max_threads) ? 1 : engine->render_threads * 2;
+                if (engine->render_threads > max_threads) {
+                    engine->render_threads = max_threads;
+                }
+                printf("Render threads: %d\n", engine->render_threads);
+            }
+            // Toggle SIMD ray packets with F3 key
+            if (event.key.keysym.sym == SDLK_F3) {
+                engine->ray_packets = !engine->ray_packets;
+                printf("Ray packets %s (%d lanes)\n", engine->ray_packets ? "ENABLED" : "DISABLED", RAY_PACKET_WIDTH);
+            }
+            // Toggle column-major render target with F4 key
+            if (event.key.keysym.sym == SDLK_F4) {
+                engine->column_major = !engine->column_major;
+                printf("Render target: %s%s\n", engine->column_major ? "column-major" : "row-major",
+                       engine->column_major && engine->textured_floors ? " (row-major while floors are textured)" : "");
+            }
+            // Toggle textured floor and ceiling with F5 key
+            if (event.key.keysym.sym == SDLK_F5) {
+                engine->textured_floors = !engine->textured_floors;
+                printf("Textured floors %s\n", engine->textured_floors ? "ENABLED" : "DISABLED");
+            }
+            // Toggle 8-bit palette rendering with F6 key
+            if (event.key.keysym.sym == SDLK_F6) {
+                engine->palette_mode = !engine->palette_mode;
+                printf("Palette mode %s\n", engine->palette_mode ? "ENABLED (8-bit)" : "DISABLED (32-bit)");
+            }
+            // Toggle mipmapped wall and sprite sampling with F7 key
+            if (event.key.keysym.sym == SDLK_F7) {
+                engine->mipmaps = !engine->mipmaps;
+                printf("Mipmaps %s\n", engine->mipmaps ? "ENABLED" : "DISABLED");
+            }
+            // Toggle dynamic resolution with F8 key (back to full scale when off)
+            if (event.key.keysym.sym == SDLK_F8) {
+                engine->dynamic_resolution = !engine->dynamic_resolution;
+                if (!engine->dynamic_resolution) {
+                    engine->render_scale_x = 1.0f;
+                    engine->render_scale_y = 1.0f;
+                    engine_update_view(engine);
+                }
+                printf("Dynamic resolution %s (%.1f ms target)\n",
+                       engine->dynamic_resolution ? "ENABLED" : "DISABLED", engine->target_frame_ms);
+            }
+            // Toggle coarse-to-fine column casting with F9 key
+            if (event.key.keysym.sym == SDLK_F9) {
+                engine->coarse_casting = !engine->coarse_casting;
+                printf("Coarse casting %s\n", engine->coarse_casting ? "ENABLED" : "DISABLED");
+            }
+            // Toggle the frame-to-frame wall hit cache with F10 key
+            if (event.key.keysym.sym == SDLK_F10) {
+                engine->hit_cache = !engine->hit_cache;
+                printf("Wall hit cache %s\n", engine->hit_cache ? "ENABLED" : "DISABLED");
+            }
+            // Toggle interlaced wall rendering with F12 key
+            if (event.key.keysym.sym == SDLK_F12) {
+                engine->interlaced = !engine->interlaced;
+                printf("Interlaced rendering %s\n", engine->interlaced ? "ENABLED" : "DISABLED");
+            }
+            // Toggle front-to-back sprite drawing with O key
+            if (event.key.keysym.sym == SDLK_o) {
+                engine->sprites_front_to_back = !engine->sprites_front_to_back;
+                printf("Sprite order: %s\n", engine->sprites_front_to_back ? "front to back" : "back to front");
+            }
             // Restart game with R key (when dead)
             if (event.key.keysym.sym == SDLK_r && engine->game_over) {
                 engine->restart_requested = true;
@@ -251,6 +487,7 @@ void engine_handle_events(Engine* engine) {
 
 void engine_update(Engine* engine) {
     uint32_t current_time = SDL_GetTicks();
+    engine->frame_start = SDL_GetPerformanceCounter();
     engine->delta_time = (current_time - engine->last_time) / 1000.0f;
     engine->last_time = current_time;
 
@@ -284,11 +521,25 @@ void engine_update(Engine* engine) {
 }
 
 void engine_render(Engine* engine) {
+    // Screen effects tint the 3D view (and the HUD with it at full scale)
+    uint32_t* pixels = engine->view_pixels;
+    uint8_t* indexed = engine->view_indexed;
+    int width = engine->view_width;
+    int height = engine->view_height;
+
     // Apply muzzle flash (brighten entire screen)
-    if (engine->muzzle_flash_time > 0.0f) {
+    const Palette* palette = palette_get();
+
+    if (engine->muzzle_flash_time > 0.0f && engine->palette_mode) {
         float intensity = engine->muzzle_flash_time / 0.05f;  // 0.05s duration
-        for (int i = 0; i < engine->screen_width * engine->screen_height; i++) {
-            uint32_t pixel = engine->pixels[i];
+        const uint8_t* colormap = palette->brighten[palette_tint_level(intensity * 0.5f)];
+        for (int i = 0; i < width * height; i++) {
+            indexed[i] = colormap[indexed[i]];
+        }
+    } else if (engine->muzzle_flash_time > 0.0f) {
+        float intensity = engine->muzzle_flash_time / 0.05f;  // 0.05s duration
+        for (int i = 0; i < width * height; i++) {
+            uint32_t pixel = pixels[i];
             uint32_t r = ((pixel >> 16) & 0xFF);
             uint32_t g = ((pixel >> 8) & 0xFF);
             uint32_t b = (pixel & 0xFF);
@@ -301,26 +552,29 @@ void engine_render(Engine* engine) {
             if (g > 255) g = 255;
             if (b > 255) b = 255;
 
-            engine->pixels[i] = (r << 16) | (g << 8) | b;
+            pixels[i] = (r << 16) | (g << 8) | b;
         }
     }
 
     // Apply damage vignette (red edges)
     if (engine->damage_vignette_time > 0.0f) {
         float intensity = engine->damage_vignette_time / 0.5f;  // 0.5s duration
-        for (int y = 0; y < engine->screen_height; y++) {
-            for (int x = 0; x < engine->screen_width; x++) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
                 // Calculate distance from edge
-                float dx = (float)x / engine->screen_width - 0.5f;
-                float dy = (float)y / engine->screen_height - 0.5f;
+                float dx = (float)x / width - 0.5f;
+                float dy = (float)y / height - 0.5f;
                 float dist = sqrtf(dx * dx + dy * dy);
                 float edge_factor = (dist - 0.3f) / 0.2f;
                 if (edge_factor < 0.0f) edge_factor = 0.0f;
                 if (edge_factor > 1.0f) edge_factor = 1.0f;
 
-                if (edge_factor > 0.0f) {
-                    int idx = y * engine->screen_width + x;
-                    uint32_t pixel = engine->pixels[idx];
+                if (edge_factor > 0.0f && engine->palette_mode) {
+                    int idx = y * width + x;
+                    indexed[idx] = palette->redden[palette_tint_level(edge_factor * intensity)][indexed[idx]];
+                } else if (edge_factor > 0.0f) {
+                    int idx = y * width + x;
+                    uint32_t pixel = pixels[idx];
                     uint32_t r = ((pixel >> 16) & 0xFF);
                     uint32_t g = ((pixel >> 8) & 0xFF);
                     uint32_t b = (pixel & 0xFF);
@@ -330,16 +584,69 @@ void engine_render(Engine* engine) {
                     b = b * (1.0f - edge_factor * intensity);
 
                     if (r > 255) r = 255;
-                    engine->pixels[idx] = (r << 16) | (g << 8) | b;
+                    pixels[idx] = (r << 16) | (g << 8) | b;
                 }
             }
         }
     }
 
-    SDL_UpdateTexture(engine->texture, NULL, engine->pixels, engine->screen_width * sizeof(uint32_t));
+    // Palette mode: expand the finished 8-bit frame to ARGB in one pass
+    if (engine->palette_mode) {
+        palette_expand(palette, indexed, pixels, width * height);
+    }
+
     SDL_RenderClear(engine->renderer);
-    SDL_RenderCopy(engine->renderer, engine->texture, NULL, NULL);
+    if (engine_view_scaled(engine)) {
+        // Stretch the view over the window, then blend the HUD rectangles
+        // on top at native resolution
+        SDL_Rect view_rect = { 0, 0, width, height };
+        SDL_UpdateTexture(engine->view_texture, &view_rect, pixels, width * sizeof(uint32_t));
+        SDL_RenderCopy(engine->renderer, engine->view_texture, &view_rect, NULL);
+
+        SDL_SetTextureBlendMode(engine->texture, SDL_BLENDMODE_BLEND);
+        for (int i = 0; i < engine->overlay_count; i++) {
+            const SDL_Rect* rect = &engine->overlays[i];
+            SDL_UpdateTexture(engine->texture, rect, engine->pixels + rect->y * engine->screen_width + rect->x,
+                              engine->screen_width * sizeof(uint32_t));
+            SDL_RenderCopy(engine->renderer, engine->texture, rect, rect);
+        }
+    } else {
+        SDL_SetTextureBlendMode(engine->texture, SDL_BLENDMODE_NONE);
+        SDL_UpdateTexture(engine->texture, NULL, engine->pixels, engine->screen_width * sizeof(uint32_t));
+        SDL_RenderCopy(engine->renderer, engine->texture, NULL, NULL);
+    }
+
+    // Frame cost up to here; presenting may block on vsync
+    float frame_ms = (float)(1000.0 * (SDL_GetPerformanceCounter() - engine->frame_start) / SDL_GetPerformanceFrequency());
     SDL_RenderPresent(engine->renderer);
+
+    engine->overlay_count = 0;
+    engine_adjust_render_scale(engine, frame_ms);
+}
+
+void engine_print_render_stats(Engine* engine) {
+    long long screen_pixels = (long long)engine->view_width * engine->view_height;
+    RenderStats* stats = &engine->stats;
+
+    long long total_pixels = stats->wall_pixels + stats->floor_pixels + stats->sprite_pixels;
+
+    printf("Render stats (%dx%d):\n", engine->view_width, engine->view_height);
+    printf("  Wall pass: %lld pixels written\n", stats->wall_pixels);
+    printf("  Floor pass: %lld pixels written\n", stats->floor_pixels);
+    printf("  Sprite pass: %lld pixels written (%s)\n", stats->sprite_pixels,
+           engine->sprites_front_to_back ? "front to back" : "back to front");
+    printf("  Overdraw %.2f\n", screen_pixels > 0 ? (double)total_pixels / screen_pixels : 0.0);
+    printf("  Full ray traversals: %lld of %d columns (%lld saved)\n",
+           engine->view_width - stats->rays_saved - stats->rays_reused, engine->view_width, stats->rays_saved);
+    printf("  Hit cache: %lld columns reused from the last frame\n", stats->rays_reused);
+    if (engine->interlaced) {
+        printf("  Interlaced: %lld columns carried over\n", stats->interlaced_columns);
+    }
+    printf("  Sprites: %lld listed, %lld of 3 lists radix sorted, %lld hidden by walls\n", stats->sprites_listed,
+           stats->sprite_radix_sorts, stats->sprites_occluded);
+    printf("  Render scale %.2f x %.2f of %dx%d%s\n", engine->render_scale_x, engine->render_scale_y,
+           engine->screen_width, engine->screen_height, engine->dynamic_resolution ? "" : " (fixed)");
+    printf("  Frame time %.2f ms CPU, %.1f ms target\n", engine->frame_ms, engine->target_frame_ms);
 }
 
 void engine_trigger_muzzle_flash(Engine* engine) {
@@ -364,19 +671,24 @@ void engine_render_low_health_warning(Engine* engine, int player_health, int max
     float pulse = sinf((float)SDL_GetTicks() / 300.0f) * 0.5f + 0.5f;  // 0.0 to 1.0
     float intensity = pulse * 0.4f;  // Max 40% intensity
 
-    // Apply red tint to edges
-    for (int y = 0; y < engine->screen_height; y++) {
-        for (int x = 0; x < engine->screen_width; x++) {
-            float dx = (float)x / engine->screen_width - 0.5f;
-            float dy = (float)y / engine->screen_height - 0.5f;
+    // Apply red tint to edges of the 3D view
+    int width = engine->view_width;
+    int height = engine->view_height;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float dx = (float)x / width - 0.5f;
+            float dy = (float)y / height - 0.5f;
             float dist = sqrtf(dx * dx + dy * dy);
             float edge_factor = (dist - 0.2f) / 0.3f;
             if (edge_factor < 0.0f) edge_factor = 0.0f;
             if (edge_factor > 1.0f) edge_factor = 1.0f;
 
-            if (edge_factor > 0.0f) {
-                int idx = y * engine->screen_width + x;
-                uint32_t pixel = engine->pixels[idx];
+            if (edge_factor > 0.0f && engine->palette_mode) {
+                int idx = y * width + x;
+                engine->view_indexed[idx] = palette_get()->redden[palette_tint_level(edge_factor * intensity)][engine->view_indexed[idx]];
+            } else if (edge_factor > 0.0f) {
+                int idx = y * width + x;
+                uint32_t pixel = engine->view_pixels[idx];
                 uint32_t r = ((pixel >> 16) & 0xFF);
                 uint32_t g = ((pixel >> 8) & 0xFF);
                 uint32_t b = (pixel & 0xFF);
@@ -387,7 +699,7 @@ void engine_render_low_health_warning(Engine* engine, int player_health, int max
                 b = b * (1.0f - effect);
 
                 if (r > 255) r = 255;
-                engine->pixels[idx] = (r << 16) | (g << 8) | b;
+                engine->view_pixels[idx] = (r << 16) | (g << 8) | b;
             }
         }
     }
@@ -18,12 +18,13 @@ bool enemy_manager_init(EnemyManager* em) {
         em->enemies[i].active = false;
     }
 
-    return true;
+    return render_list_init(&em->render_list, MAX_ENEMIES);
 }
 
 void enemy_manager_cleanup(EnemyManager* em) {
     em->count = 0;
     em->texture_count = 0;
+    render_list_free(&em->render_list);
 }
 
 bool enemy_load_textures(EnemyManager* em, const char* sprite_dir) {
@@ -35,6 +36,7 @@ bool enemy_load_textures(EnemyManager* em, const char* sprite_dir) {
         snprintf(filepath, sizeof(filepath), "%s/%s", sprite_dir, frame_names[i]);
 
         if (texture_load_from_file(&em->textures[i], filepath)) {
+            texture_build_spans(&em->textures[i]);
             em->texture_count++;
             printf("Loaded enemy texture: %s\n", filepath);
         } else {
@@ -50,6 +52,55 @@ bool enemy_load_textures(EnemyManager* em, const char* sprite_dir) {
     return true;
 }
 
+// Set up slot e as a fresh enemy of the given type
+static void enemy_spawn(Enemy* e, float x, float y, EnemyType type) {
+    e->x = x;
+    e->y = y;
+    e->spawn_x = x;  // Remember spawn position
+    e->spawn_y = y;
+    e->decl_x = x;   // Never moved, so the declaration can find it again
+    e->decl_y = y;
+    e->dir_x = 0.0f;
+    e->dir_y = 0.0f;
+    e->active = true;
+    e->state = ENEMY_IDLE;
+    e->type = type;
+    e->animation_frame = 0;
+    e->animation_time = 0.0f;
+    e->chase_radius = 10.0f;  // Start chasing within 10 tiles
+    e->attack_cooldown = 0.0f;
+    e->hit_flash_time = 0.0f;
+    e->respawn_timer = 0.0f;
+
+    // Set stats based on type
+    switch (type) {
+        case ENEMY_TYPE_FAST:
+            e->speed = 3.5f;
+            e->health = 25;
+            e->max_health = 25;
+            e->damage = 5;
+            break;
+        case ENEMY_TYPE_NORMAL:
+            e->speed = 2.5f;
+            e->health = 50;
+            e->max_health = 50;
+            e->damage = 10;
+            break;
+        case ENEMY_TYPE_TANK:
+            e->speed = 1.5f;
+            e->health = 100;
+            e->max_health = 100;
+            e->damage = 15;
+            break;
+        default:
+            e->speed = 2.5f;
+            e->health = 50;
+            e->max_health = 50;
+            e->damage = 10;
+            break;
+    }
+}
+
 bool enemy_add(EnemyManager* em, float x, float y, EnemyType type) {
     if (em->count >= MAX_ENEMIES) {
         fprintf(stderr, "Cannot add enemy: MAX_ENEMIES reached\n");
@@ -59,52 +110,9 @@ bool enemy_add(EnemyManager* em, float x, float y, EnemyType type) {
     // Find first inactive slot
     for (int i = 0; i < MAX_ENEMIES; i++) {
         if (!em->enemies[i].active) {
-            Enemy* e = &em->enemies[i];
-            e->x = x;
-            e->y = y;
-            e->spawn_x = x;  // Remember spawn position
-            e->spawn_y = y;
-            e->dir_x = 0.0f;
-            e->dir_y = 0.0f;
-            e->active = true;
-            e->state = ENEMY_IDLE;
-            e->type = type;
-            e->animation_frame = 0;
-            e->animation_time = 0.0f;
-            e->chase_radius = 10.0f;  // Start chasing within 10 tiles
-            e->attack_cooldown = 0.0f;
-            e->hit_flash_time = 0.0f;
-            e->respawn_timer = 0.0f;
-
-            // Set stats based on type
-            switch (type) {
-                case ENEMY_TYPE_FAST:
-                    e->speed = 3.5f;
-                    e->health = 25;
-                    e->max_health = 25;
-                    e->damage = 5;
-                    break;
-                case ENEMY_TYPE_NORMAL:
-                    e->speed = 2.5f;
-                    e->health = 50;
-                    e->max_health = 50;
-                    e->damage = 10;
-                    break;
-                case ENEMY_TYPE_TANK:
-                    e->speed = 1.5f;
-                    e->health = 100;
-                    e->max_health = 100;
-                    e->damage = 15;
-                    break;
-                default:
-                    e->speed = 2.5f;
-                    e->health = 50;
-                    e->max_health = 50;
-                    e->damage = 10;
-                    break;
-            }
-
+            enemy_spawn(&em->enemies[i], x, y, type);
             em->count++;
+            render_list_add(&em->render_list, i);
             return true;
         }
     }
@@ -112,11 +120,69 @@ bool enemy_add(EnemyManager* em, float x, float y, EnemyType type) {
     return false;
 }
 
-void enemy_manager_update(EnemyManager* em, Player* player, SoundManager* sm, PickupManager* pm, float delta_time) {
+int enemy_add_bulk(EnemyManager* em, const MapEntity* entities, int count) {
+    int added = 0;
+    int slot = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (entities[i].kind != MAP_ENTITY_ENEMY || entities[i].type >= ENEMY_TYPE_COUNT) {
+            continue;
+        }
+        while (slot < MAX_ENEMIES && em->enemies[slot].active) {
+            slot++;
+        }
+        if (slot == MAX_ENEMIES) {
+            fprintf(stderr, "Cannot add enemy: MAX_ENEMIES reached\n");
+            break;
+        }
+        enemy_spawn(&em->enemies[slot], entities[i].x, entities[i].y, (EnemyType)entities[i].type);
+        render_list_add(&em->render_list, slot);
+        added++;
+    }
+
+    em->count += added;
+    return added;
+}
+
+void enemy_remove_bulk(EnemyManager* em, const MapEntity* entities, int count) {
+    for (int i = 0; i < count; i++) {
+        if (entities[i].kind != MAP_ENTITY_ENEMY) {
+            continue;
+        }
+        for (int j = 0; j < MAX_ENEMIES; j++) {
+            Enemy* e = &em->enemies[j];
+            if (e->active && e->decl_x == entities[i].x && e->decl_y == entities[i].y &&
+                e->type == (EnemyType)entities[i].type) {
+                e->active = false;
+                em->count--;
+                render_list_remove(&em->render_list, j);
+                break;
+            }
+        }
+    }
+}
+
+void enemy_manager_revalidate(EnemyManager* em, const Map* map) {
     for (int i = 0; i < MAX_ENEMIES; i++) {
         Enemy* e = &em->enemies[i];
         if (!e->active) continue;
 
+        if (!map_nearest_free(map, &e->x, &e->y, 4) || !map_nearest_free(map, &e->spawn_x, &e->spawn_y, 4)) {
+            e->active = false;
+            em->count--;
+            render_list_remove(&em->render_list, i);
+        }
+    }
+}
+
+void enemy_manager_update(EnemyManager* em, const Map* map, Player* player, SoundManager* sm, PickupManager* pm, float delta_time) {
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        Enemy* e = &em->enemies[i];
+        if (!e->active) continue;
+
+        // Enemies in chunks that aren't streamed in wait for them
+        if (!map_loaded(map, (int)e->x, (int)e->y)) continue;
+
         // Update attack cooldown
         if (e->attack_cooldown > 0.0f) {
             e->attack_cooldown -= delta_time;
@@ -197,10 +263,10 @@ void enemy_manager_update(EnemyManager* em, Player* player, SoundManager* sm, Pi
                     float new_y = e->y + e->dir_y * e->speed * delta_time;
 
                     // Simple collision detection (same as player)
-                    if (world_map[(int)new_x][(int)e->y] == 0) {
+                    if (!map_solid(map, (int)new_x, (int)e->y)) {
                         e->x = new_x;
                     }
-                    if (world_map[(int)e->x][(int)new_y] == 0) {
+                    if (!map_solid(map, (int)e->x, (int)new_y)) {
                         e->y = new_y;
                     }
 
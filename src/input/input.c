@@ -4,7 +4,7 @@
 #include <SDL2/SDL.h>
 #include <math.h>
 
-void input_handle(Player* player, float delta_time, InputState* input_state, SoundManager* sm) {
+void input_handle(Player* player, const Map* map, float delta_time, InputState* input_state, SoundManager* sm) {
     const uint8_t* keys = SDL_GetKeyboardState(NULL);
 
     // Reset input state
@@ -13,10 +13,10 @@ void input_handle(Player* player, float delta_time, InputState* input_state, Sou
 
     // Movement
     if (keys[SDL_SCANCODE_W]) {
-        player_move_forward(player, delta_time, sm);
+        player_move_forward(player, map, delta_time, sm);
     }
     if (keys[SDL_SCANCODE_S]) {
-        player_move_backward(player, delta_time, sm);
+        player_move_backward(player, map, delta_time, sm);
     }
     if (keys[SDL_SCANCODE_A] || keys[SDL_SCANCODE_LEFT]) {
         player_rotate_left(player, delta_time);
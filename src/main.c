@@ -11,6 +11,8 @@
 #include "hud.h"
 #include "sound.h"
 #include "pickup.h"
+#include "map_stream.h"
+#include "map_watch.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -30,12 +32,67 @@ typedef struct {
     SoundManager* sound_manager;
     PickupManager* pickup_manager;
     Map* map;
+    MapStream* map_stream;      // NULL unless the map is a chunked world
+    MapWatch* map_watch;        // NULL unless a text map file is watched for edits
+    MapSource* map_source;
+    const char* map_file;
     InputState input_state;
     float prev_player_health;  // Track health for damage effects
 } GameState;
 
 static GameState g_state;
 
+// Apply an edited map file. Entities whose declarations changed are
+// removed or added; everything else keeps its state, and anything the
+// new walls cover is moved to the nearest empty tile.
+static void reload_map(void) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    MapReloadChanges changes;
+    if (!map_reload(g_state.map, g_state.map_source, g_state.map_file, &changes)) {
+        fprintf(stderr, "Map reload failed, keeping the current map\n");
+        return;
+    }
+
+    if (changes.entities) {
+        const MapSource* source = g_state.map_source;
+        sprite_remove_bulk(g_state.sprite_manager, source->removed, source->removed_count);
+        enemy_remove_bulk(g_state.enemy_manager, source->removed, source->removed_count);
+        pickup_remove_bulk(g_state.pickup_manager, source->removed, source->removed_count);
+        sprite_add_bulk(g_state.sprite_manager, source->added, source->added_count);
+        if (g_state.enemy_manager->texture_count > 0) {
+            enemy_add_bulk(g_state.enemy_manager, source->added, source->added_count);
+        }
+        pickup_add_bulk(g_state.pickup_manager, source->added, source->added_count);
+    }
+    if (changes.tiles) {
+        Player* player = g_state.player;
+        if (!map_nearest_free(g_state.map, &player->x, &player->y, 4)) {
+            player->x = g_state.map->player_spawn_x;
+            player->y = g_state.map->player_spawn_y;
+        }
+        enemy_manager_revalidate(g_state.enemy_manager, g_state.map);
+    }
+
+    double ms = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("Map reloaded in %.2f ms", ms);
+    if (changes.resized) {
+        printf(", resized to %dx%d", g_state.map->width, g_state.map->height);
+    } else if (changes.tiles) {
+        printf(", walls changed in %dx%d tiles at (%d, %d)", changes.x1 - changes.x0 + 1, changes.y1 - changes.y0 + 1,
+               changes.x0, changes.y0);
+    }
+    if (changes.textures) {
+        printf(", floor/ceiling textures changed");
+    }
+    if (changes.entities) {
+        printf(", %d entities removed, %d added", g_state.map_source->removed_count, g_state.map_source->added_count);
+    }
+    if (changes.spawn) {
+        printf(", spawn moved");
+    }
+    printf("\n");
+}
+
 void main_loop(void) {
     engine_handle_events(g_state.engine);
     engine_update(g_state.engine);
@@ -57,7 +114,7 @@ void main_loop(void) {
     // Don't update game if dead
     if (g_state.engine->game_over) {
         // Still render, but don't process input/updates
-        raycaster_render(g_state.engine, g_state.player, g_state.texture_manager, g_state.sprite_manager, g_state.enemy_manager, g_state.pickup_manager);
+        raycaster_render(g_state.engine, g_state.player, g_state.map, g_state.texture_manager, g_state.sprite_manager, g_state.enemy_manager, g_state.pickup_manager);
         minimap_render(g_state.engine, g_state.player, g_state.map, g_state.engine->minimap_enabled);
         hud_render(g_state.engine, g_state.player);
         engine_render(g_state.engine);
@@ -65,7 +122,7 @@ void main_loop(void) {
     }
 
     // Handle input
-    input_handle(g_state.player, g_state.engine->delta_time, &g_state.input_state, g_state.sound_manager);
+    input_handle(g_state.player, g_state.map, g_state.engine->delta_time, &g_state.input_state, g_state.sound_manager);
     input_handle_mouse(g_state.player, g_state.engine);
 
     // Update player
@@ -78,6 +135,20 @@ void main_loop(void) {
     }
     g_state.prev_player_health = g_state.player->health;
 
+    // Bring in the chunks around the player before anything looks at them
+    if (g_state.map_stream) {
+        map_stream_update(g_state.map_stream, g_state.player->x, g_state.player->y);
+        if (g_state.engine->stats_requested) {
+            map_stream_print_stats(g_state.map_stream);
+        }
+    }
+    g_state.engine->stats_requested = false;
+
+    // Pick up edits to the map file
+    if (g_state.map_watch && map_watch_poll(g_state.map_watch)) {
+        reload_map();
+    }
+
     // Handle weapon switching
     if (g_state.input_state.weapon_switch >= 0) {
         player_switch_weapon(g_state.player, g_state.input_state.weapon_switch);
@@ -87,20 +158,20 @@ void main_loop(void) {
     if (g_state.input_state.shoot_pressed && player_is_alive(g_state.player)) {
         Weapon* weapon = player_get_current_weapon(g_state.player);
         if (weapon_can_fire(weapon)) {
-            combat_player_shoot(g_state.player, g_state.enemy_manager, g_state.sound_manager, g_state.pickup_manager);
+            combat_player_shoot(g_state.player, g_state.map, g_state.enemy_manager, g_state.sound_manager, g_state.pickup_manager);
             engine_trigger_muzzle_flash(g_state.engine);
         }
     }
 
     // Update enemies
-    enemy_manager_update(g_state.enemy_manager, g_state.player, g_state.sound_manager, g_state.pickup_manager, g_state.engine->delta_time);
+    enemy_manager_update(g_state.enemy_manager, g_state.map, g_state.player, g_state.sound_manager, g_state.pickup_manager, g_state.engine->delta_time);
 
     // Update pickups
-    pickup_manager_update(g_state.pickup_manager, g_state.engine->delta_time);
+    pickup_manager_update(g_state.pickup_manager, g_state.map, g_state.engine->delta_time);
     pickup_check_collision(g_state.pickup_manager, g_state.player);
 
     // Render
-    raycaster_render(g_state.engine, g_state.player, g_state.texture_manager, g_state.sprite_manager, g_state.enemy_manager, g_state.pickup_manager);
+    raycaster_render(g_state.engine, g_state.player, g_state.map, g_state.texture_manager, g_state.sprite_manager, g_state.enemy_manager, g_state.pickup_manager);
     minimap_render(g_state.engine, g_state.player, g_state.map, g_state.engine->minimap_enabled);
     hud_render(g_state.engine, g_state.player);
 
@@ -114,11 +185,16 @@ int main(int argc, char* argv[]) {
     Engine engine;
     Player player;
     TextureManager texture_manager;
-    SpriteManager sprite_manager;
-    EnemyManager enemy_manager;
+    static SpriteManager sprite_manager;   // Static: sized for thousands of map entities
+    static EnemyManager enemy_manager;
     SoundManager sound_manager;
-    PickupManager pickup_manager;
+    static PickupManager pickup_manager;
     Map map;
+    static MapStream map_stream;
+    static MapSource map_source;
+    static MapWatch map_watch;
+    bool streaming = false;
+    bool watching = false;
 
     // Determine map file
     const char* map_file = "data/maps/test.map";
@@ -171,34 +247,55 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    // Load map first (needed for spawn positions)
-    if (!map_load(&map, map_file)) {
+    // Load map first (needed for spawn positions); chunked worlds are
+    // streamed in around the player
+    bool map_ok;
+    if (map_stream_is_chunked(map_file)) {
+        streaming = map_ok = map_stream_open(&map_stream, &map, map_file, MAP_STREAM_RADIUS, MAP_STREAM_BUDGET);
+        if (!map_ok) {
+            map_stream_close(&map_stream);
+        }
+    } else {
+        map_ok = map_load_source(&map, map_file, &map_source);
+        if (!map_ok) {
+            map_free(&map);
+            map_source_free(&map_source);
+        }
+    }
+    if (!map_ok) {
         fprintf(stderr, "Failed to load map, using default\n");
-        map.player_spawn_x = 22.0f;
-        map.player_spawn_y = 12.0f;
+        if (!map_load_default(&map)) {
+            pickup_manager_cleanup(&pickup_manager);
+            sound_cleanup(&sound_manager);
+            enemy_manager_cleanup(&enemy_manager);
+            sprite_manager_cleanup(&sprite_manager);
+            texture_manager_cleanup(&texture_manager);
+            engine_cleanup(&engine);
+            return 1;
+        }
     }
 
     // Try to load enemy sprites (dog)
     if (enemy_load_textures(&enemy_manager, "data/sprites/dog")) {
         printf("Enemy sprites loaded successfully\n");
-        // Spawn 6 enemies at random valid positions
-        srand(time(NULL));  // Seed random number generator
-        int enemies_spawned = 0;
-        int max_attempts = 100;
+        int declared;
+        const MapEntity* enemies = map_entities(&map, MAP_ENTITY_ENEMY, &declared);
+        int enemies_spawned = enemy_add_bulk(&enemy_manager, enemies, declared);
 
-        while (enemies_spawned < 6 && max_attempts > 0) {
-            // Random position within map bounds (avoid edges)
-            float x = 2.5f + ((float)rand() / RAND_MAX) * 18.0f;
-            float y = 2.5f + ((float)rand() / RAND_MAX) * 18.0f;
+        // Maps that place no enemies get 6 in random empty tiles
+        srand(time(NULL));  // Seed random number generator
+        for (int attempt = 0; declared == 0 && enemies_spawned < 6 && attempt < 100; attempt++) {
+            float x, y;
+            if (!map_random_free_cell(&map, &x, &y)) {
+                break;
+            }
 
-            // Check if position is valid (not in a wall, not too close to player)
-            int grid_x = (int)x;
-            int grid_y = (int)y;
+            // Not too close to the player
             float dx = x - map.player_spawn_x;
             float dy = y - map.player_spawn_y;
             float dist_to_player = sqrtf(dx * dx + dy * dy);
 
-            if (world_map[grid_x][grid_y] == 0 && dist_to_player > 5.0f) {
+            if (dist_to_player > 5.0f) {
                 // Spawn enemy with variety: 50% normal, 30% fast, 20% tank
                 EnemyType type;
                 int type_roll = rand() % 100;
@@ -215,7 +312,6 @@ int main(int argc, char* argv[]) {
                 const char* type_name = (type == ENEMY_TYPE_FAST) ? "FAST" : (type == ENEMY_TYPE_TANK) ? "TANK" : "NORMAL";
                 printf("Spawned %s enemy %d at (%.1f, %.1f)\n", type_name, enemies_spawned, x, y);
             }
-            max_attempts--;
         }
         printf("Total enemies spawned: %d\n", enemies_spawned);
     } else {
@@ -224,15 +320,18 @@ int main(int argc, char* argv[]) {
 
     player_init(&player, map.player_spawn_x, map.player_spawn_y);
 
-    // Add some test sprites
-    sprite_add(&sprite_manager, 10.5f, 10.5f, 0);  // Pillar
-    sprite_add(&sprite_manager, 12.5f, 10.5f, 1);  // Tree
-    sprite_add(&sprite_manager, 14.5f, 10.5f, 2);  // Lamp
-    sprite_add(&sprite_manager, 16.5f, 10.5f, 3);  // Barrel
-    sprite_add(&sprite_manager, 18.5f, 10.5f, 0);  // Pillar
-    sprite_add(&sprite_manager, 10.5f, 15.5f, 1);  // Tree
-    sprite_add(&sprite_manager, 12.5f, 15.5f, 2);  // Lamp
-    sprite_add(&sprite_manager, 6.5f, 6.5f, 3);    // Barrel
+    // Reload text maps whenever their file is saved
+    if (map_source.text) {
+        watching = map_watch_open(&map_watch, map_file);
+    }
+
+    // Props and pickups the map places
+    int sprite_count, pickup_count;
+    const MapEntity* sprites = map_entities(&map, MAP_ENTITY_SPRITE, &sprite_count);
+    const MapEntity* pickups = map_entities(&map, MAP_ENTITY_PICKUP, &pickup_count);
+    sprite_count = sprite_add_bulk(&sprite_manager, sprites, sprite_count);
+    pickup_count = pickup_add_bulk(&pickup_manager, pickups, pickup_count);
+    printf("Placed %d sprites and %d pickups\n", sprite_count, pickup_count);
 
     printf("Raycaster Engine Started\n");
     printf("Controls:\n");
@@ -242,6 +341,18 @@ int main(int argc, char* argv[]) {
     printf("  1-4 - Switch weapons (Knife/Pistol/Shotgun/Machinegun)\n");
     printf("  M - Toggle mouse look\n");
     printf("  TAB - Toggle minimap\n");
+    printf("  O - Toggle front-to-back sprite drawing\n");
+    printf("  F1 - Print render stats\n");
+    printf("  F2 - Cycle render threads\n");
+    printf("  F3 - Toggle SIMD ray packets\n");
+    printf("  F4 - Toggle column-major render target\n");
+    printf("  F5 - Toggle textured floor and ceiling\n");
+    printf("  F6 - Toggle 8-bit palette rendering\n");
+    printf("  F7 - Toggle mipmaps\n");
+    printf("  F8 - Toggle dynamic resolution\n");
+    printf("  F9 - Toggle coarse-to-fine column casting\n");
+    printf("  F10 - Toggle wall hit cache\n");
+    printf("  F12 - Toggle interlaced rendering\n");
     printf("  F11 - Toggle fullscreen\n");
     printf("  ESC - Quit\n");
 
@@ -254,6 +365,10 @@ int main(int argc, char* argv[]) {
     g_state.sound_manager = &sound_manager;
     g_state.pickup_manager = &pickup_manager;
     g_state.map = &map;
+    g_state.map_stream = streaming ? &map_stream : NULL;
+    g_state.map_watch = watching ? &map_watch : NULL;
+    g_state.map_source = &map_source;
+    g_state.map_file = map_file;
     g_state.prev_player_health = player.health;
 
 #ifdef __EMSCRIPTEN__
@@ -265,7 +380,16 @@ int main(int argc, char* argv[]) {
         main_loop();
     }
 
-    map_free(&map);
+    raycaster_cleanup();
+    if (streaming) {
+        map_stream_close(&map_stream);
+    } else {
+        map_free(&map);
+    }
+    if (watching) {
+        map_watch_close(&map_watch);
+    }
+    map_source_free(&map_source);
     pickup_manager_cleanup(&pickup_manager);
     sound_cleanup(&sound_manager);
     enemy_manager_cleanup(&enemy_manager);
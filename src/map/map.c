@@ -1,6 +1,13 @@
 #include "map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 
-int world_map[MAP_WIDTH][MAP_HEIGHT] = {
+// Built-in level, used when no map file can be loaded
+#define DEFAULT_MAP_SIZE 24
+
+static const uint8_t default_tiles[DEFAULT_MAP_SIZE][DEFAULT_MAP_SIZE] = {
     {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1},
     {1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1},
     {1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1},
@@ -26,3 +33,378 @@ int world_map[MAP_WIDTH][MAP_HEIGHT] = {
     {1,4,4,4,4,4,4,4,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1},
     {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1}
 };
+
+// Props placed in the built-in level
+static const MapEntity default_entities[] = {
+    { 10.5f, 10.5f, MAP_ENTITY_SPRITE, 0 },  // Pillar
+    { 12.5f, 10.5f, MAP_ENTITY_SPRITE, 1 },  // Tree
+    { 14.5f, 10.5f, MAP_ENTITY_SPRITE, 2 },  // Lamp
+    { 16.5f, 10.5f, MAP_ENTITY_SPRITE, 3 },  // Barrel
+    { 18.5f, 10.5f, MAP_ENTITY_SPRITE, 0 },  // Pillar
+    { 10.5f, 15.5f, MAP_ENTITY_SPRITE, 1 },  // Tree
+    { 12.5f, 15.5f, MAP_ENTITY_SPRITE, 2 },  // Lamp
+    { 6.5f, 6.5f, MAP_ENTITY_SPRITE, 3 },    // Barrel
+};
+
+unsigned int map_revision = 0;
+
+static uint8_t* map_alloc_grid(int tile_count) {
+    // Outside entry plus padding for 4-byte gathers at the last tile
+    return (uint8_t*)calloc((size_t)tile_count + 4, 1);
+}
+
+bool map_set_size(Map* map, int width, int height) {
+    memset(map, 0, sizeof(*map));
+    if (width <= 0 || height <= 0 || width > MAP_MAX_SIZE || height > MAP_MAX_SIZE) {
+        fprintf(stderr, "Bad map size %dx%d (1 to %d tiles per side)\n", width, height, MAP_MAX_SIZE);
+        return false;
+    }
+
+    int blocks_x = (height + 7) >> MAP_BLOCK_SHIFT;
+    map->width = width;
+    map->height = height;
+    map->tile_count = width * height;
+    map->stride = width;
+    map->mask_x = ~0;
+    map->mask_y = ~0;
+    map->blocks_y = (width + 7) >> MAP_BLOCK_SHIFT;
+    map->block_count = blocks_x * map->blocks_y;
+    map->player_spawn_x = height / 2.0f;
+    map->player_spawn_y = width / 2.0f;
+    return true;
+}
+
+bool map_allocate(Map* map) {
+    map->tiles = map_alloc_grid(map->tile_count);
+    map->floor = map_alloc_grid(map->tile_count);
+    map->ceiling = map_alloc_grid(map->tile_count);
+    map->distance = map_alloc_grid(map->tile_count);
+    map->solid = (uint64_t*)malloc(((size_t)map->block_count + 1) * sizeof(uint64_t));
+    if (!map->tiles || !map->floor || !map->ceiling || !map->distance || !map->solid) {
+        fprintf(stderr, "Failed to allocate %dx%d map\n", map->width, map->height);
+        map_free(map);
+        return false;
+    }
+    return true;
+}
+
+bool map_create(Map* map, int width, int height) {
+    if (!map_set_size(map, width, height) || !map_allocate(map)) {
+        return false;
+    }
+    map_update(map);
+    return true;
+}
+
+// Two raster passes of a 3x3 chamfer with unit weights give the exact
+// Chebyshev distance. Tiles on the edge start at 1 for the solid outside.
+// Only rows x0-x1 and columns y0-y1 are rewritten; the distances around
+// them are read as they stand, so a box that covers every tile changed
+// by an edit comes out exactly as a full rebuild.
+void map_build_distance(const uint8_t* tiles, int tile_stride, uint8_t* distance, int distance_stride,
+                        int rows, int cols, int x0, int y0, int x1, int y1) {
+    int w = distance_stride;
+    uint8_t* d = distance;
+
+    for (int x = x0; x <= x1; x++) {
+        for (int y = y0; y <= y1; y++) {
+            int best;
+            if (tiles[x * tile_stride + y]) {
+                best = 0;
+            } else if (x == 0 || y == 0 || x == rows - 1 || y == cols - 1) {
+                best = 1;
+            } else {
+                best = d[(x - 1) * w + y - 1];
+                if (d[(x - 1) * w + y] < best) best = d[(x - 1) * w + y];
+                if (d[(x - 1) * w + y + 1] < best) best = d[(x - 1) * w + y + 1];
+                if (d[x * w + y - 1] < best) best = d[x * w + y - 1];
+                best = best < MAP_DISTANCE_MAX ? best + 1 : MAP_DISTANCE_MAX;
+            }
+            d[x * w + y] = (uint8_t)best;
+        }
+    }
+
+    // Edge tiles are final after the first pass
+    for (int x = x1 < rows - 2 ? x1 : rows - 2; x >= x0 && x > 0; x--) {
+        for (int y = y1 < cols - 2 ? y1 : cols - 2; y >= y0 && y > 0; y--) {
+            int best = d[x * w + y];
+            if (d[(x + 1) * w + y + 1] + 1 < best) best = d[(x + 1) * w + y + 1] + 1;
+            if (d[(x + 1) * w + y] + 1 < best) best = d[(x + 1) * w + y] + 1;
+            if (d[(x + 1) * w + y - 1] + 1 < best) best = d[(x + 1) * w + y - 1] + 1;
+            if (d[x * w + y + 1] + 1 < best) best = d[x * w + y + 1] + 1;
+            d[x * w + y] = (uint8_t)best;
+        }
+    }
+}
+
+// Bits of a block word that lie inside the map
+static uint64_t map_block_mask(const Map* map, int bx, int by) {
+    int rows = map->height - (bx << MAP_BLOCK_SHIFT);
+    int cols = map->width - (by << MAP_BLOCK_SHIFT);
+    uint64_t row_bits = cols >= 8 ? 0xFF : ((uint64_t)1 << cols) - 1;
+    uint64_t mask = row_bits * 0x0101010101010101ull;
+    return rows >= 8 ? mask : mask & (((uint64_t)1 << (rows * 8)) - 1);
+}
+
+// Works a block word at a time, so solid areas and chunks that aren't
+// resident cost almost nothing. When there are more empty tiles than the
+// sample holds, every step-th one is kept.
+void map_build_free_cells(Map* map) {
+    int blocks_x = map->block_count / map->blocks_y;
+    long long total = 0;
+    for (int bx = 0; bx < blocks_x; bx++) {
+        for (int by = 0; by < map->blocks_y; by++) {
+            uint64_t free_bits = ~map->solid[bx * map->blocks_y + by] & map_block_mask(map, bx, by);
+            total += __builtin_popcountll(free_bits);
+        }
+    }
+
+    long long step = (total + MAP_FREE_CELL_SAMPLE - 1) / MAP_FREE_CELL_SAMPLE;
+    int capacity = (int)(step > 1 ? MAP_FREE_CELL_SAMPLE : total);
+    map->free_cell_count = 0;
+    if (capacity == 0) {
+        return;
+    }
+    uint32_t* cells = (uint32_t*)realloc(map->free_cells, (size_t)capacity * sizeof(uint32_t));
+    if (!cells) {
+        fprintf(stderr, "Failed to allocate free cells for %dx%d map\n", map->width, map->height);
+        return;
+    }
+    map->free_cells = cells;
+
+    // Empty tile number next is the next one kept; words before it are skipped
+    long long seen = 0;
+    long long next = 0;
+    for (int bx = 0; bx < blocks_x; bx++) {
+        for (int by = 0; by < map->blocks_y; by++) {
+            uint64_t free_bits = ~map->solid[bx * map->blocks_y + by] & map_block_mask(map, bx, by);
+            int n = __builtin_popcountll(free_bits);
+            while (next < seen + n && map->free_cell_count < capacity) {
+                uint64_t bits = free_bits;
+                for (long long k = next - seen; k > 0; k--) {
+                    bits &= bits - 1;
+                }
+                int bit = __builtin_ctzll(bits);
+                int x = (bx << MAP_BLOCK_SHIFT) + (bit >> 3);
+                int y = (by << MAP_BLOCK_SHIFT) + (bit & 7);
+                cells[map->free_cell_count++] = (uint32_t)x * (uint32_t)map->width + (uint32_t)y;
+                next += step;
+            }
+            seen += n;
+        }
+    }
+}
+
+bool map_random_free_cell(const Map* map, float* x, float* y) {
+    if (map->free_cell_count == 0) {
+        return false;
+    }
+    uint32_t cell = map->free_cells[rand() % map->free_cell_count];
+    *x = (float)(cell / (uint32_t)map->width) + 0.5f;
+    *y = (float)(cell % (uint32_t)map->width) + 0.5f;
+    return true;
+}
+
+bool map_entity_inside(const Map* map, float x, float y) {
+    return x >= 0.0f && x < map->height && y >= 0.0f && y < map->width;
+}
+
+int map_check_entities(Map* map) {
+    memset(map->entity_count, 0, sizeof(map->entity_count));
+    for (int i = 0; i < map->entity_total; i++) {
+        const MapEntity* e = &map->entities[i];
+        if (e->kind >= MAP_ENTITY_KINDS || (i > 0 && e->kind < map->entities[i - 1].kind) ||
+            !map_entity_inside(map, e->x, e->y)) {
+            return i;
+        }
+        map->entity_count[e->kind]++;
+    }
+    return -1;
+}
+
+bool map_sort_entities(Map* map) {
+    int start[MAP_ENTITY_KINDS] = { 0 };
+    int count[MAP_ENTITY_KINDS] = { 0 };
+    for (int i = 0; i < map->entity_total; i++) {
+        count[map->entities[i].kind]++;
+    }
+    for (int k = 1; k < MAP_ENTITY_KINDS; k++) {
+        start[k] = start[k - 1] + count[k - 1];
+    }
+
+    if (map->entity_total > 0) {
+        MapEntity* sorted = (MapEntity*)malloc((size_t)map->entity_total * sizeof(MapEntity));
+        if (!sorted) {
+            fprintf(stderr, "Out of memory sorting %d map entities\n", map->entity_total);
+            return false;
+        }
+        for (int i = 0; i < map->entity_total; i++) {
+            sorted[start[map->entities[i].kind]++] = map->entities[i];
+        }
+        free(map->entities);
+        map->entities = sorted;
+    }
+
+    int bad = map_check_entities(map);
+    if (bad >= 0) {
+        fprintf(stderr, "Map has a bad entity %d\n", bad);
+        return false;
+    }
+    return true;
+}
+
+void map_update(Map* map) {
+    if (map->resident) {
+        map_revision++;
+        return;
+    }
+
+    memset(map->solid, 0, (size_t)map->block_count * sizeof(uint64_t));
+    map->solid[map->block_count] = ~(uint64_t)0;
+
+    for (int x = 0; x < map->height; x++) {
+        const uint8_t* row = map->tiles + x * map->width;
+        for (int y = 0; y < map->width; y++) {
+            if (row[y]) {
+                map->solid[map_block_index(map, x, y)] |= (uint64_t)1 << map_block_bit(x, y);
+            }
+        }
+    }
+    map_build_distance(map->tiles, map->width, map->distance, map->width, map->height, map->width,
+                       0, 0, map->height - 1, map->width - 1);
+    map_build_free_cells(map);
+    map_revision++;
+}
+
+// How far from the box an edit can change distances. A tile k rings out
+// changes only if its old distance is at least k: its nearest solid was in
+// the box, or a new one there is nearer. Such a tile has a neighbour one
+// ring in that qualifies too, so the first ring without one ends the reach.
+static int map_distance_reach(const Map* map, int x0, int y0, int x1, int y1) {
+    int reach = 0;
+    for (int k = 1; k <= MAP_DISTANCE_MAX; k++) {
+        int rx0 = x0 - k, ry0 = y0 - k, rx1 = x1 + k, ry1 = y1 + k;
+        if (rx0 < 0 && ry0 < 0 && rx1 >= map->height && ry1 >= map->width) {
+            break;
+        }
+        bool found = false;
+        for (int x = rx0 > 0 ? rx0 : 0; x <= rx1 && x < map->height && !found; x++) {
+            const uint8_t* row = map->distance + (size_t)x * map->width;
+            if (x == rx0 || x == rx1) {
+                for (int y = ry0 > 0 ? ry0 : 0; y <= ry1 && y < map->width; y++) {
+                    if (row[y] >= k) {
+                        found = true;
+                        break;
+                    }
+                }
+            } else {
+                found = (ry0 >= 0 && row[ry0] >= k) || (ry1 < map->width && row[ry1] >= k);
+            }
+        }
+        if (!found) {
+            break;
+        }
+        reach = k;
+    }
+    return reach;
+}
+
+// Re-runs map_build_distance over the tiles the edit can reach. The
+// unchanged distances just outside act as seeds, so the result is exact
+// without looking at the rest of the map.
+void map_update_region(Map* map, int x0, int y0, int x1, int y1) {
+    if (map->resident) {
+        map_revision++;
+        return;
+    }
+
+    for (int x = x0; x <= x1; x++) {
+        for (int y = y0; y <= y1; y++) {
+            uint64_t bit = (uint64_t)1 << map_block_bit(x, y);
+            uint64_t* word = &map->solid[map_block_index(map, x, y)];
+            *word = map->tiles[x * map->width + y] ? *word | bit : *word & ~bit;
+        }
+    }
+
+    int reach = map_distance_reach(map, x0, y0, x1, y1);
+    x0 = x0 - reach > 0 ? x0 - reach : 0;
+    y0 = y0 - reach > 0 ? y0 - reach : 0;
+    x1 = x1 + reach < map->height - 1 ? x1 + reach : map->height - 1;
+    y1 = y1 + reach < map->width - 1 ? y1 + reach : map->width - 1;
+
+    map_build_distance(map->tiles, map->width, map->distance, map->width, map->height, map->width,
+                       x0, y0, x1, y1);
+
+    map_build_free_cells(map);
+    map_revision++;
+}
+
+bool map_nearest_free(const Map* map, float* x, float* y, int max_radius) {
+    int cx = (int)*x;
+    int cy = (int)*y;
+    for (int r = 0; r <= max_radius; r++) {
+        for (int tx = cx - r; tx <= cx + r; tx++) {
+            for (int ty = cy - r; ty <= cy + r; ty++) {
+                bool ring = tx == cx - r || tx == cx + r || ty == cy - r || ty == cy + r;
+                if (ring && map_inside(map, tx, ty) && !map_solid(map, tx, ty)) {
+                    if (r > 0) {
+                        *x = tx + 0.5f;
+                        *y = ty + 0.5f;
+                    }
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool map_load_default(Map* map) {
+    if (!map_create(map, DEFAULT_MAP_SIZE, DEFAULT_MAP_SIZE)) {
+        return false;
+    }
+    memcpy(map->tiles, default_tiles, sizeof(default_tiles));
+    map->player_spawn_x = 22.0f;
+    map->player_spawn_y = 12.0f;
+    map->entities = (MapEntity*)malloc(sizeof(default_entities));
+    if (map->entities) {
+        memcpy(map->entities, default_entities, sizeof(default_entities));
+        map->entity_total = (int)(sizeof(default_entities) / sizeof(default_entities[0]));
+        map->entity_count[MAP_ENTITY_SPRITE] = map->entity_total;
+    }
+    map_update(map);
+    return true;
+}
+
+// Grids inside a mapped binary file are released with the mapping
+static void map_free_grid(const Map* map, void* grid) {
+    const char* data = (const char*)map->file_data;
+    if (!data || (const char*)grid < data || (const char*)grid >= data + map->file_size) {
+        free(grid);
+    }
+}
+
+void map_free(Map* map) {
+    map_free_grid(map, map->tiles);
+    map_free_grid(map, map->floor);
+    map_free_grid(map, map->ceiling);
+    map_free_grid(map, map->distance);
+    map_free_grid(map, map->solid);
+    map_free_grid(map, map->entities);
+    free(map->free_cells);
+    if (map->file_data) {
+        munmap(map->file_data, map->file_size);
+    }
+    map->tiles = NULL;
+    map->floor = NULL;
+    map->ceiling = NULL;
+    map->distance = NULL;
+    map->solid = NULL;
+    map->entities = NULL;
+    map->entity_total = 0;
+    memset(map->entity_count, 0, sizeof(map->entity_count));
+    map->free_cells = NULL;
+    map->free_cell_count = 0;
+    map->file_data = NULL;
+    map->file_size = 0;
+}
@@ -0,0 +1,278 @@
+#include "map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Binary maps hold the in-memory grids byte for byte, so loading is an
+// mmap plus header checks. Layout:
+//
+//   MapFileHeader
+//   MapFileSection[section_count]
+//   section data, each starting on a MAP_BINARY_ALIGN boundary
+//
+// Grids include their outside entry and gather padding. Bump the version
+// whenever the grid layout, MAP_BLOCK_SHIFT or the distance rules change,
+// since stored occupancy and distances would no longer match.
+#define MAP_BINARY_MAGIC "RCMB"
+#define MAP_BINARY_VERSION 1
+#define MAP_BINARY_BYTE_ORDER 0x01020304u
+#define MAP_BINARY_ALIGN 64
+#define MAP_BINARY_MAX_SECTIONS 32
+
+enum {
+    MAP_SECTION_TILES = 1,
+    MAP_SECTION_FLOOR,
+    MAP_SECTION_CEILING,
+    MAP_SECTION_SOLID,      // Occupancy words, outside word included
+    MAP_SECTION_DISTANCE,
+    MAP_SECTION_ENTITIES,   // MapEntity array grouped by kind; optional
+};
+
+typedef struct {
+    char magic[4];
+    uint32_t byte_order;    // MAP_BINARY_BYTE_ORDER as the writer stored it
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    float spawn_x;
+    float spawn_y;
+    uint32_t section_count;
+} MapFileHeader;
+
+typedef struct {
+    uint32_t id;            // MAP_SECTION_*; unknown ids are skipped
+    uint32_t reserved;
+    uint64_t offset;        // From the start of the file
+    uint64_t size;
+} MapFileSection;
+
+static size_t map_grid_bytes(const Map* map) {
+    return (size_t)map->tile_count + 4;
+}
+
+static size_t map_solid_bytes(const Map* map) {
+    return ((size_t)map->block_count + 1) * sizeof(uint64_t);
+}
+
+bool map_is_binary(const char* filename) {
+    char magic[4];
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return false;
+    }
+    bool binary = fread(magic, 1, 4, file) == 4 && memcmp(magic, MAP_BINARY_MAGIC, 4) == 0;
+    fclose(file);
+    return binary;
+}
+
+bool map_load_binary(Map* map, const char* filename) {
+    memset(map, 0, sizeof(*map));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open map file: %s\n", filename);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MapFileHeader)) {
+        fprintf(stderr, "Binary map %s is truncated\n", filename);
+        close(fd);
+        return false;
+    }
+
+    // Private writable mapping: untouched pages stay shared with the page
+    // cache, and map_update or editing tiles copies only the pages it writes
+    size_t file_size = (size_t)st.st_size;
+    void* data = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %s\n", filename);
+        return false;
+    }
+
+    MapFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MAP_BINARY_MAGIC, 4) != 0 || header.byte_order != MAP_BINARY_BYTE_ORDER) {
+        fprintf(stderr, "%s is not a binary map for this machine\n", filename);
+        munmap(data, file_size);
+        return false;
+    }
+    if (header.version != MAP_BINARY_VERSION) {
+        fprintf(stderr, "Binary map %s is version %u, expected %d; convert it again\n",
+                filename, header.version, MAP_BINARY_VERSION);
+        munmap(data, file_size);
+        return false;
+    }
+    if (!map_set_size(map, header.width, header.height)) {
+        munmap(data, file_size);
+        return false;
+    }
+    map->file_data = data;
+    map->file_size = file_size;
+    map->player_spawn_x = header.spawn_x;
+    map->player_spawn_y = header.spawn_y;
+
+    if (header.section_count > MAP_BINARY_MAX_SECTIONS ||
+        sizeof(header) + header.section_count * sizeof(MapFileSection) > file_size) {
+        fprintf(stderr, "Binary map %s has a bad section table\n", filename);
+        return false;
+    }
+
+    const MapFileSection* sections = (const MapFileSection*)((const char*)data + sizeof(header));
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        const MapFileSection* section = &sections[i];
+        size_t expected;
+        void** grid;
+
+        if (section->id == MAP_SECTION_ENTITIES) {
+            if (section->offset % MAP_BINARY_ALIGN != 0 || section->size % sizeof(MapEntity) != 0 ||
+                section->size / sizeof(MapEntity) > (uint64_t)MAP_MAX_SIZE * MAP_MAX_SIZE ||
+                section->offset > file_size || section->size > file_size - section->offset) {
+                fprintf(stderr, "Binary map %s has a bad section %u\n", filename, section->id);
+                return false;
+            }
+            map->entities = (MapEntity*)((char*)data + section->offset);
+            map->entity_total = (int)(section->size / sizeof(MapEntity));
+            continue;
+        }
+
+        switch (section->id) {
+        case MAP_SECTION_TILES:    grid = (void**)&map->tiles;    expected = map_grid_bytes(map); break;
+        case MAP_SECTION_FLOOR:    grid = (void**)&map->floor;    expected = map_grid_bytes(map); break;
+        case MAP_SECTION_CEILING:  grid = (void**)&map->ceiling;  expected = map_grid_bytes(map); break;
+        case MAP_SECTION_DISTANCE: grid = (void**)&map->distance; expected = map_grid_bytes(map); break;
+        case MAP_SECTION_SOLID:    grid = (void**)&map->solid;    expected = map_solid_bytes(map); break;
+        default:
+            continue;
+        }
+
+        if (section->offset % MAP_BINARY_ALIGN != 0 || section->size != expected ||
+            section->offset > file_size || section->size > file_size - section->offset) {
+            fprintf(stderr, "Binary map %s has a bad section %u\n", filename, section->id);
+            return false;
+        }
+        *grid = (char*)data + section->offset;
+    }
+
+    if (!map->tiles) {
+        fprintf(stderr, "Binary map %s has no tiles\n", filename);
+        return false;
+    }
+    // Entities must already be grouped by kind and inside the map
+    int bad = map_check_entities(map);
+    if (bad >= 0) {
+        fprintf(stderr, "Binary map %s has a bad entity %d\n", filename, bad);
+        return false;
+    }
+
+    if (!map->floor) {
+        map->floor = (uint8_t*)calloc(map_grid_bytes(map), 1);
+    }
+    if (!map->ceiling) {
+        map->ceiling = (uint8_t*)calloc(map_grid_bytes(map), 1);
+    }
+
+    // The lookups rely on the outside entries; anything else means the
+    // stored grids can't be trusted, so rebuild them
+    bool derived = map->solid && map->distance && map->solid[map->block_count] == ~(uint64_t)0 &&
+                   map->distance[map->tile_count] == 0 && map->tiles[map->tile_count] == 0;
+    if (!derived) {
+        map->tiles[map->tile_count] = 0;
+        if (!map->solid) {
+            map->solid = (uint64_t*)malloc(map_solid_bytes(map));
+        }
+        if (!map->distance) {
+            map->distance = (uint8_t*)calloc(map_grid_bytes(map), 1);
+        }
+    }
+    if (!map->floor || !map->ceiling || !map->solid || !map->distance) {
+        fprintf(stderr, "Failed to allocate %dx%d map\n", map->width, map->height);
+        return false;
+    }
+
+    if (derived) {
+        map_build_free_cells(map);
+        map_revision++;
+    } else {
+        map_update(map);
+    }
+
+    printf("Map loaded: %dx%d binary, spawn at (%.1f, %.1f), %d entities%s\n", map->width, map->height,
+           map->player_spawn_x, map->player_spawn_y, map->entity_total, derived ? "" : ", occupancy rebuilt");
+    return true;
+}
+
+static bool map_write_section(FILE* file, const void* data, size_t size, uint64_t offset) {
+    static const char zeros[MAP_BINARY_ALIGN];
+    long pos = ftell(file);
+    return pos >= 0 && (uint64_t)pos <= offset &&
+           fwrite(zeros, 1, (size_t)(offset - (uint64_t)pos), file) == (size_t)(offset - (uint64_t)pos) &&
+           fwrite(data, 1, size, file) == size;
+}
+
+bool map_save_binary(const Map* map, const char* filename) {
+    if (map->resident) {
+        fprintf(stderr, "Can't save a streamed map\n");
+        return false;
+    }
+
+    const struct {
+        uint32_t id;
+        const void* data;
+        size_t size;
+    } grids[] = {
+        { MAP_SECTION_TILES,    map->tiles,    map_grid_bytes(map) },
+        { MAP_SECTION_FLOOR,    map->floor,    map_grid_bytes(map) },
+        { MAP_SECTION_CEILING,  map->ceiling,  map_grid_bytes(map) },
+        { MAP_SECTION_SOLID,    map->solid,    map_solid_bytes(map) },
+        { MAP_SECTION_DISTANCE, map->distance, map_grid_bytes(map) },
+        { MAP_SECTION_ENTITIES, map->entities, (size_t)map->entity_total * sizeof(MapEntity) },
+    };
+    // The entity section is left out when there are none
+    int count = (int)(sizeof(grids) / sizeof(grids[0])) - (map->entity_total == 0);
+
+    MapFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAP_BINARY_MAGIC, 4);
+    header.byte_order = MAP_BINARY_BYTE_ORDER;
+    header.version = MAP_BINARY_VERSION;
+    header.width = map->width;
+    header.height = map->height;
+    header.spawn_x = map->player_spawn_x;
+    header.spawn_y = map->player_spawn_y;
+    header.section_count = (uint32_t)count;
+
+    MapFileSection sections[sizeof(grids) / sizeof(grids[0])];
+    uint64_t offset = sizeof(header) + count * sizeof(MapFileSection);
+    for (int i = 0; i < count; i++) {
+        offset = (offset + MAP_BINARY_ALIGN - 1) / MAP_BINARY_ALIGN * MAP_BINARY_ALIGN;
+        memset(&sections[i], 0, sizeof(sections[i]));
+        sections[i].id = grids[i].id;
+        sections[i].offset = offset;
+        sections[i].size = grids[i].size;
+        offset += grids[i].size;
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create %s\n", filename);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(sections, sizeof(MapFileSection), (size_t)count, file) == (size_t)count;
+    for (int i = 0; ok && i < count; i++) {
+        ok = map_write_section(file, grids[i].data, grids[i].size, sections[i].offset);
+    }
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write %s\n", filename);
+        remove(filename);
+    }
+    return ok;
+}
@@ -1,85 +1,774 @@
 #include "map.h"
+#include "map_watch.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <ctype.h>
 
-bool map_load(Map* map, const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Failed to open map file: %s\n", filename);
-        return false;
+// Text maps are read in large blocks and parsed in one pass. Every line
+// handed to the parser ends in '\n' (one is added after the last line if
+// the file lacks it), so the scanning loops need no end-of-buffer checks.
+#define MAP_READ_BLOCK (1 << 20)
+
+// What each line of a text map holds, recorded in MapSource so a reload
+// knows what a changed line means. Grid rows are (grid << 16) | row, grid
+// 0, 1 and 2 for tiles, floor and ceiling.
+enum {
+    MAP_LINE_BLANK = -1,        // Empty or a comment
+    MAP_LINE_SIZE = -2,
+    MAP_LINE_SECTION = -3,
+    MAP_LINE_SPAWN = -4,
+    MAP_LINE_ENTITY = -5,
+};
+
+typedef struct {
+    FILE* file;                 // NULL when buf holds the whole text
+    const char* filename;
+    char* buf;
+    size_t cap;
+    size_t len;             // Bytes of buf holding file data
+    size_t pos;             // Start of the next line
+    bool eof;
+    bool failed;            // Out of memory
+    int line;               // Number of the line last returned, from 1
+    int32_t* roles;         // Per line, filled in by map_parse if not NULL
+} MapReader;
+
+// Next line, including its '\n'; NULL at end of file or when out of memory
+static char* map_reader_next(MapReader* r) {
+    for (;;) {
+        char* start = r->buf + r->pos;
+        if (r->pos == r->len && r->eof) {
+            return NULL;
+        }
+        char* newline = (char*)memchr(start, '\n', r->len - r->pos);
+        if (newline) {
+            r->pos = (size_t)(newline - r->buf) + 1;
+            r->line++;
+            return start;
+        }
+
+        if (r->eof) {
+            r->buf[r->len++] = '\n';  // Room for it is always kept
+            continue;
+        }
+
+        // Move the partial line to the front and read the next block,
+        // growing the buffer when one line fills it
+        memmove(r->buf, start, r->len - r->pos);
+        r->len -= r->pos;
+        r->pos = 0;
+        if (r->cap - r->len < MAP_READ_BLOCK + 1) {
+            size_t new_cap = r->cap * 2;
+            char* grown = (char*)realloc(r->buf, new_cap);
+            if (!grown) {
+                fprintf(stderr, "Out of memory reading %s\n", r->filename);
+                r->failed = true;
+                return NULL;
+            }
+            r->buf = grown;
+            r->cap = new_cap;
+        }
+        size_t got = fread(r->buf + r->len, 1, r->cap - r->len - 1, r->file);
+        r->len += got;
+        if (got == 0) {
+            r->eof = true;
+        }
     }
+}
+
+static bool map_parse_error(const MapReader* r, const char* line, const char* at, const char* message) {
+    fprintf(stderr, "%s:%d:%d: %s\n", r->filename, r->line, (int)(at - line) + 1, message);
+    return false;
+}
+
+static bool map_incomplete(const MapReader* r, const char* section, int rows, int height) {
+    fprintf(stderr, "%s:%d: %s grid ends after %d of %d rows\n", r->filename, r->line, section, rows, height);
+    return false;
+}
+
+static bool map_is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// A value ends at a blank, a comment or the end of the line
+static bool map_is_separator(char c) {
+    return map_is_blank(c) || c == '\n' || c == '#';
+}
+
+static const char* map_skip_blanks(const char* p) {
+    while (map_is_blank(*p)) p++;
+    return p;
+}
+
+// Parse one row of tile ids into out[0..width); every row must be complete
+static bool map_parse_row(const MapReader* r, const char* line, uint8_t* out, int width) {
+    const char* p = line;
+    int col = 0;
+
+    for (;;) {
+        p = map_skip_blanks(p);
+        if (*p == '\n' || *p == '#') {
+            break;
+        }
+
+        const char* start = p;
+        unsigned value = (unsigned)(unsigned char)*p - '0';
+        unsigned digit = (unsigned)(unsigned char)p[1] - '0';
+        if (value > 9) {
+            return map_parse_error(r, line, p, "expected a tile id (0-255)");
+        }
+        p++;
+        // Most ids are one digit
+        while (digit <= 9) {
+            value = value * 10 + digit;
+            if (value > 255) {
+                return map_parse_error(r, line, start, "tile id out of range (0-255)");
+            }
+            digit = (unsigned)(unsigned char)*++p - '0';
+        }
+
+        if (!map_is_separator(*p)) {
+            return map_parse_error(r, line, p, "expected a tile id (0-255)");
+        }
+        if (col == width) {
+            char message[64];
+            snprintf(message, sizeof(message), "row has more than %d tiles", width);
+            return map_parse_error(r, line, start, message);
+        }
+        out[col++] = (uint8_t)value;
+    }
+
+    if (col < width) {
+        char message[64];
+        snprintf(message, sizeof(message), "row has %d tiles, expected %d", col, width);
+        return map_parse_error(r, line, p, message);
+    }
+    return true;
+}
+
+// Parse a line of exactly two numbers: integers for the size line,
+// floats for the spawn position
+static bool map_parse_pair(const MapReader* r, const char* line, bool integers, float* a, float* b) {
+    const char* p = line;
+    float* values[2] = { a, b };
+
+    for (int i = 0; i < 2; i++) {
+        p = map_skip_blanks(p);
+        char* end;
+        if (integers) {
+            long v = strtol(p, &end, 10);
+            *values[i] = end != p && v >= 0 && v <= MAP_MAX_SIZE ? (float)v : -1.0f;
+        } else {
+            *values[i] = strtof(p, &end);
+        }
+        if (end == p || !map_is_separator(*end) || *values[i] < 0.0f) {
+            return map_parse_error(r, line, p, integers ? "expected map width and height"
+                                                        : "expected spawn position (x y)");
+        }
+        p = end;
+    }
+
+    p = map_skip_blanks(p);
+    if (*p != '\n' && *p != '#') {
+        return map_parse_error(r, line, p, "unexpected text after two numbers");
+    }
+    return true;
+}
 
-    char line[512];
+static const char* const map_entity_names[MAP_ENTITY_KINDS] = { "sprite", "enemy", "pickup" };
+
+// Parse "x y type" after an entity keyword and append the entity to list
+static bool map_parse_entity(const MapReader* r, const Map* map, const char* line, const char* p,
+                             MapEntityKind kind, MapEntity** list, int* count, int* capacity) {
+    MapEntity entity;
+    char* end;
+
+    p = map_skip_blanks(p);
+    entity.x = strtof(p, &end);
+    if (end == p || !map_is_separator(*end)) {
+        return map_parse_error(r, line, p, "expected entity position (x y type)");
+    }
+    const char* at = p;
+    p = map_skip_blanks(end);
+    entity.y = strtof(p, &end);
+    if (end == p || !map_is_separator(*end)) {
+        return map_parse_error(r, line, p, "expected entity position (x y type)");
+    }
+    if (!map_entity_inside(map, entity.x, entity.y)) {
+        return map_parse_error(r, line, at, "entity is outside the map");
+    }
+    p = map_skip_blanks(end);
+    long type = strtol(p, &end, 10);
+    if (end == p || !map_is_separator(*end) || type < 0 || type > 255) {
+        return map_parse_error(r, line, p, "expected entity type (0-255)");
+    }
+    p = map_skip_blanks(end);
+    if (*p != '\n' && *p != '#') {
+        return map_parse_error(r, line, p, "unexpected text after entity type");
+    }
+
+    if (*count == *capacity) {
+        int grown_capacity = *capacity ? *capacity * 2 : 256;
+        MapEntity* grown = (MapEntity*)realloc(*list, (size_t)grown_capacity * sizeof(MapEntity));
+        if (!grown) {
+            fprintf(stderr, "Out of memory reading %s\n", r->filename);
+            return false;
+        }
+        *list = grown;
+        *capacity = grown_capacity;
+    }
+    entity.kind = (uint16_t)kind;
+    entity.type = (uint16_t)type;
+    (*list)[(*count)++] = entity;
+    return true;
+}
+
+// Entity kind named by the n-character word at p, or MAP_ENTITY_KINDS
+static int map_entity_kind(const char* p, size_t n) {
+    int kind = 0;
+    while (kind < MAP_ENTITY_KINDS &&
+           (strlen(map_entity_names[kind]) != n || memcmp(p, map_entity_names[kind], n) != 0)) {
+        kind++;
+    }
+    return kind;
+}
+
+static bool map_parse(MapReader* r, Map* map) {
+    uint8_t* grid = NULL;  // Grid the data rows are written to
+    int grid_id = 0;
+    const char* section = "map";
     int row = 0;
-    bool reading_data = false;
-    bool size_read = false;
+    int entity_capacity = 0;
+    int32_t ignored;
+    char* line;
 
-    // Initialize defaults
-    map->width = MAP_WIDTH;
-    map->height = MAP_HEIGHT;
-    map->player_spawn_x = 12.0f;
-    map->player_spawn_y = 12.0f;
-    memset(map->data, 0, sizeof(map->data));
+    while ((line = map_reader_next(r)) != NULL) {
+        int32_t* role = r->roles ? &r->roles[r->line - 1] : &ignored;
 
-    while (fgets(line, sizeof(line), file)) {
         // Skip comments and empty lines
-        char* ptr = line;
-        while (*ptr && isspace(*ptr)) ptr++;
-        if (*ptr == '#' || *ptr == '\0' || *ptr == '\n') {
+        const char* p = map_skip_blanks(line);
+        *role = MAP_LINE_BLANK;
+        if (*p == '#' || *p == '\n') {
             continue;
         }
 
-        // Read map size (first non-comment line)
-        if (!size_read) {
-            if (sscanf(line, "%d %d", &map->width, &map->height) == 2) {
-                if (map->width > MAP_WIDTH) map->width = MAP_WIDTH;
-                if (map->height > MAP_HEIGHT) map->height = MAP_HEIGHT;
-                size_read = true;
-                reading_data = true;
-                continue;
+        // First line: map size
+        if (!grid) {
+            float width, height;
+            *role = MAP_LINE_SIZE;
+            if (!map_parse_pair(r, line, true, &width, &height)) {
+                return false;
+            }
+            if (!map_set_size(map, (int)width, (int)height)) {
+                return map_parse_error(r, line, p, "bad map size");
+            }
+            if (!map_allocate(map)) {
+                return false;
             }
+            grid = map->tiles;
+            continue;
         }
 
-        // Try to read player spawn position
-        float px, py;
-        if (sscanf(line, "%f %f", &px, &py) == 2 && row >= map->height) {
-            map->player_spawn_x = px;
-            map->player_spawn_y = py;
+        // Optional "floor" / "ceiling" sections: the next rows hold texture ids.
+        // Entity lines can follow any complete grid.
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')) {
+            const char* end = p;
+            while (!map_is_separator(*end)) end++;
+            size_t n = (size_t)(end - p);
+            const char* rest = map_skip_blanks(end);
+
+            if (row < map->height) {
+                return map_incomplete(r, section, row, map->height);
+            }
+            int kind = map_entity_kind(p, n);
+            if (kind < MAP_ENTITY_KINDS) {
+                *role = MAP_LINE_ENTITY;
+                if (!map_parse_entity(r, map, line, end, (MapEntityKind)kind,
+                                      &map->entities, &map->entity_total, &entity_capacity)) {
+                    return false;
+                }
+                continue;
+            }
+            *role = MAP_LINE_SECTION;
+            if (n == 5 && memcmp(p, "floor", 5) == 0) {
+                grid = map->floor;
+                grid_id = 1;
+                section = "floor";
+            } else if (n == 7 && memcmp(p, "ceiling", 7) == 0) {
+                grid = map->ceiling;
+                grid_id = 2;
+                section = "ceiling";
+            } else {
+                return map_parse_error(r, line, p, "unknown section (expected floor, ceiling or an entity)");
+            }
+            if (*rest != '\n' && *rest != '#') {
+                return map_parse_error(r, line, rest, "unexpected text after section name");
+            }
+            row = 0;
             continue;
         }
 
-        // Read map data
-        if (reading_data && row < map->height) {
-            char* token = strtok(line, " \t\n");
-            int col = 0;
-
-            while (token && col < map->width) {
-                map->data[row][col] = atoi(token);
-                token = strtok(NULL, " \t\n");
-                col++;
+        // Once a grid is complete, a pair of numbers is the player spawn
+        if (row == map->height) {
+            *role = MAP_LINE_SPAWN;
+            if (!map_parse_pair(r, line, false, &map->player_spawn_x, &map->player_spawn_y)) {
+                return false;
             }
-            row++;
+            continue;
         }
+
+        *role = (grid_id << 16) | row;
+        if (!map_parse_row(r, line, grid + (size_t)row * map->width, map->width)) {
+            return false;
+        }
+        row++;
     }
 
+    if (r->failed) {
+        return false;
+    }
+    if (r->file && ferror(r->file)) {
+        fprintf(stderr, "Failed to read %s\n", r->filename);
+        return false;
+    }
+    if (!grid) {
+        fprintf(stderr, "%s: no map size line\n", r->filename);
+        return false;
+    }
+    if (row < map->height) {
+        return map_incomplete(r, section, row, map->height);
+    }
+    return true;
+}
+
+// Parse a whole map and build everything derived from it
+static bool map_load_text(MapReader* r, Map* map) {
+    if (!map_parse(r, map) || !map_sort_entities(map)) {
+        return false;
+    }
+    map_update(map);
+
+    printf("Map loaded: %dx%d, spawn at (%.1f, %.1f), %d entities\n",
+           map->width, map->height, map->player_spawn_x, map->player_spawn_y, map->entity_total);
+    return true;
+}
+
+bool map_load(Map* map, const char* filename) {
+    if (map_is_binary(filename)) {
+        return map_load_binary(map, filename);
+    }
+    memset(map, 0, sizeof(*map));
+
+    MapReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.filename = filename;
+    reader.file = fopen(filename, "rb");
+    if (!reader.file) {
+        fprintf(stderr, "Failed to open map file: %s\n", filename);
+        return false;
+    }
+    reader.cap = 2 * MAP_READ_BLOCK;
+    reader.buf = (char*)malloc(reader.cap);
+    if (!reader.buf) {
+        fprintf(stderr, "Out of memory reading %s\n", filename);
+        fclose(reader.file);
+        return false;
+    }
+
+    bool ok = map_load_text(&reader, map);
+    free(reader.buf);
+    fclose(reader.file);
+    return ok;
+}
+
+// Read a whole text file into source, ending it with '\n' if it doesn't,
+// and find its lines
+static bool map_read_source(MapSource* source, const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open map file: %s\n", filename);
+        return false;
+    }
+    long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "Failed to read %s\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    source->text = (char*)malloc((size_t)size + 1);
+    if (!source->text) {
+        fprintf(stderr, "Out of memory reading %s\n", filename);
+        fclose(file);
+        return false;
+    }
+    source->size = fread(source->text, 1, (size_t)size, file);
+    bool ok = source->size == (size_t)size && !ferror(file);
     fclose(file);
+    if (!ok) {
+        fprintf(stderr, "Failed to read %s\n", filename);
+        return false;
+    }
+    if (source->size == 0 || source->text[source->size - 1] != '\n') {
+        source->text[source->size++] = '\n';
+    }
+
+    int count = 0;
+    for (const char* p = source->text; (p = (const char*)memchr(p, '\n', source->text + source->size - p)); p++) {
+        count++;
+    }
+    source->line_start = (size_t*)malloc(((size_t)count + 1) * sizeof(size_t));
+    source->line_role = (int32_t*)malloc((size_t)count * sizeof(int32_t));
+    if (!source->line_start || !source->line_role) {
+        fprintf(stderr, "Out of memory reading %s\n", filename);
+        return false;
+    }
+    source->line_count = 0;
+    size_t start = 0;
+    while (start < source->size) {
+        source->line_start[source->line_count++] = start;
+        start = (size_t)((const char*)memchr(source->text + start, '\n', source->size - start) - source->text) + 1;
+    }
+    source->line_start[source->line_count] = source->size;
+    return true;
+}
+
+// Reader over text that is already in memory
+static void map_reader_init_text(MapReader* r, MapSource* source, const char* filename) {
+    memset(r, 0, sizeof(*r));
+    r->filename = filename;
+    r->buf = source->text;
+    r->cap = source->size;
+    r->len = source->size;
+    r->eof = true;
+    r->roles = source->line_role;
+}
+
+bool map_load_source(Map* map, const char* filename, MapSource* source) {
+    memset(source, 0, sizeof(*source));
+    if (map_is_binary(filename)) {
+        return map_load_binary(map, filename);
+    }
+    memset(map, 0, sizeof(*map));
+    if (!map_read_source(source, filename)) {
+        return false;
+    }
+
+    MapReader reader;
+    map_reader_init_text(&reader, source, filename);
+    return map_load_text(&reader, map);
+}
+
+void map_source_free(MapSource* source) {
+    free(source->text);
+    free(source->line_start);
+    free(source->line_role);
+    free(source->removed);
+    free(source->added);
+    memset(source, 0, sizeof(*source));
+}
+
+static int map_compare_entities(const void* a, const void* b) {
+    const MapEntity* ea = (const MapEntity*)a;
+    const MapEntity* eb = (const MapEntity*)b;
+    if (ea->kind != eb->kind) return ea->kind < eb->kind ? -1 : 1;
+    if (ea->x != eb->x) return ea->x < eb->x ? -1 : 1;
+    if (ea->y != eb->y) return ea->y < eb->y ? -1 : 1;
+    if (ea->type != eb->type) return ea->type < eb->type ? -1 : 1;
+    return 0;
+}
+
+// Fill in source->removed and source->added: declarations only in old and
+// only in new. Both come out sorted, so grouped by kind.
+static bool map_diff_entities(MapSource* source, const MapEntity* old_list, int old_count,
+                              const MapEntity* new_list, int new_count) {
+    MapEntity* a = (MapEntity*)malloc(((size_t)old_count + 1) * sizeof(MapEntity));
+    MapEntity* b = (MapEntity*)malloc(((size_t)new_count + 1) * sizeof(MapEntity));
+    if (!a || !b) {
+        free(a);
+        free(b);
+        fprintf(stderr, "Out of memory comparing map entities\n");
+        return false;
+    }
+    if (old_count) memcpy(a, old_list, (size_t)old_count * sizeof(MapEntity));
+    if (new_count) memcpy(b, new_list, (size_t)new_count * sizeof(MapEntity));
+    qsort(a, (size_t)old_count, sizeof(MapEntity), map_compare_entities);
+    qsort(b, (size_t)new_count, sizeof(MapEntity), map_compare_entities);
+
+    // Merge in place: a keeps the removed ones, b the added ones
+    int i = 0, j = 0, removed = 0, added = 0;
+    while (i < old_count || j < new_count) {
+        int order = i == old_count ? 1 : j == new_count ? -1 : map_compare_entities(&a[i], &b[j]);
+        if (order < 0) {
+            a[removed++] = a[i++];
+        } else if (order > 0) {
+            b[added++] = b[j++];
+        } else {
+            i++;
+            j++;
+        }
+    }
+
+    free(source->removed);
+    free(source->added);
+    source->removed = a;
+    source->removed_count = removed;
+    source->added = b;
+    source->added_count = added;
+    return true;
+}
+
+// Swap in the parsed entity list if it differs from the map's
+static bool map_replace_entities(Map* map, MapSource* source, Map* parsed, MapReloadChanges* changes) {
+    if (!map_diff_entities(source, map->entities, map->entity_total, parsed->entities, parsed->entity_total)) {
+        return false;
+    }
+    if (source->removed_count == 0 && source->added_count == 0) {
+        return true;
+    }
+    MapEntity* entities = map->entities;
+    map->entities = parsed->entities;
+    map->entity_total = parsed->entity_total;
+    memcpy(map->entity_count, parsed->entity_count, sizeof(map->entity_count));
+    parsed->entities = entities;
+    changes->entities = true;
+    return true;
+}
+
+static void map_grow_box(MapReloadChanges* changes, int x, int y0, int y1) {
+    if (!changes->tiles) {
+        changes->tiles = true;
+        changes->x0 = changes->x1 = x;
+        changes->y0 = y0;
+        changes->y1 = y1;
+        return;
+    }
+    if (x < changes->x0) changes->x0 = x;
+    if (x > changes->x1) changes->x1 = x;
+    if (y0 < changes->y0) changes->y0 = y0;
+    if (y1 > changes->y1) changes->y1 = y1;
+}
+
+// Copy a row of tiles into the map, widening the changed box to cover the
+// tiles that differ
+static void map_apply_row(Map* map, int x, const uint8_t* row, MapReloadChanges* changes) {
+    uint8_t* tiles = map->tiles + (size_t)x * map->width;
+    int first = 0, last = map->width - 1;
+    while (first <= last && tiles[first] == row[first]) first++;
+    while (last >= first && tiles[last] == row[last]) last--;
+    if (first <= last) {
+        memcpy(tiles + first, row + first, (size_t)(last - first + 1));
+        map_grow_box(changes, x, first, last);
+    }
+}
+
+// Reload with the same lines as before: re-parse only the lines that
+// changed. Returns 1 when applied, 0 on errors, -1 when the change needs
+// a full parse (a line changed what it holds, or the size or a section
+// line changed).
+static int map_reload_lines(Map* map, MapSource* source, MapSource* next, const char* filename,
+                            MapReloadChanges* changes) {
+    MapReader r;
+    memset(&r, 0, sizeof(r));
+    r.filename = filename;
+
+    int changed_rows = 0;
+    bool entities = false;
+    bool spawn = false;
+    for (int i = 0; i < next->line_count; i++) {
+        size_t old_size = source->line_start[i + 1] - source->line_start[i];
+        size_t new_size = next->line_start[i + 1] - next->line_start[i];
+        const char* line = next->text + next->line_start[i];
+        if (old_size == new_size && memcmp(source->text + source->line_start[i], line, new_size) == 0) {
+            continue;
+        }
 
-    // Copy to global world_map for compatibility
-    for (int y = 0; y < map->height; y++) {
-        for (int x = 0; x < map->width; x++) {
-            world_map[y][x] = map->data[y][x];
+        int32_t role = source->line_role[i];
+        const char* p = map_skip_blanks(line);
+        bool blank = *p == '#' || *p == '\n';
+        bool word = (*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z');
+        if (role >= 0 && !blank && !word) {
+            changed_rows++;
+        } else if (role == MAP_LINE_ENTITY && word && map_entity_kind(p, strcspn(p, " \t\r\n#")) < MAP_ENTITY_KINDS) {
+            entities = true;
+        } else if (role == MAP_LINE_SPAWN && !blank && !word) {
+            spawn = true;
+        } else if (role != MAP_LINE_BLANK || !blank) {
+            return -1;
+        }
+    }
+
+    // Parse everything before touching the map, so an error leaves it as it was
+    float spawn_x = map->player_spawn_x, spawn_y = map->player_spawn_y;
+    uint8_t* rows = (uint8_t*)malloc((size_t)(changed_rows ? changed_rows : 1) * map->width);
+    Map parsed;
+    memset(&parsed, 0, sizeof(parsed));
+    parsed.width = map->width;
+    parsed.height = map->height;
+    int capacity = 0;
+    bool ok = rows != NULL;
+    if (!ok) {
+        fprintf(stderr, "Out of memory reloading %s\n", filename);
+    }
+
+    int n = 0;
+    for (int i = 0; i < next->line_count && ok; i++) {
+        const char* line = next->text + next->line_start[i];
+        int32_t role = source->line_role[i];
+        r.line = i + 1;
+        if (role >= 0) {
+            size_t old_size = source->line_start[i + 1] - source->line_start[i];
+            size_t new_size = next->line_start[i + 1] - next->line_start[i];
+            if (old_size != new_size || memcmp(source->text + source->line_start[i], line, new_size) != 0) {
+                ok = map_parse_row(&r, line, rows + (size_t)n++ * map->width, map->width);
+            }
+        } else if (role == MAP_LINE_ENTITY && entities) {
+            const char* p = map_skip_blanks(line);
+            const char* end = p;
+            while (!map_is_separator(*end)) end++;
+            ok = map_parse_entity(&r, map, line, end, (MapEntityKind)map_entity_kind(p, (size_t)(end - p)),
+                                  &parsed.entities, &parsed.entity_total, &capacity);
+        } else if (role == MAP_LINE_SPAWN && spawn) {
+            ok = map_parse_pair(&r, line, false, &spawn_x, &spawn_y);
+        }
+    }
+    ok = ok && (!entities || map_sort_entities(&parsed));
+    if (ok && entities) {
+        ok = map_replace_entities(map, source, &parsed, changes);
+    }
+    free(parsed.entities);
+    if (!ok) {
+        free(rows);
+        return 0;
+    }
+
+    n = 0;
+    for (int i = 0; i < next->line_count; i++) {
+        int32_t role = source->line_role[i];
+        size_t old_size = source->line_start[i + 1] - source->line_start[i];
+        size_t new_size = next->line_start[i + 1] - next->line_start[i];
+        if (role < 0 || (old_size == new_size &&
+                         memcmp(source->text + source->line_start[i], next->text + next->line_start[i], new_size) == 0)) {
+            continue;
+        }
+        const uint8_t* row = rows + (size_t)n++ * map->width;
+        int grid = role >> 16;
+        int x = role & 0xFFFF;
+        if (grid == 0) {
+            map_apply_row(map, x, row, changes);
+        } else {
+            memcpy((grid == 1 ? map->floor : map->ceiling) + (size_t)x * map->width, row, (size_t)map->width);
+            changes->textures = true;
         }
     }
+    free(rows);
 
-    printf("Map loaded: %dx%d, spawn at (%.1f, %.1f)\n",
-           map->width, map->height, map->player_spawn_x, map->player_spawn_y);
+    if (spawn_x != map->player_spawn_x || spawn_y != map->player_spawn_y) {
+        map->player_spawn_x = spawn_x;
+        map->player_spawn_y = spawn_y;
+        changes->spawn = true;
+    }
+    memcpy(next->line_role, source->line_role, (size_t)next->line_count * sizeof(int32_t));
+    return 1;
+}
 
+// Reload after a structural change: parse the whole text, then move the
+// new grids in and rebuild around the tiles that differ
+static bool map_reload_full(Map* map, MapSource* source, MapSource* next, const char* filename,
+                            MapReloadChanges* changes) {
+    Map parsed;
+    MapReader reader;
+    memset(&parsed, 0, sizeof(parsed));
+    map_reader_init_text(&reader, next, filename);
+    if (!map_parse(&reader, &parsed) || !map_sort_entities(&parsed) ||
+        !map_diff_entities(source, map->entities, map->entity_total, parsed.entities, parsed.entity_total)) {
+        map_free(&parsed);
+        return false;
+    }
+    changes->entities = source->removed_count > 0 || source->added_count > 0;
+    changes->spawn = parsed.player_spawn_x != map->player_spawn_x || parsed.player_spawn_y != map->player_spawn_y;
+
+    if (parsed.width != map->width || parsed.height != map->height) {
+        map_free(map);
+        *map = parsed;
+        map_update(map);
+        changes->resized = true;
+        changes->tiles = true;
+        changes->textures = true;
+        changes->x1 = map->height - 1;
+        changes->y1 = map->width - 1;
+        return true;
+    }
+
+    for (int x = 0; x < map->height; x++) {
+        map_apply_row(map, x, parsed.tiles + (size_t)x * map->width, changes);
+    }
+    size_t grid_bytes = (size_t)map->tile_count;
+    if (memcmp(map->floor, parsed.floor, grid_bytes) != 0 || memcmp(map->ceiling, parsed.ceiling, grid_bytes) != 0) {
+        uint8_t* floor = map->floor;
+        uint8_t* ceiling = map->ceiling;
+        map->floor = parsed.floor;
+        map->ceiling = parsed.ceiling;
+        parsed.floor = floor;
+        parsed.ceiling = ceiling;
+        changes->textures = true;
+    }
+    if (changes->entities) {
+        MapEntity* entities = map->entities;
+        map->entities = parsed.entities;
+        map->entity_total = parsed.entity_total;
+        memcpy(map->entity_count, parsed.entity_count, sizeof(map->entity_count));
+        parsed.entities = entities;
+    }
+    map->player_spawn_x = parsed.player_spawn_x;
+    map->player_spawn_y = parsed.player_spawn_y;
+    map_free(&parsed);
     return true;
 }
 
-void map_free(Map* map) {
-    // Nothing to free for now, but keep for future use
-    (void)map;
+bool map_reload(Map* map, MapSource* source, const char* filename, MapReloadChanges* changes) {
+    memset(changes, 0, sizeof(*changes));
+    if (!source->text || map->resident) {
+        fprintf(stderr, "Only text maps can be reloaded\n");
+        return false;
+    }
+
+    MapSource next;
+    memset(&next, 0, sizeof(next));
+    if (!map_read_source(&next, filename)) {
+        map_source_free(&next);
+        return false;
+    }
+
+    int result = -1;
+    if (next.line_count == source->line_count) {
+        result = map_reload_lines(map, source, &next, filename, changes);
+    }
+    if (result < 0) {
+        memset(changes, 0, sizeof(*changes));
+        result = map_reload_full(map, source, &next, filename, changes);
+    }
+    if (!result) {
+        map_source_free(&next);
+        return false;
+    }
+
+    if (changes->resized) {
+        // map_update already rebuilt everything
+    } else if (changes->tiles) {
+        map_update_region(map, changes->x0, changes->y0, changes->x1, changes->y1);
+    } else if (changes->textures) {
+        map_revision++;
+    }
+
+    // Keep the new text; the entity changes stay with the source
+    free(source->text);
+    free(source->line_start);
+    free(source->line_role);
+    source->text = next.text;
+    source->size = next.size;
+    source->line_start = next.line_start;
+    source->line_role = next.line_role;
+    source->line_count = next.line_count;
+    return true;
 }
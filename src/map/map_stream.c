@@ -0,0 +1,558 @@
+#include "map_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// File layout: a header padded to MAP_STREAM_HEADER_BYTES, then one record
+// per chunk, chunk (cx, cy) at index cx * chunks_y + cy. A record holds the
+// chunk's 8x8 occupancy words, then its tiles, floor, ceiling and distances
+// as 64x64 row-major grids. Tiles past the edge of the world are zero.
+// The map's entities, if any, follow the last record.
+#define MAP_STREAM_MAGIC "RCMS"
+#define MAP_STREAM_VERSION 1
+#define MAP_STREAM_BYTE_ORDER 0x01020304u
+#define MAP_STREAM_HEADER_BYTES 64
+#define MAP_STREAM_MAX_RADIUS 15
+
+#define CHUNK_TILES (MAP_CHUNK_SIZE * MAP_CHUNK_SIZE)
+#define CHUNK_BLOCKS (MAP_CHUNK_SIZE >> MAP_BLOCK_SHIFT)
+#define CHUNK_WORDS (CHUNK_BLOCKS * CHUNK_BLOCKS)
+#define RECORD_TILES (CHUNK_WORDS * sizeof(uint64_t))
+#define RECORD_FLOOR (RECORD_TILES + CHUNK_TILES)
+#define RECORD_CEILING (RECORD_FLOOR + CHUNK_TILES)
+#define RECORD_DISTANCE (RECORD_CEILING + CHUNK_TILES)
+#define RECORD_BYTES (RECORD_DISTANCE + CHUNK_TILES)
+
+enum {
+    REQUEST_FREE,
+    REQUEST_QUEUED,
+    REQUEST_LOADING,
+    REQUEST_DONE,
+};
+
+typedef struct {
+    char magic[4];
+    uint32_t byte_order;    // MAP_STREAM_BYTE_ORDER as the writer stored it
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    float spawn_x;
+    float spawn_y;
+    uint32_t chunk_shift;
+    uint32_t entity_count;  // Zero in files written before entities existed
+    uint32_t reserved;
+    uint64_t entity_offset;
+} MapStreamHeader;
+
+static double map_stream_ms(Uint64 ticks) {
+    return 1000.0 * (double)ticks / (double)SDL_GetPerformanceFrequency();
+}
+
+bool map_stream_is_chunked(const char* filename) {
+    char magic[4];
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return false;
+    }
+    bool chunked = fread(magic, 1, 4, file) == 4 && memcmp(magic, MAP_STREAM_MAGIC, 4) == 0;
+    fclose(file);
+    return chunked;
+}
+
+static bool map_stream_read(const MapStream* stream, int chunk, uint8_t* data) {
+    off_t offset = (off_t)MAP_STREAM_HEADER_BYTES + (off_t)chunk * (off_t)RECORD_BYTES;
+    size_t done = 0;
+    while (done < RECORD_BYTES) {
+        ssize_t got = pread(stream->fd, data + done, RECORD_BYTES - done, offset + (off_t)done);
+        if (got <= 0) {
+            return false;
+        }
+        done += (size_t)got;
+    }
+    return true;
+}
+
+// Copy a chunk record's grids into its window slot, or fill the slot with
+// the not-loaded contents when data is NULL
+static void map_stream_fill_slot(MapStream* stream, int chunk, const uint8_t* data) {
+    Map* map = stream->map;
+    int cx = chunk / stream->chunks_y;
+    int cy = chunk % stream->chunks_y;
+    int slot_mask = (1 << stream->window_shift) - 1;
+    size_t base = (size_t)((cx & slot_mask) << MAP_CHUNK_SHIFT) * map->stride + ((cy & slot_mask) << MAP_CHUNK_SHIFT);
+
+    for (int r = 0; r < MAP_CHUNK_SIZE; r++) {
+        size_t row = base + (size_t)r * map->stride;
+        if (data) {
+            memcpy(map->tiles + row, data + RECORD_TILES + r * MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+            memcpy(map->floor + row, data + RECORD_FLOOR + r * MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+            memcpy(map->ceiling + row, data + RECORD_CEILING + r * MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+            memcpy(map->distance + row, data + RECORD_DISTANCE + r * MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+        } else {
+            memset(map->tiles + row, MAP_STREAM_UNLOADED_TILE, MAP_CHUNK_SIZE);
+            memset(map->floor + row, 0, MAP_CHUNK_SIZE);
+            memset(map->ceiling + row, 0, MAP_CHUNK_SIZE);
+            memset(map->distance + row, 0, MAP_CHUNK_SIZE);
+        }
+    }
+
+    // Occupancy covers the whole world; blocks past its edge don't exist
+    int blocks_x = map->block_count / map->blocks_y;
+    for (int bx = 0; bx < CHUNK_BLOCKS; bx++) {
+        int gx = cx * CHUNK_BLOCKS + bx;
+        for (int by = 0; by < CHUNK_BLOCKS; by++) {
+            int gy = cy * CHUNK_BLOCKS + by;
+            if (gx < blocks_x && gy < map->blocks_y) {
+                uint64_t word = ~(uint64_t)0;
+                if (data) {
+                    memcpy(&word, data + (bx * CHUNK_BLOCKS + by) * sizeof(uint64_t), sizeof(word));
+                }
+                map->solid[gx * map->blocks_y + gy] = word;
+            }
+        }
+    }
+}
+
+static void map_stream_evict(MapStream* stream, int chunk) {
+    int slot_mask = (1 << stream->window_shift) - 1;
+    int cx = chunk / stream->chunks_y;
+    int cy = chunk % stream->chunks_y;
+
+    map_stream_fill_slot(stream, chunk, NULL);
+    stream->slots[((cx & slot_mask) << stream->window_shift) + (cy & slot_mask)] = -1;
+    stream->resident[chunk] = 0;
+    stream->stats.evictions++;
+    stream->stats.resident--;
+}
+
+static void map_stream_install(MapStream* stream, int chunk, const uint8_t* data, Uint64 requested) {
+    int slot_mask = (1 << stream->window_shift) - 1;
+    int cx = chunk / stream->chunks_y;
+    int cy = chunk % stream->chunks_y;
+    int* slot = &stream->slots[((cx & slot_mask) << stream->window_shift) + (cy & slot_mask)];
+
+    // The window is wider than the load range, so whatever holds the slot
+    // is out of range
+    if (*slot >= 0) {
+        map_stream_evict(stream, *slot);
+    }
+    map_stream_fill_slot(stream, chunk, data);
+    *slot = chunk;
+    stream->resident[chunk] = 1;
+
+    double latency = map_stream_ms(SDL_GetPerformanceCounter() - requested);
+    stream->stats.loads++;
+    stream->stats.resident++;
+    stream->stats.latency_total_ms += latency;
+    if (latency > stream->stats.latency_max_ms) {
+        stream->stats.latency_max_ms = latency;
+    }
+}
+
+// Reads queued chunks, oldest request first
+static int map_stream_loader(void* data) {
+    MapStream* stream = (MapStream*)data;
+
+    SDL_LockMutex(stream->lock);
+    while (!stream->quit) {
+        MapStreamRequest* next = NULL;
+        for (int i = 0; i < MAP_STREAM_QUEUE; i++) {
+            MapStreamRequest* request = &stream->requests[i];
+            if (request->state == REQUEST_QUEUED && (!next || request->requested < next->requested)) {
+                next = request;
+            }
+        }
+        if (!next) {
+            SDL_CondWait(stream->wake, stream->lock);
+            continue;
+        }
+
+        next->state = REQUEST_LOADING;
+        SDL_UnlockMutex(stream->lock);
+        bool ok = map_stream_read(stream, next->chunk, next->data);
+        SDL_LockMutex(stream->lock);
+        next->ok = ok;
+        next->state = REQUEST_DONE;
+    }
+    SDL_UnlockMutex(stream->lock);
+    return 0;
+}
+
+static int map_stream_distance(int chunk, int chunks_y, int cx, int cy) {
+    int dx = abs(chunk / chunks_y - cx);
+    int dy = abs(chunk % chunks_y - cy);
+    return dx > dy ? dx : dy;
+}
+
+// Count a chunk in load range and queue it if it is missing
+static bool map_stream_visit(MapStream* stream, int cx, int cy) {
+    if (cx < 0 || cy < 0 || cx >= stream->chunks_x || cy >= stream->chunks_y) {
+        return false;
+    }
+    int chunk = cx * stream->chunks_y + cy;
+    if (stream->resident[chunk]) {
+        stream->stats.hits++;
+        return false;
+    }
+    stream->stats.misses++;
+    if (stream->pending[chunk]) {
+        return false;
+    }
+
+    for (int i = 0; i < MAP_STREAM_QUEUE; i++) {
+        MapStreamRequest* request = &stream->requests[i];
+        if (request->state == REQUEST_FREE) {
+            request->chunk = chunk;
+            request->requested = SDL_GetPerformanceCounter();
+            request->state = REQUEST_QUEUED;
+            stream->pending[chunk] = 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+void map_stream_update(MapStream* stream, float x, float y) {
+    int cx = (int)x >> MAP_CHUNK_SHIFT;
+    int cy = (int)y >> MAP_CHUNK_SHIFT;
+    int keep = stream->radius + 1;
+    bool changed = false;
+
+    SDL_LockMutex(stream->lock);
+
+    // No loader thread: read this frame's requests here
+    if (!stream->thread) {
+        for (int i = 0; i < MAP_STREAM_QUEUE; i++) {
+            MapStreamRequest* request = &stream->requests[i];
+            if (request->state == REQUEST_QUEUED) {
+                request->ok = map_stream_read(stream, request->chunk, request->data);
+                request->state = REQUEST_DONE;
+            }
+        }
+    }
+
+    // Install finished chunks still in range; drop requests that the
+    // player has since moved away from
+    for (int i = 0; i < MAP_STREAM_QUEUE; i++) {
+        MapStreamRequest* request = &stream->requests[i];
+        bool near = map_stream_distance(request->chunk, stream->chunks_y, cx, cy) <= keep;
+        if (request->state == REQUEST_DONE) {
+            if (!request->ok) {
+                stream->stats.failures++;
+            } else if (near) {
+                map_stream_install(stream, request->chunk, request->data, request->requested);
+                changed = true;
+            }
+        } else if (request->state != REQUEST_QUEUED || near) {
+            continue;
+        }
+        stream->pending[request->chunk] = 0;
+        request->state = REQUEST_FREE;
+    }
+
+    // Visit the load range in rings around the player so the nearest
+    // missing chunks are queued first
+    bool queued = false;
+    for (int d = 0; d <= stream->radius; d++) {
+        for (int i = -d; i <= d; i++) {
+            queued |= map_stream_visit(stream, cx - d, cy + i);
+            if (d > 0) {
+                queued |= map_stream_visit(stream, cx + d, cy + i);
+            }
+        }
+        for (int i = -d + 1; i <= d - 1; i++) {
+            queued |= map_stream_visit(stream, cx + i, cy - d);
+            queued |= map_stream_visit(stream, cx + i, cy + d);
+        }
+    }
+    if (queued) {
+        SDL_CondSignal(stream->wake);
+    }
+    SDL_UnlockMutex(stream->lock);
+
+    // Over budget: evict the farthest chunks outside the load range
+    int slot_count = 1 << (2 * stream->window_shift);
+    while (stream->stats.resident > stream->budget) {
+        int farthest = -1;
+        int farthest_distance = stream->radius;
+        for (int s = 0; s < slot_count; s++) {
+            int chunk = stream->slots[s];
+            if (chunk >= 0) {
+                int distance = map_stream_distance(chunk, stream->chunks_y, cx, cy);
+                if (distance > farthest_distance) {
+                    farthest = chunk;
+                    farthest_distance = distance;
+                }
+            }
+        }
+        if (farthest < 0) {
+            break;
+        }
+        map_stream_evict(stream, farthest);
+        changed = true;
+    }
+
+    if (changed) {
+        map_revision++;
+    }
+}
+
+bool map_stream_open(MapStream* stream, Map* map, const char* filename, int radius, int budget) {
+    memset(stream, 0, sizeof(*stream));
+    memset(map, 0, sizeof(*map));
+    stream->map = map;
+    stream->fd = open(filename, O_RDONLY);
+    if (stream->fd < 0) {
+        fprintf(stderr, "Failed to open map file: %s\n", filename);
+        return false;
+    }
+
+    MapStreamHeader header;
+    if (pread(stream->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, MAP_STREAM_MAGIC, 4) != 0 || header.byte_order != MAP_STREAM_BYTE_ORDER) {
+        fprintf(stderr, "%s is not a chunked world for this machine\n", filename);
+        return false;
+    }
+    if (header.version != MAP_STREAM_VERSION || header.chunk_shift != MAP_CHUNK_SHIFT) {
+        fprintf(stderr, "Chunked world %s is version %u, expected %d; convert it again\n",
+                filename, header.version, MAP_STREAM_VERSION);
+        return false;
+    }
+    if (!map_set_size(map, header.width, header.height)) {
+        return false;
+    }
+    stream->chunks_x = (map->height + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+    stream->chunks_y = (map->width + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+    int chunk_count = stream->chunks_x * stream->chunks_y;
+
+    struct stat st;
+    if (fstat(stream->fd, &st) != 0 ||
+        (long long)st.st_size < MAP_STREAM_HEADER_BYTES + (long long)chunk_count * (long long)RECORD_BYTES) {
+        fprintf(stderr, "Chunked world %s is truncated\n", filename);
+        return false;
+    }
+
+    // The window must hold the load range plus one chunk so a chunk is
+    // always out of range before another takes its slot
+    if (radius < 1) radius = 1;
+    if (radius > MAP_STREAM_MAX_RADIUS) radius = MAP_STREAM_MAX_RADIUS;
+    stream->radius = radius;
+    while ((1 << stream->window_shift) < 2 * radius + 2) {
+        stream->window_shift++;
+    }
+    int window = 1 << stream->window_shift;
+    int min_budget = (2 * radius + 1) * (2 * radius + 1);
+    stream->budget = budget < min_budget ? min_budget : budget > window * window ? window * window : budget;
+
+    int window_tiles = window << MAP_CHUNK_SHIFT;
+    map->stride = window_tiles;
+    map->mask_x = window_tiles - 1;
+    map->mask_y = window_tiles - 1;
+    map->tile_count = window_tiles * window_tiles;
+    map->chunks_y = stream->chunks_y;
+    map->player_spawn_x = header.spawn_x;
+    map->player_spawn_y = header.spawn_y;
+
+    if (header.entity_count > 0) {
+        size_t bytes = (size_t)header.entity_count * sizeof(MapEntity);
+        map->entities = (MapEntity*)malloc(bytes);
+        if (!map->entities || header.entity_offset > (uint64_t)st.st_size ||
+            bytes > (uint64_t)st.st_size - header.entity_offset ||
+            pread(stream->fd, map->entities, bytes, (off_t)header.entity_offset) != (ssize_t)bytes) {
+            fprintf(stderr, "Failed to read the entities of %s\n", filename);
+            return false;
+        }
+        map->entity_total = (int)header.entity_count;
+        int bad = map_check_entities(map);
+        if (bad >= 0) {
+            fprintf(stderr, "Chunked world %s has a bad entity %d\n", filename, bad);
+            return false;
+        }
+    }
+
+    size_t grid_bytes = (size_t)map->tile_count + 4;
+    map->tiles = (uint8_t*)malloc(grid_bytes);
+    map->floor = (uint8_t*)calloc(grid_bytes, 1);
+    map->ceiling = (uint8_t*)calloc(grid_bytes, 1);
+    map->distance = (uint8_t*)calloc(grid_bytes, 1);
+    map->solid = (uint64_t*)malloc(((size_t)map->block_count + 1) * sizeof(uint64_t));
+    stream->resident = (uint8_t*)calloc((size_t)chunk_count, 1);
+    stream->pending = (uint8_t*)calloc((size_t)chunk_count, 1);
+    stream->slots = (int*)malloc((size_t)window * window * sizeof(int));
+    bool ok = map->tiles && map->floor && map->ceiling && map->distance && map->solid &&
+              stream->resident && stream->pending && stream->slots;
+    for (int i = 0; i < MAP_STREAM_QUEUE && ok; i++) {
+        stream->requests[i].data = (uint8_t*)malloc(RECORD_BYTES);
+        ok = stream->requests[i].data != NULL;
+    }
+    stream->lock = SDL_CreateMutex();
+    stream->wake = SDL_CreateCond();
+    if (!ok || !stream->lock || !stream->wake) {
+        fprintf(stderr, "Failed to allocate streamed %dx%d map\n", map->width, map->height);
+        return false;
+    }
+
+    // Nothing is resident yet, so everything is solid
+    memset(map->tiles, MAP_STREAM_UNLOADED_TILE, (size_t)map->tile_count);
+    map->tiles[map->tile_count] = 0;
+    memset(map->solid, 0xFF, ((size_t)map->block_count + 1) * sizeof(uint64_t));
+    for (int i = 0; i < window * window; i++) {
+        stream->slots[i] = -1;
+    }
+    map->resident = stream->resident;
+
+    // Load the range around the spawn before play starts
+    int cx = (int)header.spawn_x >> MAP_CHUNK_SHIFT;
+    int cy = (int)header.spawn_y >> MAP_CHUNK_SHIFT;
+    for (int x = cx - radius; x <= cx + radius; x++) {
+        for (int y = cy - radius; y <= cy + radius; y++) {
+            if (x >= 0 && y >= 0 && x < stream->chunks_x && y < stream->chunks_y) {
+                Uint64 requested = SDL_GetPerformanceCounter();
+                int chunk = x * stream->chunks_y + y;
+                if (!map_stream_read(stream, chunk, stream->requests[0].data)) {
+                    fprintf(stderr, "Failed to read chunk %d of %s\n", chunk, filename);
+                    return false;
+                }
+                map_stream_install(stream, chunk, stream->requests[0].data, requested);
+            }
+        }
+    }
+    map_build_free_cells(map);
+    map_revision++;
+
+    stream->thread = SDL_CreateThread(map_stream_loader, "map_stream", stream);
+    if (!stream->thread) {
+        printf("Map stream: no loader thread (%s), reading chunks between frames\n", SDL_GetError());
+    }
+
+    printf("Map streamed: %dx%d in %dx%d chunks, %d resident around spawn (%.1f, %.1f), budget %d chunks\n",
+           map->width, map->height, stream->chunks_x, stream->chunks_y, stream->stats.resident,
+           map->player_spawn_x, map->player_spawn_y, stream->budget);
+    return true;
+}
+
+void map_stream_close(MapStream* stream) {
+    if (stream->thread) {
+        SDL_LockMutex(stream->lock);
+        stream->quit = true;
+        SDL_CondSignal(stream->wake);
+        SDL_UnlockMutex(stream->lock);
+        SDL_WaitThread(stream->thread, NULL);
+        stream->thread = NULL;
+    }
+    if (stream->wake) {
+        SDL_DestroyCond(stream->wake);
+    }
+    if (stream->lock) {
+        SDL_DestroyMutex(stream->lock);
+    }
+    if (stream->fd >= 0) {
+        close(stream->fd);
+    }
+    for (int i = 0; i < MAP_STREAM_QUEUE; i++) {
+        free(stream->requests[i].data);
+    }
+    if (stream->map) {
+        stream->map->resident = NULL;
+        map_free(stream->map);
+    }
+    free(stream->resident);
+    free(stream->pending);
+    free(stream->slots);
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = -1;
+}
+
+void map_stream_print_stats(const MapStream* stream) {
+    const MapStreamStats* s = &stream->stats;
+    long long lookups = s->hits + s->misses;
+    printf("Map stream: %d chunks resident (budget %d)\n", s->resident, stream->budget);
+    printf("  Range checks:  %lld hits, %lld misses (%.1f%% hit)\n",
+           s->hits, s->misses, lookups ? 100.0 * s->hits / lookups : 100.0);
+    printf("  Loads:         %lld (%lld failed), %lld evictions\n", s->loads, s->failures, s->evictions);
+    printf("  Load latency:  %.2f ms average, %.2f ms max\n",
+           s->loads ? s->latency_total_ms / s->loads : 0.0, s->latency_max_ms);
+}
+
+bool map_stream_save(const Map* map, const char* filename) {
+    if (map->resident) {
+        fprintf(stderr, "Can't save a streamed map\n");
+        return false;
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create %s\n", filename);
+        return false;
+    }
+
+    uint8_t header_bytes[MAP_STREAM_HEADER_BYTES];
+    MapStreamHeader header;
+    memset(header_bytes, 0, sizeof(header_bytes));
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAP_STREAM_MAGIC, 4);
+    header.byte_order = MAP_STREAM_BYTE_ORDER;
+    header.version = MAP_STREAM_VERSION;
+    header.width = map->width;
+    header.height = map->height;
+    header.spawn_x = map->player_spawn_x;
+    header.spawn_y = map->player_spawn_y;
+    header.chunk_shift = MAP_CHUNK_SHIFT;
+    int chunks_x = (map->height + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+    int chunks_y = (map->width + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+    header.entity_count = (uint32_t)map->entity_total;
+    header.entity_offset = MAP_STREAM_HEADER_BYTES + (uint64_t)chunks_x * chunks_y * RECORD_BYTES;
+    memcpy(header_bytes, &header, sizeof(header));
+    bool ok = fwrite(header_bytes, sizeof(header_bytes), 1, file) == 1;
+
+    static uint8_t record[RECORD_BYTES];
+    int blocks_x = map->block_count / map->blocks_y;
+
+    for (int cx = 0; cx < chunks_x && ok; cx++) {
+        for (int cy = 0; cy < chunks_y && ok; cy++) {
+            int x0 = cx << MAP_CHUNK_SHIFT;
+            int y0 = cy << MAP_CHUNK_SHIFT;
+            int rows = map->height - x0 < MAP_CHUNK_SIZE ? map->height - x0 : MAP_CHUNK_SIZE;
+            int cols = map->width - y0 < MAP_CHUNK_SIZE ? map->width - y0 : MAP_CHUNK_SIZE;
+            memset(record, 0, sizeof(record));
+
+            for (int bx = 0; bx < CHUNK_BLOCKS; bx++) {
+                for (int by = 0; by < CHUNK_BLOCKS; by++) {
+                    int gx = cx * CHUNK_BLOCKS + bx;
+                    int gy = cy * CHUNK_BLOCKS + by;
+                    if (gx < blocks_x && gy < map->blocks_y) {
+                        memcpy(record + (bx * CHUNK_BLOCKS + by) * sizeof(uint64_t),
+                               &map->solid[gx * map->blocks_y + gy], sizeof(uint64_t));
+                    }
+                }
+            }
+            for (int r = 0; r < rows; r++) {
+                size_t src = (size_t)(x0 + r) * map->width + y0;
+                memcpy(record + RECORD_TILES + r * MAP_CHUNK_SIZE, map->tiles + src, (size_t)cols);
+                memcpy(record + RECORD_FLOOR + r * MAP_CHUNK_SIZE, map->floor + src, (size_t)cols);
+                memcpy(record + RECORD_CEILING + r * MAP_CHUNK_SIZE, map->ceiling + src, (size_t)cols);
+            }
+
+            // Distances stop at the chunk edge, which the stream treats as
+            // solid, so a skip never lands in a chunk that isn't resident
+            map_build_distance(record + RECORD_TILES, MAP_CHUNK_SIZE, record + RECORD_DISTANCE, MAP_CHUNK_SIZE,
+                               rows, cols, 0, 0, rows - 1, cols - 1);
+            ok = fwrite(record, sizeof(record), 1, file) == 1;
+        }
+    }
+    if (ok && map->entity_total > 0) {
+        ok = fwrite(map->entities, sizeof(MapEntity), (size_t)map->entity_total, file) == (size_t)map->entity_total;
+    }
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write %s\n", filename);
+        remove(filename);
+    }
+    return ok;
+}
@@ -0,0 +1,89 @@
+#include "map_watch.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+// The directory is watched rather than the file: editors that save by
+// renaming a new file over the old one would leave a file watch pointing
+// at the replaced inode
+bool map_watch_open(MapWatch* watch, const char* filename) {
+    watch->fd = -1;
+    const char* slash = strrchr(filename, '/');
+    const char* name = slash ? slash + 1 : filename;
+    char dir[4096];
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (slash == filename) {
+        strcpy(dir, "/");
+    } else if ((size_t)(slash - filename) < sizeof(dir)) {
+        memcpy(dir, filename, (size_t)(slash - filename));
+        dir[slash - filename] = '\0';
+    } else {
+        return false;
+    }
+    if (strlen(name) >= sizeof(watch->name)) {
+        return false;
+    }
+    strcpy(watch->name, name);
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->fd < 0 || inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "Can't watch %s for changes: %s\n", filename, strerror(errno));
+        map_watch_close(watch);
+        return false;
+    }
+    printf("Watching %s for changes\n", filename);
+    return true;
+}
+
+bool map_watch_poll(MapWatch* watch) {
+    if (watch->fd < 0) {
+        return false;
+    }
+
+    // Drain every pending event; several saves in one frame are one reload
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t len;
+    while ((len = read(watch->fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + len;) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            if (event->len > 0 && strcmp(event->name, watch->name) == 0) {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+void map_watch_close(MapWatch* watch) {
+    if (watch->fd >= 0) {
+        close(watch->fd);
+    }
+    watch->fd = -1;
+}
+
+#else
+
+bool map_watch_open(MapWatch* watch, const char* filename) {
+    watch->fd = -1;
+    fprintf(stderr, "Can't watch %s for changes: map hot-reload needs inotify\n", filename);
+    return false;
+}
+
+bool map_watch_poll(MapWatch* watch) {
+    (void)watch;
+    return false;
+}
+
+void map_watch_close(MapWatch* watch) {
+    watch->fd = -1;
+}
+
+#endif
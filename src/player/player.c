@@ -33,16 +33,16 @@ void player_init(Player* player, float x, float y) {
     player->footstep_timer = 0.0f;
 }
 
-void player_move_forward(Player* player, float delta_time, SoundManager* sm) {
+void player_move_forward(Player* player, const Map* map, float delta_time, SoundManager* sm) {
     float new_x = player->x + player->dir_x * player->move_speed * delta_time;
     float new_y = player->y + player->dir_y * player->move_speed * delta_time;
 
     bool moved = false;
-    if (world_map[(int)new_x][(int)player->y] == 0) {
+    if (!map_solid(map, (int)new_x, (int)player->y)) {
         player->x = new_x;
         moved = true;
     }
-    if (world_map[(int)player->x][(int)new_y] == 0) {
+    if (!map_solid(map, (int)player->x, (int)new_y)) {
         player->y = new_y;
         moved = true;
     }
@@ -57,16 +57,16 @@ void player_move_forward(Player* player, float delta_time, SoundManager* sm) {
     }
 }
 
-void player_move_backward(Player* player, float delta_time, SoundManager* sm) {
+void player_move_backward(Player* player, const Map* map, float delta_time, SoundManager* sm) {
     float new_x = player->x - player->dir_x * player->move_speed * delta_time;
     float new_y = player->y - player->dir_y * player->move_speed * delta_time;
 
     bool moved = false;
-    if (world_map[(int)new_x][(int)player->y] == 0) {
+    if (!map_solid(map, (int)new_x, (int)player->y)) {
         player->x = new_x;
         moved = true;
     }
-    if (world_map[(int)player->x][(int)new_y] == 0) {
+    if (!map_solid(map, (int)player->x, (int)new_y)) {
         player->y = new_y;
         moved = true;
     }
@@ -0,0 +1,326 @@
+#include "floor_caster.h"
+#include "map.h"
+#include "palette.h"
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Floors slightly dimmed so walls stand out, ceilings darker like y-side walls
+#define FLOOR_SHADE 1
+#define CEILING_SHADE TEXTURE_SHADE_SIDE
+
+// Per-row constants: world position under column x is base + step * x
+typedef struct {
+    float base_x;
+    float base_y;
+    float step_x;
+    float step_y;
+    int y;
+    bool ceiling;               // Row is above the horizon
+    const int* limit;           // wall_top (ceiling rows) or wall_bottom (floor rows)
+    const uint8_t* grid;        // The map's ceiling or floor grid
+    int grid_stride;            // Entries per row of grid
+    int mask_x;                 // Wraps tile coordinates into a streamed map's grid
+    int mask_y;
+    int max_x;                  // Last tile along each axis
+    int max_y;
+    const uint32_t* texels;     // shade_data at this row's shade level
+    uint32_t flat;              // Color for tiles without a texture
+    const Texture* textures;    // Palette mode: texel indices per texture
+    const uint8_t* colormap;    // Palette mode: this row's shade level
+    uint8_t flat_index;
+} FloorRow;
+
+static void floor_row_setup(const FloorPass* pass, int y, FloorRow* row) {
+    const Player* player = pass->player;
+    int width = pass->target->width;
+    int height = pass->target->height;
+    int half_height = height / 2;
+
+    // Rays through the left and right edges of the screen
+    float ray_dir_x0 = player->dir_x - player->plane_x;
+    float ray_dir_y0 = player->dir_y - player->plane_y;
+    float ray_dir_x1 = player->dir_x + player->plane_x;
+    float ray_dir_y1 = player->dir_y + player->plane_y;
+
+    // Distance to the floor or ceiling seen through the middle of row y
+    row->ceiling = y < half_height;
+    float p = row->ceiling ? half_height - (y + 0.5f) : (y + 0.5f) - half_height;
+    float row_distance = 0.5f * height / p;
+    int shade = row->ceiling ? CEILING_SHADE : FLOOR_SHADE;
+
+    row->step_x = row_distance * (ray_dir_x1 - ray_dir_x0) / width;
+    row->step_y = row_distance * (ray_dir_y1 - ray_dir_y0) / width;
+    row->base_x = player->x + row_distance * ray_dir_x0;
+    row->base_y = player->y + row_distance * ray_dir_y0;
+    row->y = y;
+
+    row->limit = row->ceiling ? pass->wall_top : pass->wall_bottom;
+    row->grid = row->ceiling ? pass->map->ceiling : pass->map->floor;
+    row->grid_stride = pass->map->stride;
+    row->mask_x = pass->map->mask_x;
+    row->mask_y = pass->map->mask_y;
+    row->max_x = pass->map->height - 1;
+    row->max_y = pass->map->width - 1;
+    row->texels = pass->tm->shade_data + shade * TEXTURE_CHAIN_TEXELS;
+    row->flat = row->ceiling ? pass->ceiling_color : pass->floor_color;
+
+    const Palette* palette = palette_get();
+    row->textures = pass->tm->textures;
+    row->colormap = palette->shade[shade];
+    row->flat_index = palette_quantize(palette, row->flat);
+}
+
+// Is pixel x of this row left uncovered by the wall pass?
+static inline bool floor_visible(const FloorRow* row, int x) {
+    return row->ceiling ? row->y < row->limit[x] : row->y >= row->limit[x];
+}
+
+// Color of texel (column-major offset) of a tile's texture
+static inline uint32_t floor_lookup(const FloorRow* row, int tile, int texel) {
+    if (tile <= 0) {
+        return row->flat;
+    }
+    if (tile > MAX_TEXTURES) tile = MAX_TEXTURES;
+    return row->texels[(tile - 1) * TEXTURE_SHADE_SIZE + texel];
+}
+
+// Palette index of the same texel
+static inline uint8_t floor_lookup_index(const FloorRow* row, int tile, int texel) {
+    if (tile <= 0) {
+        return row->flat_index;
+    }
+    if (tile > MAX_TEXTURES) tile = MAX_TEXTURES;
+    return row->colormap[row->textures[tile - 1].indices[texel]];
+}
+
+// Tile and texel offset under pixel x. Scalar reference: the SIMD kernels
+// below produce exactly the same coordinates.
+static inline void floor_sample(const FloorRow* row, int x, int* tile, int* texel) {
+    float world_x = row->base_x + row->step_x * (float)x;
+    float world_y = row->base_y + row->step_y * (float)x;
+    int cell_x = (int)world_x;
+    int cell_y = (int)world_y;
+    int tex_x = (int)((world_x - (float)cell_x) * TEXTURE_WIDTH) & (TEXTURE_WIDTH - 1);
+    int tex_y = (int)((world_y - (float)cell_y) * TEXTURE_HEIGHT) & (TEXTURE_HEIGHT - 1);
+
+    // Rounding can land just outside the map on covered pixels
+    if (cell_x < 0) cell_x = 0;
+    if (cell_x > row->max_x) cell_x = row->max_x;
+    if (cell_y < 0) cell_y = 0;
+    if (cell_y > row->max_y) cell_y = row->max_y;
+
+    *tile = row->grid[(cell_x & row->mask_x) * row->grid_stride + (cell_y & row->mask_y)];
+    *texel = tex_x * TEXTURE_HEIGHT + tex_y;
+}
+
+#if defined(__AVX2__)
+
+// 8 lanes: vector coordinates, hardware gather for tiles and texels
+static int floor_shade_lanes(const FloorRow* row, uint32_t* dst, int x_stride, int x) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+
+    // Skip groups hidden behind walls before doing any texturing
+    __m256i limit = _mm256_loadu_si256((const __m256i*)(row->limit + x));
+    __m256i visible = row->ceiling
+        ? _mm256_cmpgt_epi32(limit, _mm256_set1_epi32(row->y))
+        : _mm256_cmpgt_epi32(_mm256_set1_epi32(row->y + 1), limit);
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(visible));
+    if (mask == 0) {
+        return 0;
+    }
+
+    __m256 xs = _mm256_add_ps(_mm256_set1_ps((float)x), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 world_x = _mm256_add_ps(_mm256_set1_ps(row->base_x), _mm256_mul_ps(_mm256_set1_ps(row->step_x), xs));
+    __m256 world_y = _mm256_add_ps(_mm256_set1_ps(row->base_y), _mm256_mul_ps(_mm256_set1_ps(row->step_y), xs));
+    __m256i cell_x = _mm256_cvttps_epi32(world_x);
+    __m256i cell_y = _mm256_cvttps_epi32(world_y);
+    __m256i tex_x = _mm256_and_si256(
+        _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(world_x, _mm256_cvtepi32_ps(cell_x)), _mm256_set1_ps(TEXTURE_WIDTH))),
+        _mm256_set1_epi32(TEXTURE_WIDTH - 1));
+    __m256i tex_y = _mm256_and_si256(
+        _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(world_y, _mm256_cvtepi32_ps(cell_y)), _mm256_set1_ps(TEXTURE_HEIGHT))),
+        _mm256_set1_epi32(TEXTURE_HEIGHT - 1));
+    cell_x = _mm256_min_epi32(_mm256_max_epi32(cell_x, zero), _mm256_set1_epi32(row->max_x));
+    cell_y = _mm256_min_epi32(_mm256_max_epi32(cell_y, zero), _mm256_set1_epi32(row->max_y));
+
+    // Tile byte under each lane (4-byte gathers; map grids are padded for
+    // the last tile), then the texel of textured tiles (flat color elsewhere)
+    __m256i tile_index = _mm256_add_epi32(
+        _mm256_mullo_epi32(_mm256_and_si256(cell_x, _mm256_set1_epi32(row->mask_x)), _mm256_set1_epi32(row->grid_stride)),
+        _mm256_and_si256(cell_y, _mm256_set1_epi32(row->mask_y)));
+    __m256i tile = _mm256_and_si256(_mm256_i32gather_epi32((const int*)row->grid, tile_index, 1),
+                                    _mm256_set1_epi32(0xFF));
+    __m256i textured = _mm256_cmpgt_epi32(tile, zero);
+    __m256i tex_num = _mm256_min_epi32(_mm256_sub_epi32(tile, one), _mm256_set1_epi32(MAX_TEXTURES - 1));
+    __m256i texel_index = _mm256_add_epi32(
+        _mm256_mullo_epi32(tex_num, _mm256_set1_epi32(TEXTURE_SHADE_SIZE)),
+        _mm256_add_epi32(_mm256_mullo_epi32(tex_x, _mm256_set1_epi32(TEXTURE_HEIGHT)), tex_y));
+    __m256i color = _mm256_mask_i32gather_epi32(_mm256_set1_epi32((int)row->flat), (const int*)row->texels,
+                                                texel_index, textured, 4);
+
+    if (x_stride == 1) {
+        _mm256_maskstore_epi32((int*)(dst + x), visible, color);
+    } else {
+        uint32_t colors[8];
+        _mm256_storeu_si256((__m256i*)colors, color);
+        for (int i = 0; i < 8; i++) {
+            if (mask & (1 << i)) {
+                dst[(x + i) * x_stride] = colors[i];
+            }
+        }
+    }
+
+    int written = 0;
+    for (; mask; mask &= mask - 1) {
+        written++;
+    }
+    return written;
+}
+
+#elif defined(__SSE2__)
+
+// Clamp each lane to [0, max]
+static inline __m128i floor_clamp_epi32(__m128i v, int max) {
+    __m128i hi = _mm_set1_epi32(max);
+    v = _mm_andnot_si128(_mm_cmplt_epi32(v, _mm_setzero_si128()), v);
+    __m128i over = _mm_cmpgt_epi32(v, hi);
+    return _mm_or_si128(_mm_and_si128(over, hi), _mm_andnot_si128(over, v));
+}
+
+// 4 lanes: vector coordinates, scalar tile and texel lookups (no gather)
+static int floor_shade_lanes(const FloorRow* row, uint32_t* dst, int x_stride, int x) {
+    // Skip groups hidden behind walls before doing any texturing
+    __m128i limit = _mm_loadu_si128((const __m128i*)(row->limit + x));
+    __m128i visible = row->ceiling
+        ? _mm_cmpgt_epi32(limit, _mm_set1_epi32(row->y))
+        : _mm_cmpgt_epi32(_mm_set1_epi32(row->y + 1), limit);
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(visible));
+    if (mask == 0) {
+        return 0;
+    }
+
+    __m128 xs = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0, 1, 2, 3));
+    __m128 world_x = _mm_add_ps(_mm_set1_ps(row->base_x), _mm_mul_ps(_mm_set1_ps(row->step_x), xs));
+    __m128 world_y = _mm_add_ps(_mm_set1_ps(row->base_y), _mm_mul_ps(_mm_set1_ps(row->step_y), xs));
+    __m128i cell_x = _mm_cvttps_epi32(world_x);
+    __m128i cell_y = _mm_cvttps_epi32(world_y);
+    __m128i tex_x = _mm_and_si128(
+        _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(world_x, _mm_cvtepi32_ps(cell_x)), _mm_set1_ps(TEXTURE_WIDTH))),
+        _mm_set1_epi32(TEXTURE_WIDTH - 1));
+    __m128i tex_y = _mm_and_si128(
+        _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(world_y, _mm_cvtepi32_ps(cell_y)), _mm_set1_ps(TEXTURE_HEIGHT))),
+        _mm_set1_epi32(TEXTURE_HEIGHT - 1));
+
+    int cells_x[4], cells_y[4], texs_x[4], texs_y[4];
+    _mm_storeu_si128((__m128i*)cells_x, floor_clamp_epi32(cell_x, row->max_x));
+    _mm_storeu_si128((__m128i*)cells_y, floor_clamp_epi32(cell_y, row->max_y));
+    _mm_storeu_si128((__m128i*)texs_x, tex_x);
+    _mm_storeu_si128((__m128i*)texs_y, tex_y);
+
+    int written = 0;
+    for (int i = 0; i < 4; i++) {
+        if (mask & (1 << i)) {
+            int tile = row->grid[(cells_x[i] & row->mask_x) * row->grid_stride + (cells_y[i] & row->mask_y)];
+            dst[(x + i) * x_stride] = floor_lookup(row, tile, texs_x[i] * TEXTURE_HEIGHT + texs_y[i]);
+            written++;
+        }
+    }
+    return written;
+}
+
+#endif
+
+long long floor_cast_rows(const FloorPass* pass, int start, int end) {
+    RenderTarget* target = pass->target;
+    long long written = 0;
+
+    for (int y = start; y < end; y++) {
+        FloorRow row;
+        floor_row_setup(pass, y, &row);
+
+        // Palette mode: scalar byte lookups through the row's colormap
+        if (target->indices) {
+            uint8_t* dst = target->indices + y * target->y_stride;
+            for (int x = 0; x < target->width; x++) {
+                if (floor_visible(&row, x)) {
+                    int tile, texel;
+                    floor_sample(&row, x, &tile, &texel);
+                    dst[x * target->x_stride] = floor_lookup_index(&row, tile, texel);
+                    written++;
+                }
+            }
+            continue;
+        }
+
+        uint32_t* dst = target->pixels + y * target->y_stride;
+        int x = 0;
+
+#if FLOOR_LANES > 1
+        for (; x + FLOOR_LANES <= target->width; x += FLOOR_LANES) {
+            written += floor_shade_lanes(&row, dst, target->x_stride, x);
+        }
+#endif
+        for (; x < target->width; x++) {
+            if (floor_visible(&row, x)) {
+                int tile, texel;
+                floor_sample(&row, x, &tile, &texel);
+                dst[x * target->x_stride] = floor_lookup(&row, tile, texel);
+                written++;
+            }
+        }
+    }
+
+    return written;
+}
+
+long long floor_fill_rows(const FloorPass* pass, int start, int end) {
+    RenderTarget* target = pass->target;
+    const Palette* palette = palette_get();
+    int half_height = target->height / 2;
+    long long written = 0;
+
+    for (int y = start; y < end; y++) {
+        // Same split as the floor caster: wall_top bounds ceiling rows,
+        // wall_bottom floor rows
+        bool ceiling = y < half_height;
+        const int* limit = ceiling ? pass->wall_top : pass->wall_bottom;
+        uint32_t color = ceiling ? pass->ceiling_color : pass->floor_color;
+        uint8_t index = palette_quantize(palette, color);
+
+        int x = 0;
+        while (x < target->width) {
+            while (x < target->width && (ceiling ? y >= limit[x] : y < limit[x])) x++;
+            int run = x;
+            while (x < target->width && (ceiling ? y < limit[x] : y >= limit[x])) x++;
+            if (x == run) {
+                break;
+            }
+
+            if (target->indices) {
+                uint8_t* dst = target->indices + y * target->y_stride;
+                if (target->x_stride == 1) {
+                    memset(dst + run, index, x - run);
+                } else {
+                    for (int i = run; i < x; i++) dst[i * target->x_stride] = index;
+                }
+            } else {
+                uint32_t* dst = target->pixels + y * target->y_stride;
+                if (target->x_stride == 1) {
+                    for (int i = run; i < x; i++) dst[i] = color;
+                } else {
+                    for (int i = run; i < x; i++) dst[i * target->x_stride] = color;
+                }
+            }
+            written += x - run;
+        }
+    }
+
+    return written;
+}
@@ -5,7 +5,7 @@ void hud_draw_pixel(Engine* engine, int x, int y, uint32_t color) {
     if (x < 0 || x >= engine->screen_width || y < 0 || y >= engine->screen_height) {
         return;
     }
-    engine->pixels[y * engine->screen_width + x] = color;
+    engine_put_pixel(engine, y * engine->screen_width + x, color);
 }
 
 void hud_draw_rect(Engine* engine, int x, int y, int width, int height, uint32_t color) {
@@ -67,6 +67,7 @@ void hud_draw_crosshair(Engine* engine) {
 
     // Draw cross
     int size = 5;
+    engine_add_overlay(engine, center_x - size, center_y - size, size * 2 + 1, size * 2 + 1);
     for (int i = -size; i <= size; i++) {
         hud_draw_pixel(engine, center_x + i, center_y, color);
         hud_draw_pixel(engine, center_x, center_y + i, color);
@@ -243,21 +244,29 @@ void hud_draw_weapon_name(Engine* engine, Player* player) {
 }
 
 void hud_draw_game_over(Engine* engine) {
-    // Draw semi-transparent red overlay
-    for (int y = 0; y < engine->screen_height; y++) {
-        for (int x = 0; x < engine->screen_width; x++) {
-            uint32_t current = engine->pixels[y * engine->screen_width + x];
-            // Blend with red
-            uint32_t r = ((current >> 16) & 0xFF) / 2 + 64;
-            uint32_t g = ((current >> 8) & 0xFF) / 2;
-            uint32_t b = (current & 0xFF) / 2;
-            engine->pixels[y * engine->screen_width + x] = (r << 16) | (g << 8) | b;
+    // Draw semi-transparent red overlay over the 3D view
+    if (engine->palette_mode) {
+        const uint8_t* colormap = palette_get()->game_over;
+        for (int i = 0; i < engine->view_width * engine->view_height; i++) {
+            engine->view_indexed[i] = colormap[engine->view_indexed[i]];
+        }
+    } else {
+        for (int y = 0; y < engine->view_height; y++) {
+            for (int x = 0; x < engine->view_width; x++) {
+                uint32_t current = engine->view_pixels[y * engine->view_width + x];
+                // Blend with red
+                uint32_t r = ((current >> 16) & 0xFF) / 2 + 64;
+                uint32_t g = ((current >> 8) & 0xFF) / 2;
+                uint32_t b = (current & 0xFF) / 2;
+                engine->view_pixels[y * engine->view_width + x] = (r << 16) | (g << 8) | b;
+            }
         }
     }
 
     // Draw "GAME OVER" text (simplified - just draw large rectangles)
     int center_x = engine->screen_width / 2;
     int center_y = engine->screen_height / 2;
+    engine_add_overlay(engine, center_x - 125, center_y - 65, 250, 130);
 
     // Background rectangle
     hud_draw_rect(engine, center_x - 120, center_y - 60, 240, 120, 0x000000);
@@ -281,6 +290,7 @@ void hud_render(Engine* engine, Player* player) {
     int hud_y = engine->screen_height - hud_height;
 
     // Draw HUD background
+    engine_add_overlay(engine, 0, hud_y, engine->screen_width, hud_height);
     hud_draw_rect(engine, 0, hud_y, engine->screen_width, hud_height, 0x222222);
 
     // Draw top border line
@@ -2,24 +2,42 @@
 #include "sprite.h"
 #include <math.h>
 
-void minimap_render(Engine* engine, Player* player, Map* map, bool enabled) {
+// First tile and tile count of the minimap window along one axis, keeping
+// the player centered where the map is bigger than the window
+static void minimap_window(float player_pos, int map_size, int* first, int* count) {
+    *count = map_size < MINIMAP_TILES ? map_size : MINIMAP_TILES;
+    *first = (int)player_pos - *count / 2;
+    if (*first > map_size - *count) *first = map_size - *count;
+    if (*first < 0) *first = 0;
+}
+
+void minimap_render(Engine* engine, Player* player, const Map* map, bool enabled) {
     if (!enabled) {
         return;
     }
 
-    int minimap_size = map->width * MINIMAP_SCALE;
+    // World x runs down the minimap and world y across it, as in the map file
+    int first_x, rows, first_y, cols;
+    minimap_window(player->x, map->height, &first_x, &rows);
+    minimap_window(player->y, map->width, &first_y, &cols);
+
+    int minimap_w = cols * MINIMAP_SCALE;
+    int minimap_h = rows * MINIMAP_SCALE;
     int minimap_x = MINIMAP_MARGIN;
     int minimap_y = MINIMAP_MARGIN;
 
+    // Native-resolution overlay, with room for the direction line
+    int reach = 8 * MINIMAP_SCALE;
+    engine_add_overlay(engine, minimap_x - reach, minimap_y - reach, minimap_w + 2 * reach, minimap_h + 2 * reach);
+
     // Draw map tiles
-    // Note: world_map is indexed as [x][y] in the raycaster
-    for (int y = 0; y < map->height; y++) {
-        for (int x = 0; x < map->width; x++) {
-            int screen_x = minimap_x + y * MINIMAP_SCALE;  // Swapped: use y for x
-            int screen_y = minimap_y + x * MINIMAP_SCALE;  // Swapped: use x for y
+    for (int x = first_x; x < first_x + rows; x++) {
+        for (int y = first_y; y < first_y + cols; y++) {
+            int screen_x = minimap_x + (y - first_y) * MINIMAP_SCALE;
+            int screen_y = minimap_y + (x - first_x) * MINIMAP_SCALE;
 
             uint32_t color;
-            if (map->data[x][y] > 0) {  // Swapped indices
+            if (map_solid(map, x, y)) {
                 // Wall - white
                 color = 0xCCCCCC;
             } else {
@@ -33,7 +51,7 @@ void minimap_render(Engine* engine, Player* player, Map* map, bool enabled) {
                     int px = screen_x + dx;
                     int py = screen_y + dy;
                     if (px >= 0 && px < engine->screen_width && py >= 0 && py < engine->screen_height) {
-                        engine->pixels[py * engine->screen_width + px] = color;
+                        engine_put_pixel(engine, py * engine->screen_width + px, color);
                     }
                 }
             }
@@ -41,8 +59,8 @@ void minimap_render(Engine* engine, Player* player, Map* map, bool enabled) {
     }
 
     // Draw player position (swap x and y to match map orientation)
-    int player_screen_x = minimap_x + (int)(player->y * MINIMAP_SCALE);
-    int player_screen_y = minimap_y + (int)(player->x * MINIMAP_SCALE);
+    int player_screen_x = minimap_x + (int)((player->y - first_y) * MINIMAP_SCALE);
+    int player_screen_y = minimap_y + (int)((player->x - first_x) * MINIMAP_SCALE);
 
     // Draw player as red dot
     for (int dy = -2; dy <= 2; dy++) {
@@ -50,7 +68,7 @@ void minimap_render(Engine* engine, Player* player, Map* map, bool enabled) {
             int px = player_screen_x + dx;
             int py = player_screen_y + dy;
             if (px >= 0 && px < engine->screen_width && py >= 0 && py < engine->screen_height) {
-                engine->pixels[py * engine->screen_width + px] = 0xFF0000;
+                engine_put_pixel(engine, py * engine->screen_width + px, 0xFF0000);
             }
         }
     }
@@ -60,20 +78,22 @@ void minimap_render(Engine* engine, Player* player, Map* map, bool enabled) {
         int px = player_screen_x + (int)(player->dir_y * i * MINIMAP_SCALE / 2);
         int py = player_screen_y + (int)(player->dir_x * i * MINIMAP_SCALE / 2);
         if (px >= 0 && px < engine->screen_width && py >= 0 && py < engine->screen_height) {
-            engine->pixels[py * engine->screen_width + px] = 0xFFFF00;
+            engine_put_pixel(engine, py * engine->screen_width + px, 0xFFFF00);
         }
     }
 
     // Draw border
     uint32_t border_color = 0xFFFFFF;
-    for (int i = 0; i < minimap_size; i++) {
+    for (int i = 0; i < minimap_w; i++) {
         // Top border
-        engine->pixels[minimap_y * engine->screen_width + (minimap_x + i)] = border_color;
+        engine_put_pixel(engine, minimap_y * engine->screen_width + (minimap_x + i), border_color);
         // Bottom border
-        engine->pixels[(minimap_y + minimap_size - 1) * engine->screen_width + (minimap_x + i)] = border_color;
+        engine_put_pixel(engine, (minimap_y + minimap_h - 1) * engine->screen_width + (minimap_x + i), border_color);
+    }
+    for (int i = 0; i < minimap_h; i++) {
         // Left border
-        engine->pixels[(minimap_y + i) * engine->screen_width + minimap_x] = border_color;
+        engine_put_pixel(engine, (minimap_y + i) * engine->screen_width + minimap_x, border_color);
         // Right border
-        engine->pixels[(minimap_y + i) * engine->screen_width + (minimap_x + minimap_size - 1)] = border_color;
+        engine_put_pixel(engine, (minimap_y + i) * engine->screen_width + (minimap_x + minimap_w - 1), border_color);
     }
 }
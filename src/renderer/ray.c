@@ -0,0 +1,406 @@
+#include "ray.h"
+#include "map.h"
+#include <math.h>
+#include <stdbool.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Skip open space only when at least this many tiles around are empty
+#define RAY_SKIP_MIN 2
+
+bool ray_empty_skipping = true;
+
+// DDA state for one ray before traversal starts
+typedef struct {
+    int map_x;
+    int map_y;
+    int step_x;
+    int step_y;
+    float side_dist_x;
+    float side_dist_y;
+    float delta_dist_x;
+    float delta_dist_y;
+} RayStart;
+
+static void ray_start(float pos_x, float pos_y, float ray_dir_x, float ray_dir_y, RayStart* rs) {
+    // Which box of the map we're in
+    rs->map_x = (int)pos_x;
+    rs->map_y = (int)pos_y;
+
+    // Length of ray from one x or y-side to next x or y-side
+    rs->delta_dist_x = (ray_dir_x == 0) ? 1e30 : fabsf(1 / ray_dir_x);
+    rs->delta_dist_y = (ray_dir_y == 0) ? 1e30 : fabsf(1 / ray_dir_y);
+
+    // Calculate step and initial sideDist
+    if (ray_dir_x < 0) {
+        rs->step_x = -1;
+        rs->side_dist_x = (pos_x - rs->map_x) * rs->delta_dist_x;
+    } else {
+        rs->step_x = 1;
+        rs->side_dist_x = (rs->map_x + 1.0 - pos_x) * rs->delta_dist_x;
+    }
+    if (ray_dir_y < 0) {
+        rs->step_y = -1;
+        rs->side_dist_y = (pos_y - rs->map_y) * rs->delta_dist_y;
+    } else {
+        rs->step_y = 1;
+        rs->side_dist_y = (rs->map_y + 1.0 - pos_y) * rs->delta_dist_y;
+    }
+}
+
+// Fill in distance and wall_x once map_x/map_y/side of the hit are known
+static void ray_finish(float pos_x, float pos_y, float ray_dir_x, float ray_dir_y, int step_x, int step_y, RayHit* hit) {
+    // Calculate distance projected on camera direction
+    if (hit->side == 0) {
+        hit->perp_wall_dist = (hit->map_x - pos_x + (1 - step_x) / 2) / ray_dir_x;
+    } else {
+        hit->perp_wall_dist = (hit->map_y - pos_y + (1 - step_y) / 2) / ray_dir_y;
+    }
+
+    // Calculate where exactly the wall was hit
+    float wall_x;
+    if (hit->side == 0) {
+        wall_x = pos_y + hit->perp_wall_dist * ray_dir_y;
+    } else {
+        wall_x = pos_x + hit->perp_wall_dist * ray_dir_x;
+    }
+    hit->wall_x = wall_x - floorf(wall_x);
+}
+
+// Distance along the ray to its crossing of the steps-th grid line on one
+// axis. Every traversal path evaluates side distances with this one
+// expression, so skipping ahead lands on exactly the state that stepping
+// one tile at a time would reach.
+static inline float ray_side_dist(float first, float steps, float delta) {
+    return first + steps * delta;
+}
+
+// Number of grid line crossings on one axis that come before distance t,
+// given that the first `taken` of them already do
+static float ray_crossings_before(float first, float delta, float t, float taken) {
+    float n = (float)(int)((t - first) / delta) + 1.0f;
+    if (n < taken) n = taken;
+
+    // The division is only a guess, almost always right; settle it with the
+    // exact expression
+    while (n > taken && ray_side_dist(first, n - 1, delta) >= t) n--;
+    while (ray_side_dist(first, n, delta) < t) n++;
+    return n;
+}
+
+// Every tile within `reach` of the current one is empty, so advance the ray
+// to the last tile it visits before its (reach + 1)th step along either
+// axis. DDA steps happen in order of side distance, so counting the
+// crossings before that distance on each axis gives the tile stepping one
+// at a time would reach.
+static void ray_skip(const RayStart* rs, int reach, float* steps_x, float* steps_y, int* map_x, int* map_y) {
+    float nx = *steps_x + reach;
+    float ny = *steps_y + reach;
+    float t_x = ray_side_dist(rs->side_dist_x, nx, rs->delta_dist_x);
+    float t_y = ray_side_dist(rs->side_dist_y, ny, rs->delta_dist_y);
+
+    // Side distances only grow, so the nearer axis takes exactly reach steps
+    if (t_x <= t_y) {
+        ny = ray_crossings_before(rs->side_dist_y, rs->delta_dist_y, t_x, *steps_y);
+    } else {
+        nx = ray_crossings_before(rs->side_dist_x, rs->delta_dist_x, t_y, *steps_x);
+    }
+
+    *map_x += rs->step_x * (int)(nx - *steps_x);
+    *map_y += rs->step_y * (int)(ny - *steps_y);
+    *steps_x = nx;
+    *steps_y = ny;
+}
+
+// Tiles that can be skipped from (map_x, map_y), or 0 when too few are
+// clear to be worth it
+static inline int ray_skip_reach(const Map* map, int map_x, int map_y) {
+    if (!ray_empty_skipping) {
+        return 0;
+    }
+    int reach = map_distance(map, map_x, map_y) - 1;
+    return reach >= RAY_SKIP_MIN ? reach : 0;
+}
+
+void ray_cast(const Map* map, float pos_x, float pos_y, float ray_dir_x, float ray_dir_y, RayHit* hit) {
+    RayStart rs;
+    ray_start(pos_x, pos_y, ray_dir_x, ray_dir_y, &rs);
+
+    int map_x = rs.map_x;
+    int map_y = rs.map_y;
+    float steps_x = 0.0f;
+    float steps_y = 0.0f;
+    int side = 0;
+
+    // Perform DDA
+    for (;;) {
+        // Jump through open space
+        int reach = ray_skip_reach(map, map_x, map_y);
+        if (reach) {
+            ray_skip(&rs, reach, &steps_x, &steps_y, &map_x, &map_y);
+        }
+
+        // Jump to next map square, either in x-direction, or in y-direction
+        if (ray_side_dist(rs.side_dist_x, steps_x, rs.delta_dist_x) <
+            ray_side_dist(rs.side_dist_y, steps_y, rs.delta_dist_y)) {
+            steps_x += 1.0f;
+            map_x += rs.step_x;
+            side = 0;
+        } else {
+            steps_y += 1.0f;
+            map_y += rs.step_y;
+            side = 1;
+        }
+        // Check if ray has hit a wall
+        if (map_solid(map, map_x, map_y)) break;
+    }
+
+    hit->map_x = map_x;
+    hit->map_y = map_y;
+    hit->side = side;
+    ray_finish(pos_x, pos_y, ray_dir_x, ray_dir_y, rs.step_x, rs.step_y, hit);
+}
+
+#if RAY_PACKET_WIDTH > 1
+
+// Skip open space for each active lane whose tile allows it. Returns false
+// (and leaves everything alone) when no lane moved.
+static bool ray_skip_lanes(const Map* map, const RayStart* rs, int active_mask, float* steps_x, float* steps_y, int* map_x, int* map_y) {
+    bool moved = false;
+    for (int i = 0; i < RAY_PACKET_WIDTH; i++) {
+        if (!(active_mask & (1 << i))) {
+            continue;
+        }
+        int reach = ray_skip_reach(map, map_x[i], map_y[i]);
+        if (reach) {
+            ray_skip(&rs[i], reach, &steps_x[i], &steps_y[i], &map_x[i], &map_y[i]);
+            moved = true;
+        }
+    }
+    return moved;
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+// 8 lanes: compare/step with AVX, hardware gather for the tile lookups
+static void ray_traverse_packet(const Map* map, const RayStart* rs, int* out_map_x, int* out_map_y, int* out_side) {
+    float side_dist_x[8], side_dist_y[8], delta_dist_x[8], delta_dist_y[8];
+    float steps_x[8] = {0}, steps_y[8] = {0};
+    int map_x[8], map_y[8], step_x[8], step_y[8];
+
+    for (int i = 0; i < 8; i++) {
+        side_dist_x[i] = rs[i].side_dist_x;
+        side_dist_y[i] = rs[i].side_dist_y;
+        delta_dist_x[i] = rs[i].delta_dist_x;
+        delta_dist_y[i] = rs[i].delta_dist_y;
+        map_x[i] = rs[i].map_x;
+        map_y[i] = rs[i].map_y;
+        step_x[i] = rs[i].step_x;
+        step_y[i] = rs[i].step_y;
+    }
+
+    const __m256 sdx = _mm256_loadu_ps(side_dist_x);
+    const __m256 sdy = _mm256_loadu_ps(side_dist_y);
+    const __m256 ddx = _mm256_loadu_ps(delta_dist_x);
+    const __m256 ddy = _mm256_loadu_ps(delta_dist_y);
+    __m256 nx = _mm256_setzero_ps();
+    __m256 ny = _mm256_setzero_ps();
+    __m256i mx = _mm256_loadu_si256((const __m256i*)map_x);
+    __m256i my = _mm256_loadu_si256((const __m256i*)map_y);
+    __m256i sx = _mm256_loadu_si256((const __m256i*)step_x);
+    __m256i sy = _mm256_loadu_si256((const __m256i*)step_y);
+    __m256i side = _mm256_setzero_si256();
+    __m256i active = _mm256_set1_epi32(-1);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 one_f = _mm256_set1_ps(1.0f);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+    const __m256i rows = _mm256_set1_epi32(map->height);
+    const __m256i width = _mm256_set1_epi32(map->width);
+    const __m256i stride = _mm256_set1_epi32(map->stride);
+    const __m256i mask_x = _mm256_set1_epi32(map->mask_x);
+    const __m256i mask_y = _mm256_set1_epi32(map->mask_y);
+    const __m256i blocks_y = _mm256_set1_epi32(map->blocks_y);
+    const __m256i low3 = _mm256_set1_epi32(3);
+    const __m256i low7 = _mm256_set1_epi32(7);
+    const __m256i low8 = _mm256_set1_epi32(0xFF);
+    const __m256i skip_min = _mm256_set1_epi32(RAY_SKIP_MIN + 1);
+    const int* solid_words = (const int*)map->solid;
+    const int* distance_bytes = (const int*)map->distance;
+    __m256i inside = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpgt_epi32(rows, mx), _mm256_cmpgt_epi32(mx, minus_one)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(width, my), _mm256_cmpgt_epi32(my, minus_one)));
+
+    while (!_mm256_testz_si256(active, active)) {
+        // Jump through open space. Lanes are only moved one at a time, and
+        // only when the gathered distance says at least one can go.
+        if (ray_empty_skipping) {
+            __m256i index = _mm256_and_si256(
+                _mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(mx, mask_x), stride), _mm256_and_si256(my, mask_y)),
+                inside);
+            __m256i distance = _mm256_and_si256(_mm256_i32gather_epi32(distance_bytes, index, 1), low8);
+            __m256i skip = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(distance, skip_min), inside), active);
+            if (!_mm256_testz_si256(skip, skip)) {
+                _mm256_storeu_ps(steps_x, nx);
+                _mm256_storeu_ps(steps_y, ny);
+                _mm256_storeu_si256((__m256i*)map_x, mx);
+                _mm256_storeu_si256((__m256i*)map_y, my);
+                ray_skip_lanes(map, rs, _mm256_movemask_ps(_mm256_castsi256_ps(skip)), steps_x, steps_y, map_x, map_y);
+                nx = _mm256_loadu_ps(steps_x);
+                ny = _mm256_loadu_ps(steps_y);
+                mx = _mm256_loadu_si256((const __m256i*)map_x);
+                my = _mm256_loadu_si256((const __m256i*)map_y);
+            }
+        }
+
+        // Lanes that step in x this iteration; finished lanes do not move
+        __m256 next_x = _mm256_add_ps(sdx, _mm256_mul_ps(nx, ddx));
+        __m256 next_y = _mm256_add_ps(sdy, _mm256_mul_ps(ny, ddy));
+        __m256i x_step = _mm256_castps_si256(_mm256_cmp_ps(next_x, next_y, _CMP_LT_OQ));
+        __m256i move_x = _mm256_and_si256(x_step, active);
+        __m256i move_y = _mm256_andnot_si256(x_step, active);
+
+        nx = _mm256_add_ps(nx, _mm256_and_ps(one_f, _mm256_castsi256_ps(move_x)));
+        ny = _mm256_add_ps(ny, _mm256_and_ps(one_f, _mm256_castsi256_ps(move_y)));
+        mx = _mm256_add_epi32(mx, _mm256_and_si256(sx, move_x));
+        my = _mm256_add_epi32(my, _mm256_and_si256(sy, move_y));
+        side = _mm256_or_si256(_mm256_andnot_si256(active, side), _mm256_and_si256(move_y, one));
+
+        // map_solid(map_x, map_y): gather the 32-bit half of each lane's block
+        // word, then shift its bit down. Lanes outside the map stop there
+        // (and gather word 0 instead of reading out of bounds).
+        inside = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(rows, mx), _mm256_cmpgt_epi32(mx, minus_one)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(width, my), _mm256_cmpgt_epi32(my, minus_one)));
+        __m256i block = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(mx, MAP_BLOCK_SHIFT), blocks_y),
+                                         _mm256_srai_epi32(my, MAP_BLOCK_SHIFT));
+        __m256i word = _mm256_add_epi32(_mm256_add_epi32(block, block), _mm256_and_si256(_mm256_srai_epi32(mx, 2), one));
+        __m256i bit = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(mx, low3), 3), _mm256_and_si256(my, low7));
+        __m256i half = _mm256_i32gather_epi32(solid_words, _mm256_and_si256(word, inside), 4);
+        __m256i tile = _mm256_and_si256(_mm256_srlv_epi32(half, bit), one);
+        active = _mm256_and_si256(active, _mm256_and_si256(inside, _mm256_cmpeq_epi32(tile, zero)));
+    }
+
+    _mm256_storeu_si256((__m256i*)out_map_x, mx);
+    _mm256_storeu_si256((__m256i*)out_map_y, my);
+    _mm256_storeu_si256((__m256i*)out_side, side);
+}
+
+#elif defined(__SSE2__)
+
+// 4 lanes: compare/step with SSE2, scalar tile lookups (no gather)
+static void ray_traverse_packet(const Map* map, const RayStart* rs, int* out_map_x, int* out_map_y, int* out_side) {
+    float side_dist_x[4], side_dist_y[4], delta_dist_x[4], delta_dist_y[4];
+    float steps_x[4] = {0}, steps_y[4] = {0};
+    int map_x[4], map_y[4], step_x[4], step_y[4];
+    int tiles[4];
+
+    for (int i = 0; i < 4; i++) {
+        side_dist_x[i] = rs[i].side_dist_x;
+        side_dist_y[i] = rs[i].side_dist_y;
+        delta_dist_x[i] = rs[i].delta_dist_x;
+        delta_dist_y[i] = rs[i].delta_dist_y;
+        map_x[i] = rs[i].map_x;
+        map_y[i] = rs[i].map_y;
+        step_x[i] = rs[i].step_x;
+        step_y[i] = rs[i].step_y;
+    }
+
+    const __m128 sdx = _mm_loadu_ps(side_dist_x);
+    const __m128 sdy = _mm_loadu_ps(side_dist_y);
+    const __m128 ddx = _mm_loadu_ps(delta_dist_x);
+    const __m128 ddy = _mm_loadu_ps(delta_dist_y);
+    __m128 nx = _mm_setzero_ps();
+    __m128 ny = _mm_setzero_ps();
+    __m128i mx = _mm_loadu_si128((const __m128i*)map_x);
+    __m128i my = _mm_loadu_si128((const __m128i*)map_y);
+    __m128i sx = _mm_loadu_si128((const __m128i*)step_x);
+    __m128i sy = _mm_loadu_si128((const __m128i*)step_y);
+    __m128i side = _mm_setzero_si128();
+    __m128i active = _mm_set1_epi32(-1);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128 one_f = _mm_set1_ps(1.0f);
+    const __m128i zero = _mm_setzero_si128();
+
+    while (_mm_movemask_epi8(active)) {
+        // Jump through open space (map_x/map_y hold the current tiles)
+        if (ray_skip_lanes(map, rs, _mm_movemask_ps(_mm_castsi128_ps(active)), steps_x, steps_y, map_x, map_y)) {
+            nx = _mm_loadu_ps(steps_x);
+            ny = _mm_loadu_ps(steps_y);
+            mx = _mm_loadu_si128((const __m128i*)map_x);
+            my = _mm_loadu_si128((const __m128i*)map_y);
+        }
+
+        // Lanes that step in x this iteration; finished lanes do not move
+        __m128 next_x = _mm_add_ps(sdx, _mm_mul_ps(nx, ddx));
+        __m128 next_y = _mm_add_ps(sdy, _mm_mul_ps(ny, ddy));
+        __m128i x_step = _mm_castps_si128(_mm_cmplt_ps(next_x, next_y));
+        __m128i move_x = _mm_and_si128(x_step, active);
+        __m128i move_y = _mm_andnot_si128(x_step, active);
+
+        nx = _mm_add_ps(nx, _mm_and_ps(one_f, _mm_castsi128_ps(move_x)));
+        ny = _mm_add_ps(ny, _mm_and_ps(one_f, _mm_castsi128_ps(move_y)));
+        mx = _mm_add_epi32(mx, _mm_and_si128(sx, move_x));
+        my = _mm_add_epi32(my, _mm_and_si128(sy, move_y));
+        side = _mm_or_si128(_mm_andnot_si128(active, side), _mm_and_si128(move_y, one));
+
+        // map_solid(map_x, map_y)
+        _mm_storeu_ps(steps_x, nx);
+        _mm_storeu_ps(steps_y, ny);
+        _mm_storeu_si128((__m128i*)map_x, mx);
+        _mm_storeu_si128((__m128i*)map_y, my);
+        for (int i = 0; i < 4; i++) {
+            tiles[i] = map_solid(map, map_x[i], map_y[i]);
+        }
+        __m128i tile = _mm_loadu_si128((const __m128i*)tiles);
+        active = _mm_andnot_si128(_mm_cmpgt_epi32(tile, zero), active);
+    }
+
+    _mm_storeu_si128((__m128i*)out_map_x, mx);
+    _mm_storeu_si128((__m128i*)out_map_y, my);
+    _mm_storeu_si128((__m128i*)out_side, side);
+}
+
+#endif
+
+void ray_cast_packet(const Map* map, float pos_x, float pos_y, const float* ray_dir_x, const float* ray_dir_y, RayHit* hits) {
+#if RAY_PACKET_WIDTH > 1
+    RayStart rs[RAY_PACKET_WIDTH];
+    int map_x[RAY_PACKET_WIDTH];
+    int map_y[RAY_PACKET_WIDTH];
+    int side[RAY_PACKET_WIDTH];
+
+    for (int i = 0; i < RAY_PACKET_WIDTH; i++) {
+        ray_start(pos_x, pos_y, ray_dir_x[i], ray_dir_y[i], &rs[i]);
+    }
+
+    ray_traverse_packet(map, rs, map_x, map_y, side);
+
+    for (int i = 0; i < RAY_PACKET_WIDTH; i++) {
+        hits[i].map_x = map_x[i];
+        hits[i].map_y = map_y[i];
+        hits[i].side = side[i];
+        ray_finish(pos_x, pos_y, ray_dir_x[i], ray_dir_y[i], rs[i].step_x, rs[i].step_y, &hits[i]);
+    }
+#else
+    // No SIMD available - scalar fallback
+    ray_cast(map, pos_x, pos_y, ray_dir_x[0], ray_dir_y[0], &hits[0]);
+#endif
+}
+
+void ray_resolve(float pos_x, float pos_y, float ray_dir_x, float ray_dir_y, int map_x, int map_y, int side, RayHit* hit) {
+    // Same step directions as ray_start
+    int step_x = (ray_dir_x < 0) ? -1 : 1;
+    int step_y = (ray_dir_y < 0) ? -1 : 1;
+
+    hit->map_x = map_x;
+    hit->map_y = map_y;
+    hit->side = side;
+    ray_finish(pos_x, pos_y, ray_dir_x, ray_dir_y, step_x, step_y, hit);
+}
@@ -3,160 +3,980 @@
 #include "texture.h"
 #include "sprite.h"
 #include "enemy.h"
+#include "render_pool.h"
+#include "ray.h"
+#include "render_target.h"
+#include "floor_caster.h"
+#include "palette.h"
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
-// Forward declaration
-void render_sprites(Engine* engine, Player* player, SpriteManager* sm, EnemyManager* em, PickupManager* pm, float* z_buffer);
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-void raycaster_render(Engine* engine, Player* player, TextureManager* tm, SpriteManager* sm, EnemyManager* em, PickupManager* pm) {
-    // Allocate z-buffer dynamically based on current screen width
-    static float* z_buffer = NULL;
-    static int z_buffer_size = 0;
+#define CEILING_COLOR 0x333333
+#define FLOOR_COLOR 0x666666
 
-    if (z_buffer_size != engine->screen_width) {
-        free(z_buffer);
-        z_buffer = (float*)malloc(engine->screen_width * sizeof(float));
-        z_buffer_size = engine->screen_width;
+// Column spacing of full traversals in coarse casting mode
+#define COARSE_STEP 8
+
+// Slack, in columns, when locating a ray among last frame's columns
+#define REPROJECT_MARGIN 0.01f
+
+// Interlaced mode falls back to neighbour columns past this much camera
+// motion between frames: tiles moved, or the share of the view's width it
+// turned by (about one column at 1280 wide, four at 3840)
+#define INTERLACE_MAX_MOVE 0.01f
+#define INTERLACE_MAX_SHIFT 0.001f
+
+// Columns per block when copying wall runs out of the history row by row
+#define COMPOSE_BLOCK 16
+
+// How the wall pass can use last frame's hits
+typedef enum {
+    CACHE_MISS,         // Cast every column
+    CACHE_SAME,         // Same eye and camera: copy every hit
+    CACHE_REPROJECT     // Same eye, camera turned a little: look hits up in old columns
+} CacheMode;
+
+// Eye, camera and grid that last frame's hits were cast with
+typedef struct {
+    bool valid;
+    int width;
+    unsigned int map_revision;
+    float pos_x;
+    float pos_y;
+    float dir_x;
+    float dir_y;
+    float plane_x;
+    float plane_y;
+} HitCacheKey;
+
+// Layout and camera of the interlaced history buffer's last frame
+typedef struct {
+    bool valid;
+    int width;
+    int height;
+    int x_stride;
+    bool indexed;
+    unsigned int map_revision;
+    int parity;                 // Columns drawn last frame (-1 = all)
+    float pos_x;
+    float pos_y;
+    float dir_x;
+    float dir_y;
+    float plane_x;
+    float plane_y;
+} HistoryKey;
+
+// Layout, settings and camera of the saved frame a still camera reuses
+typedef struct {
+    bool valid;
+    int width;
+    int height;
+    int x_stride;
+    bool indexed;
+    bool textured_floors;
+    bool mipmaps;
+    unsigned int map_revision;
+    float pos_x;
+    float pos_y;
+    float dir_x;
+    float dir_y;
+    float plane_x;
+    float plane_y;
+} StillKey;
+
+// Forward declarations
+void render_sprites(Engine* engine, RenderTarget* target, Player* player, const Map* map, SpriteManager* sm, EnemyManager* em, PickupManager* pm, float* z_buffer);
+void sprite_renderer_cleanup(void);
+
+// Shared state for one wall pass, read by every band
+typedef struct {
+    Engine* engine;
+    RenderTarget* target;
+    Player* player;
+    const Map* map;
+    TextureManager* tm;
+    float* z_buffer;
+    int* wall_top;              // First wall row of each column
+    int* wall_bottom;           // First floor row of each column
+    RayHit* hits;               // Ray hit of each column, filled before drawing
+    const RayHit* cached;       // Last frame's hits, cast as described by cache_key
+    const HitCacheKey* cache_key;
+    CacheMode cache_mode;
+    int parity;                 // Interlaced: only columns with (x & 1) == parity (-1 = all)
+    bool flat_fill;             // Fill ceiling and floor with flat colors here (column-major targets)
+    long long band_pixels[MAX_RENDER_THREADS];  // Pixels written by each band
+    long long band_saved[MAX_RENDER_THREADS];   // Columns each band resolved without DDA
+    long long band_reused[MAX_RENDER_THREADS];  // Columns each band took from the cache
+} WallPass;
+
+// Floor/ceiling pass over rows, run after the wall pass
+typedef struct {
+    FloorPass floor;
+    long long band_pixels[MAX_RENDER_THREADS];
+} FloorJob;
+
+static RenderPool render_pool;
+static bool render_pool_started = false;
+
+// Hits of the previous frame
+static RayHit* cached_hits = NULL;
+static HitCacheKey cache_key = { false, 0, 0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+// Wall pass output kept across frames in interlaced mode
+static uint8_t* history = NULL;
+static size_t history_size = 0;
+static HistoryKey history_key = { false, 0, 0, 0, false, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+static int* block_spans = NULL;         // Top and bottom wall row of each block
+static int block_spans_size = 0;
+
+// Walls and floors of the last frame, before sprites, kept while the
+// camera stands still
+static uint8_t* still_frame = NULL;
+static size_t still_frame_size = 0;
+static StillKey still_key = { false, 0, 0, 0, false, false, false, 0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+// Per-column results of the wall pass. Buffers only grow, as dynamic
+// resolution changes the view size often.
+static float* z_buffer = NULL;
+static int z_buffer_size = 0;
+static int* wall_top = NULL;
+static int* wall_bottom = NULL;
+static RayHit* hits = NULL;
+
+// Whole-buffer copy between the target and the history or still frame,
+// split into bands
+typedef struct {
+    const uint8_t* src;
+    uint8_t* dst;
+    size_t band_bytes;          // Bytes per item (one row's worth of pixels)
+} CopyJob;
+
+// Interlaced: the wall pixels of the history, copied into the target
+typedef struct {
+    const uint8_t* history;     // Laid out like target
+    const RenderTarget* target;
+    const int* wall_top;
+    const int* wall_bottom;
+    const int* block_spans;     // Rows any wall of each block covers
+    int parity;                 // Columns drawn this frame
+    bool spatial_fill;          // Show each undrawn column's neighbour instead
+    bool flat_fill;             // Column-major flat floors: fill the rest of each column
+} ComposeJob;
+
+// Column-major view and the framebuffer it is transposed into
+typedef struct {
+    const RenderTarget* src;
+    uint32_t* dst;
+} TransposeJob;
+
+// Transposed 3D view for column-major render mode
+static uint32_t* column_buffer = NULL;
+static int column_buffer_size = 0;
+
+// Direction of the ray through screen column x
+static void wall_ray_dir(const WallPass* pass, int x, float* ray_dir_x, float* ray_dir_y) {
+    Engine* engine = pass->engine;
+    Player* player = pass->player;
+
+    float camera_x = 2 * x / (float)engine->view_width - 1;
+    *ray_dir_x = player->dir_x + player->plane_x * camera_x;
+    *ray_dir_y = player->dir_y + player->plane_y * camera_x;
+}
+
+// Fill count pixels of a column with one color
+static void fill_span(uint32_t* dst, int y_stride, int count, uint32_t color) {
+    if (y_stride != 1) {
+        for (int i = 0; i < count; i++) {
+            dst[i * y_stride] = color;
+        }
+        return;
+    }
+
+    int i = 0;
+#ifdef __SSE2__
+    __m128i fill = _mm_set1_epi32((int)color);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), fill);
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = color;
     }
+}
 
-    // Clear screen (floor and ceiling) - optimized
-    uint32_t* pixels = engine->pixels;
-    int half_screen = engine->screen_height / 2 * engine->screen_width;
+// Fill count pixels of an 8-bit column with one palette index
+static void fill_span_indexed(uint8_t* dst, int y_stride, int count, uint8_t index) {
+    if (y_stride == 1) {
+        memset(dst, index, count);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        dst[i * y_stride] = index;
+    }
+}
 
-    // Fill ceiling
-    for (int i = 0; i < half_screen; i++) {
-        pixels[i] = 0x333333;
+// Fill rows [y0, y1) of column x with ceiling above the horizon and floor below it
+static int fill_flat_span(const RenderTarget* target, int x, int y0, int y1, int half_height) {
+    if (y1 <= y0) {
+        return 0;
     }
 
-    // Fill floor
-    for (int i = half_screen; i < engine->screen_width * engine->screen_height; i++) {
-        pixels[i] = 0x666666;
+    int y_stride = target->y_stride;
+    int split = y1 < half_height ? y1 : half_height;
+    int floor_start = y0 > half_height ? y0 : half_height;
+
+    if (target->indices) {
+        const Palette* palette = palette_get();
+        uint8_t* column = target->indices + x * target->x_stride;
+        if (y0 < split) {
+            fill_span_indexed(column + y0 * y_stride, y_stride, split - y0, palette_quantize(palette, CEILING_COLOR));
+        }
+        if (floor_start < y1) {
+            fill_span_indexed(column + floor_start * y_stride, y_stride, y1 - floor_start, palette_quantize(palette, FLOOR_COLOR));
+        }
+    } else {
+        uint32_t* column = target->pixels + x * target->x_stride;
+        if (y0 < split) {
+            fill_span(column + y0 * y_stride, y_stride, split - y0, CEILING_COLOR);
+        }
+        if (floor_start < y1) {
+            fill_span(column + floor_start * y_stride, y_stride, y1 - floor_start, FLOOR_COLOR);
+        }
     }
+    return y1 - y0;
+}
+
+// Compose column x from its ray hit: ceiling, textured wall stripe and
+// floor, each pixel written exactly once. With textured floors only the
+// wall stripe is drawn here. Returns pixels written.
+static int draw_wall_column(const WallPass* pass, int x, float ray_dir_x, float ray_dir_y, const RayHit* hit) {
+    Engine* engine = pass->engine;
+    TextureManager* tm = pass->tm;
+    const RenderTarget* target = pass->target;
+    int y_stride = target->y_stride;
+    float perp_wall_dist = hit->perp_wall_dist;
+    int side = hit->side;
 
-    // Cast rays
-    for (int x = 0; x < engine->screen_width; x++) {
-        // Calculate ray position and direction
-        float camera_x = 2 * x / (float)engine->screen_width - 1;
-        float ray_dir_x = player->dir_x + player->plane_x * camera_x;
-        float ray_dir_y = player->dir_y + player->plane_y * camera_x;
+    // Store perpendicular distance in z-buffer for sprite rendering
+    pass->z_buffer[x] = perp_wall_dist;
 
-        // Which box of the map we're in
-        int map_x = (int)player->x;
-        int map_y = (int)player->y;
+    // Calculate height of line to draw on screen
+    int line_height = (int)(engine->view_height / perp_wall_dist);
 
-        // Length of ray from current position to next x or y-side
-        float side_dist_x;
-        float side_dist_y;
+    // Calculate lowest and highest pixel to fill in current stripe
+    int draw_start = -line_height / 2 + engine->view_height / 2;
+    if (draw_start < 0) draw_start = 0;
+    int draw_end = line_height / 2 + engine->view_height / 2;
+    if (draw_end >= engine->view_height) draw_end = engine->view_height - 1;
 
-        // Length of ray from one x or y-side to next x or y-side
-        float delta_dist_x = (ray_dir_x == 0) ? 1e30 : fabsf(1 / ray_dir_x);
-        float delta_dist_y = (ray_dir_y == 0) ? 1e30 : fabsf(1 / ray_dir_y);
-        float perp_wall_dist;
+    // Get texture for this wall
+    int tex_num = map_tile(pass->map, hit->map_x, hit->map_y) - 1;
+    if (tex_num < 0) tex_num = 0;
+    if (tex_num >= MAX_TEXTURES) tex_num = MAX_TEXTURES - 1;
 
-        // What direction to step in x or y-direction (either +1 or -1)
-        int step_x;
-        int step_y;
+    // X coordinate on the texture
+    int tex_x = (int)(hit->wall_x * (float)TEXTURE_WIDTH);
+    if (side == 0 && ray_dir_x > 0) tex_x = TEXTURE_WIDTH - tex_x - 1;
+    if (side == 1 && ray_dir_y < 0) tex_x = TEXTURE_WIDTH - tex_x - 1;
+
+    // Calculate step size for texture mapping
+    float step = 1.0 * TEXTURE_HEIGHT / line_height;
+    float tex_pos = (draw_start - engine->view_height / 2 + line_height / 2) * step;
+
+    // Give x and y sides different brightness by picking a pre-shaded texture
+    int shade = (side == 1) ? TEXTURE_SHADE_SIDE : 0;
+
+    // Distant walls sample a smaller mip level: same texel per pixel, fewer cache lines
+    int mip = engine->mipmaps ? texture_mip_level(line_height) : 0;
+
+    int half_height = engine->view_height / 2;
+    int wall_end = draw_end > draw_start ? draw_end : draw_start;
+    int written = 0;
+
+    // The floor caster fills the rows outside [wall_top, wall_bottom)
+    pass->wall_top[x] = draw_start;
+    pass->wall_bottom[x] = wall_end;
+
+    // Ceiling above the wall
+    if (pass->flat_fill) {
+        written += fill_flat_span(target, x, 0, draw_start, half_height);
+    }
+
+    // Draw the textured vertical line
+    if (target->indices) {
+        // Palette mode: shade texel indices through the side's colormap
+        uint8_t* column = target->indices + x * target->x_stride;
+        const uint8_t* tex_column = texture_index_mip_column(&tm->textures[tex_num], mip, tex_x >> mip);
+        const uint8_t* colormap = palette_get()->shade[shade];
+
+        for (int y = draw_start; y < draw_end; y++) {
+            int tex_y = ((int)tex_pos & (TEXTURE_HEIGHT - 1)) >> mip;
+            tex_pos += step;
+
+            column[y * y_stride] = colormap[tex_column[tex_y]];
+        }
+    } else {
+        uint32_t* column = target->pixels + x * target->x_stride;
 
-        int hit = 0;  // Was there a wall hit?
-        int side;     // Was a NS or a EW wall hit?
+        // Cache texture column for faster access (texels are contiguous in y)
+        const uint32_t* tex_column = texture_manager_shaded_column(tm, tex_num, shade, mip, tex_x >> mip);
 
-        // Calculate step and initial sideDist
-        if (ray_dir_x < 0) {
-            step_x = -1;
-            side_dist_x = (player->x - map_x) * delta_dist_x;
+        for (int y = draw_start; y < draw_end; y++) {
+            int tex_y = ((int)tex_pos & (TEXTURE_HEIGHT - 1)) >> mip;
+            tex_pos += step;
+
+            column[y * y_stride] = tex_column[tex_y];
+        }
+    }
+    written += wall_end - draw_start;
+
+    // Floor below the wall
+    if (pass->flat_fill) {
+        written += fill_flat_span(target, x, wall_end, engine->view_height, half_height);
+    }
+
+    return written;
+}
+
+// Full DDA for column x, into pass->hits
+static void cast_column(const WallPass* pass, int x) {
+    float ray_dir_x, ray_dir_y;
+
+    wall_ray_dir(pass, x, &ray_dir_x, &ray_dir_y);
+    ray_cast(pass->map, pass->player->x, pass->player->y, ray_dir_x, ray_dir_y, &pass->hits[x]);
+}
+
+// Full DDA for RAY_PACKET_WIDTH (not necessarily adjacent) columns at once
+static void cast_column_packet(const WallPass* pass, const int* columns) {
+    float ray_dir_x[RAY_PACKET_WIDTH];
+    float ray_dir_y[RAY_PACKET_WIDTH];
+    RayHit hits[RAY_PACKET_WIDTH];
+
+    for (int i = 0; i < RAY_PACKET_WIDTH; i++) {
+        wall_ray_dir(pass, columns[i], &ray_dir_x[i], &ray_dir_y[i]);
+    }
+    ray_cast_packet(pass->map, pass->player->x, pass->player->y, ray_dir_x, ray_dir_y, hits);
+    for (int i = 0; i < RAY_PACKET_WIDTH; i++) {
+        pass->hits[columns[i]] = hits[i];
+    }
+}
+
+// Resolve the columns strictly between a and b, whose hits are known.
+// When both hit the same face of the same tile, so does every ray between
+// them: a tile blocking one of those rays without touching ray a or b
+// would have to fit inside the triangle of the eye and the two hit
+// points, which is less than one tile wide. Those columns only need their
+// distance and texture coordinate. Otherwise the middle column is cast
+// and both halves are refined. Returns columns resolved without DDA.
+static int resolve_span(const WallPass* pass, int a, int b) {
+    if (b - a < 2) {
+        return 0;
+    }
+
+    const RayHit* hit_a = &pass->hits[a];
+    const RayHit* hit_b = &pass->hits[b];
+    if (hit_a->map_x == hit_b->map_x && hit_a->map_y == hit_b->map_y && hit_a->side == hit_b->side) {
+        for (int x = a + 1; x < b; x++) {
+            float ray_dir_x, ray_dir_y;
+            wall_ray_dir(pass, x, &ray_dir_x, &ray_dir_y);
+            ray_resolve(pass->player->x, pass->player->y, ray_dir_x, ray_dir_y,
+                        hit_a->map_x, hit_a->map_y, hit_a->side, &pass->hits[x]);
+        }
+        return b - a - 1;
+    }
+
+    int mid = (a + b) / 2;
+    cast_column(pass, mid);
+    return resolve_span(pass, a, mid) + resolve_span(pass, mid, b);
+}
+
+// Coarse-to-fine casting of columns [start, end): full DDA every
+// COARSE_STEP columns and at the band's last column, then resolve_span
+// between them. Returns columns resolved without DDA.
+static int cast_coarse_band(const WallPass* pass, int start, int end) {
+    int pending[RAY_PACKET_WIDTH];
+    int count = 0;
+
+    for (int x = start;; x += COARSE_STEP) {
+        if (x > end - 1) x = end - 1;
+
+        // Sample columns are independent, so packets need not be adjacent
+        if (pass->engine->ray_packets && RAY_PACKET_WIDTH > 1) {
+            pending[count++] = x;
+            if (count == RAY_PACKET_WIDTH) {
+                cast_column_packet(pass, pending);
+                count = 0;
+            }
         } else {
-            step_x = 1;
-            side_dist_x = (map_x + 1.0 - player->x) * delta_dist_x;
+            cast_column(pass, x);
         }
-        if (ray_dir_y < 0) {
-            step_y = -1;
-            side_dist_y = (player->y - map_y) * delta_dist_y;
+
+        if (x == end - 1) break;
+    }
+    for (int i = 0; i < count; i++) {
+        cast_column(pass, pending[i]);
+    }
+
+    int saved = 0;
+    for (int a = start; a < end - 1; a += COARSE_STEP) {
+        int b = a + COARSE_STEP < end - 1 ? a + COARSE_STEP : end - 1;
+        saved += resolve_span(pass, a, b);
+    }
+    return saved;
+}
+
+// Full DDA for every column of [start, end), in packets when enabled
+static void cast_band(const WallPass* pass, int start, int end) {
+    int x = start;
+
+    if (pass->engine->ray_packets) {
+        for (; x + RAY_PACKET_WIDTH <= end; x += RAY_PACKET_WIDTH) {
+            int columns[RAY_PACKET_WIDTH];
+            for (int i = 0; i < RAY_PACKET_WIDTH; i++) {
+                columns[i] = x + i;
+            }
+            cast_column_packet(pass, columns);
+        }
+    }
+    for (; x < end; x++) {
+        cast_column(pass, x);
+    }
+}
+
+// Hit of column x from last frame's columns. From an unchanged eye the new
+// ray lies between two old rays; when the old columns around it hit the
+// same face of the same tile, the new ray hits it too (see resolve_span).
+// Returns false when the ray falls outside the old view or near an edge.
+static bool reproject_column(const WallPass* pass, int x, float ray_dir_x, float ray_dir_y) {
+    const HitCacheKey* key = pass->cache_key;
+
+    // Old camera_x of this direction, as a fractional old column
+    float cross_dir = ray_dir_x * key->dir_y - ray_dir_y * key->dir_x;
+    float cross_plane = ray_dir_x * key->plane_y - ray_dir_y * key->plane_x;
+    if (ray_dir_x * key->dir_x + ray_dir_y * key->dir_y <= 0.0f || cross_plane == 0.0f) {
+        return false;
+    }
+    float column = (1.0f - cross_dir / cross_plane) * key->width * 0.5f;
+    if (column - REPROJECT_MARGIN < 0.0f || column + REPROJECT_MARGIN > key->width - 1) {
+        return false;
+    }
+
+    int lo = (int)floorf(column - REPROJECT_MARGIN);
+    int hi = (int)ceilf(column + REPROJECT_MARGIN);
+    const RayHit* first = &pass->cached[lo];
+    for (int c = lo + 1; c <= hi; c++) {
+        const RayHit* other = &pass->cached[c];
+        if (other->map_x != first->map_x || other->map_y != first->map_y || other->side != first->side) {
+            return false;
+        }
+    }
+
+    ray_resolve(pass->player->x, pass->player->y, ray_dir_x, ray_dir_y,
+                first->map_x, first->map_y, first->side, &pass->hits[x]);
+    return true;
+}
+
+// Columns [start, end) from last frame's hits, casting only the columns
+// that cannot be reprojected. Returns columns taken from the cache.
+static int reuse_cached_band(const WallPass* pass, int start, int end) {
+    if (pass->cache_mode == CACHE_SAME) {
+        memcpy(pass->hits + start, pass->cached + start, (end - start) * sizeof(RayHit));
+        return end - start;
+    }
+
+    int reused = 0;
+    for (int x = start; x < end; x++) {
+        float ray_dir_x, ray_dir_y;
+        wall_ray_dir(pass, x, &ray_dir_x, &ray_dir_y);
+        if (reproject_column(pass, x, ray_dir_x, ray_dir_y)) {
+            reused++;
         } else {
-            step_y = 1;
-            side_dist_y = (map_y + 1.0 - player->y) * delta_dist_y;
+            ray_cast(pass->map, pass->player->x, pass->player->y, ray_dir_x, ray_dir_y, &pass->hits[x]);
         }
+    }
+    return reused;
+}
 
-        // Perform DDA
-        while (hit == 0) {
-            // Jump to next map square, either in x-direction, or in y-direction
-            if (side_dist_x < side_dist_y) {
-                side_dist_x += delta_dist_x;
-                map_x += step_x;
-                side = 0;
-            } else {
-                side_dist_y += delta_dist_y;
-                map_y += step_y;
-                side = 1;
+// Hits of every column of [start, end) with full DDA only on those with
+// the pass's parity: each column between two of them is resolved from
+// the hits on either side (see resolve_span), or cast at the band's
+// edges. Returns columns resolved without DDA.
+static int cast_interlaced_band(const WallPass* pass, int start, int end) {
+    int x = start + ((start ^ pass->parity) & 1);
+
+    // Every other column: packets of non-adjacent rays
+    if (pass->engine->ray_packets) {
+        for (; x + 2 * (RAY_PACKET_WIDTH - 1) < end; x += 2 * RAY_PACKET_WIDTH) {
+            int columns[RAY_PACKET_WIDTH];
+            for (int i = 0; i < RAY_PACKET_WIDTH; i++) {
+                columns[i] = x + 2 * i;
             }
-            // Check if ray has hit a wall
-            if (world_map[map_x][map_y] > 0) hit = 1;
+            cast_column_packet(pass, columns);
         }
+    }
+    for (; x < end; x += 2) {
+        cast_column(pass, x);
+    }
 
-        // Calculate distance projected on camera direction
-        if (side == 0) {
-            perp_wall_dist = (map_x - player->x + (1 - step_x) / 2) / ray_dir_x;
+    int saved = 0;
+    for (x = start + ((start ^ pass->parity ^ 1) & 1); x < end; x += 2) {
+        if (x > start && x + 1 < end) {
+            saved += resolve_span(pass, x - 1, x + 1);
         } else {
-            perp_wall_dist = (map_y - player->y + (1 - step_y) / 2) / ray_dir_y;
+            cast_column(pass, x);
         }
+    }
+    return saved;
+}
+
+// Render columns [start, end): walls, plus flat floor and ceiling
+static void render_wall_band(void* ctx, int band, int start, int end) {
+    WallPass* pass = (WallPass*)ctx;
+    long long written = 0;
+
+    // Find every column's wall hit, then draw the columns. Interlaced
+    // frames find them all too, so the next frame can use them as a cache.
+    if (pass->cache_mode != CACHE_MISS) {
+        pass->band_reused[band] = reuse_cached_band(pass, start, end);
+    } else if (pass->engine->coarse_casting && end > start) {
+        pass->band_saved[band] = cast_coarse_band(pass, start, end);
+    } else if (pass->parity >= 0) {
+        pass->band_saved[band] = cast_interlaced_band(pass, start, end);
+    } else {
+        cast_band(pass, start, end);
+    }
 
-        // Store perpendicular distance in z-buffer for sprite rendering
-        z_buffer[x] = perp_wall_dist;
+    // Interlaced: half the columns, the rest keep last frame's pixels
+    int first = pass->parity >= 0 ? start + ((start ^ pass->parity) & 1) : start;
+    int step = pass->parity >= 0 ? 2 : 1;
+    for (int x = first; x < end; x += step) {
+        float ray_dir_x, ray_dir_y;
+        wall_ray_dir(pass, x, &ray_dir_x, &ray_dir_y);
+        written += draw_wall_column(pass, x, ray_dir_x, ray_dir_y, &pass->hits[x]);
+    }
 
-        // Calculate height of line to draw on screen
-        int line_height = (int)(engine->screen_height / perp_wall_dist);
+    pass->band_pixels[band] = written;
+}
 
-        // Calculate lowest and highest pixel to fill in current stripe
-        int draw_start = -line_height / 2 + engine->screen_height / 2;
-        if (draw_start < 0) draw_start = 0;
-        int draw_end = line_height / 2 + engine->screen_height / 2;
-        if (draw_end >= engine->screen_height) draw_end = engine->screen_height - 1;
+// Column whose history an interlaced column shows: its own, or with
+// spatial fill a neighbour's for the columns not drawn this frame
+static inline int compose_source(const ComposeJob* job, int x) {
+    if (!job->spatial_fill || ((x ^ job->parity) & 1) == 0) {
+        return x;
+    }
+    if (x > 0) {
+        return x - 1;
+    }
+    return x + 1 < job->target->width ? x + 1 : x;
+}
 
-        // Get texture for this wall
-        int tex_num = world_map[map_x][map_y] - 1;
-        if (tex_num < 0) tex_num = 0;
-        if (tex_num >= MAX_TEXTURES) tex_num = MAX_TEXTURES - 1;
+// Row-major target: copy the blocks of each row [start, end) that walls
+// cover. The floor pass then draws over whatever else a block copied.
+static void compose_rows(const ComposeJob* job, int start, int end) {
+    const RenderTarget* target = job->target;
+    size_t pixel_bytes = target->indices ? 1 : sizeof(uint32_t);
+    int blocks = (target->width + COMPOSE_BLOCK - 1) / COMPOSE_BLOCK;
 
-        // Calculate where exactly the wall was hit
-        float wall_x;
-        if (side == 0) {
-            wall_x = player->y + perp_wall_dist * ray_dir_y;
-        } else {
-            wall_x = player->x + perp_wall_dist * ray_dir_x;
+    for (int y = start; y < end; y++) {
+        size_t row = (size_t)y * target->y_stride * pixel_bytes;
+        uint8_t* dst = (target->indices ? target->indices : (uint8_t*)target->pixels) + row;
+        const uint8_t* src = job->history + row;
+
+        int b = 0;
+        while (b < blocks) {
+            while (b < blocks && (y < job->block_spans[2 * b] || y >= job->block_spans[2 * b + 1])) b++;
+            int run = b;
+            while (b < blocks && y >= job->block_spans[2 * b] && y < job->block_spans[2 * b + 1]) b++;
+            if (b == run) {
+                break;
+            }
+
+            int x0 = run * COMPOSE_BLOCK;
+            int x1 = b * COMPOSE_BLOCK < target->width ? b * COMPOSE_BLOCK : target->width;
+            if (!job->spatial_fill) {
+                memcpy(dst + x0 * pixel_bytes, src + x0 * pixel_bytes, (x1 - x0) * pixel_bytes);
+            } else if (target->indices) {
+                for (int x = x0; x < x1; x++) dst[x] = src[compose_source(job, x)];
+            } else {
+                for (int x = x0; x < x1; x++) ((uint32_t*)dst)[x] = ((const uint32_t*)src)[compose_source(job, x)];
+            }
+        }
+    }
+}
+
+// Column-major target: copy each column's wall span of [start, end), and
+// fill around it with flat colors when the floor pass does not run
+static void compose_columns(const ComposeJob* job, int start, int end) {
+    const RenderTarget* target = job->target;
+    const uint32_t* history = (const uint32_t*)job->history;
+    int half_height = target->height / 2;
+
+    for (int x = start; x < end; x++) {
+        int top = job->wall_top[x];
+        int bottom = job->wall_bottom[x];
+        const uint32_t* src = history + (size_t)compose_source(job, x) * target->x_stride;
+        memcpy(target->pixels + (size_t)x * target->x_stride + top, src + top, (bottom - top) * sizeof(uint32_t));
+        if (job->flat_fill) {
+            fill_flat_span(target, x, 0, top, half_height);
+            fill_flat_span(target, x, bottom, target->height, half_height);
         }
-        wall_x -= floorf(wall_x);
+    }
+}
 
-        // X coordinate on the texture
-        int tex_x = (int)(wall_x * (float)TEXTURE_WIDTH);
-        if (side == 0 && ray_dir_x > 0) tex_x = TEXTURE_WIDTH - tex_x - 1;
-        if (side == 1 && ray_dir_y < 0) tex_x = TEXTURE_WIDTH - tex_x - 1;
+static void compose_band(void* ctx, int band, int start, int end) {
+    const ComposeJob* job = (const ComposeJob*)ctx;
+    (void)band;
+    if (job->target->y_stride == 1) {
+        compose_columns(job, start, end);
+    } else {
+        compose_rows(job, start, end);
+    }
+}
 
-        // Calculate step size for texture mapping
-        float step = 1.0 * TEXTURE_HEIGHT / line_height;
-        float tex_pos = (draw_start - engine->screen_height / 2 + line_height / 2) * step;
+static void copy_history_band(void* ctx, int band, int start, int end) {
+    const CopyJob* job = (const CopyJob*)ctx;
+    (void)band;
+    memcpy(job->dst + start * job->band_bytes, job->src + start * job->band_bytes, (end - start) * job->band_bytes);
+}
 
-        // Cache texture pointer for faster access
-        Texture* tex = &tm->textures[tex_num];
-        uint32_t* tex_pixels = tex->data;
+// Columns to draw this frame in interlaced mode: the other parity than
+// last frame, or all of them when the history does not match the target
+static int interlace_parity(const HistoryKey* key, const RenderTarget* target) {
+    if (!key->valid || key->width != target->width || key->height != target->height ||
+        key->x_stride != target->x_stride || key->indexed != (target->indices != NULL) ||
+        key->map_revision != map_revision) {
+        return -1;
+    }
+    return key->parity == 0 ? 1 : 0;
+}
 
-        // Draw the textured vertical line
-        for (int y = draw_start; y < draw_end; y++) {
-            int tex_y = (int)tex_pos & (TEXTURE_HEIGHT - 1);
-            tex_pos += step;
+// True when the camera moved too far since the history's frame for its
+// columns to stand in for this frame's
+static bool interlace_moved(const HistoryKey* key, const Player* player) {
+    float dx = player->x - key->pos_x;
+    float dy = player->y - key->pos_y;
+    if (dx * dx + dy * dy > INTERLACE_MAX_MOVE * INTERLACE_MAX_MOVE) {
+        return true;
+    }
 
-            uint32_t color = tex_pixels[tex_y * TEXTURE_WIDTH + tex_x];
+    // Columns the view center moved by in the old view
+    float cross_dir = player->dir_x * key->dir_y - player->dir_y * key->dir_x;
+    float cross_plane = player->dir_x * key->plane_y - player->dir_y * key->plane_x;
+    if (player->dir_x * key->dir_x + player->dir_y * key->dir_y <= 0.0f || cross_plane == 0.0f) {
+        return true;
+    }
+    return fabsf(cross_dir / cross_plane) * 0.5f > INTERLACE_MAX_SHIFT;
+}
 
-            // Give x and y sides different brightness
-            if (side == 1) {
-                color = (color >> 1) & 0x7F7F7F;
+// Run func over [0, count) on the worker pool, or on this thread without one
+static void run_bands(RenderJobFunc func, void* ctx, int count) {
+    if (render_pool_started) {
+        render_pool_run(&render_pool, func, ctx, count);
+    } else {
+        func(ctx, 0, 0, count);
+    }
+}
+
+// How much of last frame's hits this frame can use: all of them when
+// nothing moved, a reprojection when only the camera turned by less than
+// a quarter of the view, none after moving or a map or width change
+static CacheMode hit_cache_mode(const Engine* engine, const Player* player) {
+    const HitCacheKey* key = &cache_key;
+
+    if (!engine->hit_cache || !key->valid || key->width != engine->view_width ||
+        key->map_revision != map_revision || key->pos_x != player->x || key->pos_y != player->y) {
+        return CACHE_MISS;
+    }
+    if (key->dir_x == player->dir_x && key->dir_y == player->dir_y &&
+        key->plane_x == player->plane_x && key->plane_y == player->plane_y) {
+        return CACHE_SAME;
+    }
+
+    // Old camera_x of the new view direction
+    float cross_dir = player->dir_x * key->dir_y - player->dir_y * key->dir_x;
+    float cross_plane = player->dir_x * key->plane_y - player->dir_y * key->plane_x;
+    if (player->dir_x * key->dir_x + player->dir_y * key->dir_y <= 0.0f || cross_plane == 0.0f) {
+        return CACHE_MISS;
+    }
+    return fabsf(cross_dir / cross_plane) < 0.5f ? CACHE_REPROJECT : CACHE_MISS;
+}
+
+// Render rows [start, end) of textured floor and ceiling
+static void render_floor_band(void* ctx, int band, int start, int end) {
+    FloorJob* job = (FloorJob*)ctx;
+    job->band_pixels[band] = floor_cast_rows(&job->floor, start, end);
+}
+
+// Fill rows [start, end) of flat floor and ceiling
+static void render_flat_band(void* ctx, int band, int start, int end) {
+    FloorJob* job = (FloorJob*)ctx;
+    job->band_pixels[band] = floor_fill_rows(&job->floor, start, end);
+}
+
+// Copy rows [start, end) of the column-major view into the framebuffer
+static void transpose_band(void* ctx, int band, int start, int end) {
+    const TransposeJob* job = (const TransposeJob*)ctx;
+    (void)band;
+    render_target_transpose(job->src, job->dst, start, end);
+}
+
+static StillKey still_frame_key(const Engine* engine, const RenderTarget* target, const Player* player) {
+    StillKey key = { true, target->width, target->height, target->x_stride, target->indices != NULL,
+                     engine->textured_floors, engine->mipmaps, map_revision, player->x, player->y,
+                     player->dir_x, player->dir_y, player->plane_x, player->plane_y };
+    return key;
+}
+
+// Was the saved frame rendered exactly like this one would be?
+static bool still_frame_matches(const Engine* engine, const RenderTarget* target, const Player* player) {
+    StillKey key = still_frame_key(engine, target, player);
+    const StillKey* saved = &still_key;
+    return saved->valid && saved->width == key.width && saved->height == key.height &&
+           saved->x_stride == key.x_stride && saved->indexed == key.indexed &&
+           saved->textured_floors == key.textured_floors && saved->mipmaps == key.mipmaps &&
+           saved->map_revision == key.map_revision && saved->pos_x == key.pos_x && saved->pos_y == key.pos_y &&
+           saved->dir_x == key.dir_x && saved->dir_y == key.dir_y &&
+           saved->plane_x == key.plane_x && saved->plane_y == key.plane_y;
+}
+
+// Walls, then floor and ceiling, into target; updates the hit cache and
+// the interlaced history
+static void render_view(Engine* engine, Player* player, const Map* map, TextureManager* tm,
+                        RenderTarget* target, CacheMode cache_mode) {
+    // Flat floor and ceiling go in with the wall columns when a column is
+    // contiguous; on row-major targets a row pass fills them afterwards
+    bool flat_fill = !engine->textured_floors && target->y_stride == 1;
+
+    // Interlaced mode draws walls into a history buffer that keeps last
+    // frame's columns, then copies their wall spans to the target, under
+    // the floors and sprites
+    RenderTarget wall_target = *target;
+    int parity = -1;
+    bool spatial_fill = false;
+    bool use_history = false;
+    size_t target_bytes = (size_t)target->width * target->height * (target->indices ? 1 : sizeof(uint32_t));
+    if (engine->interlaced) {
+        int blocks = (target->width + COMPOSE_BLOCK - 1) / COMPOSE_BLOCK;
+        if (history_size < target_bytes || block_spans_size < blocks) {
+            free(history);
+            free(block_spans);
+            history = (uint8_t*)malloc(target_bytes);
+            block_spans = (int*)malloc(2 * blocks * sizeof(int));
+            history_size = history && block_spans ? target_bytes : 0;
+            block_spans_size = history && block_spans ? blocks : 0;
+            history_key.valid = false;
+        }
+        if (history_size > 0) {
+            if (target->indices) {
+                wall_target.indices = history;
+            } else {
+                wall_target.pixels = (uint32_t*)history;
+            }
+            parity = interlace_parity(&history_key, target);
+            spatial_fill = parity >= 0 && interlace_moved(&history_key, player);
+            use_history = true;
+        }
+    } else {
+        history_key.valid = false;
+    }
+
+    // Each band writes its own slice of z_buffer and pixel columns. The
+    // history only keeps walls.
+    WallPass pass = { engine, &wall_target, player, map, tm, z_buffer, wall_top, wall_bottom,
+                      hits, cached_hits, &cache_key, cache_mode, parity,
+                      flat_fill && !use_history, { 0 }, { 0 }, { 0 } };
+    run_bands(render_wall_band, &pass, engine->view_width);
+
+    engine->stats.interlaced_columns = 0;
+    if (use_history) {
+        // Camera moved too far: each undrawn column shows its neighbour,
+        // with its depth and wall span, so stale walls do not tear
+        if (spatial_fill) {
+            ComposeJob probe = { history, target, wall_top, wall_bottom, block_spans, parity, true, false };
+            for (int x = (parity ^ 1) & 1; x < target->width; x += 2) {
+                int src = compose_source(&probe, x);
+                z_buffer[x] = z_buffer[src];
+                wall_top[x] = wall_top[src];
+                wall_bottom[x] = wall_bottom[src];
             }
+        }
+        if (parity >= 0) {
+            engine->stats.interlaced_columns = engine->view_width - (engine->view_width + 1 - parity) / 2;
+        }
 
-            pixels[y * engine->screen_width + x] = color;
+        // Row-major: the rows each block of columns has wall pixels in
+        if (target->y_stride != 1) {
+            for (int b = 0; b * COMPOSE_BLOCK < target->width; b++) {
+                int top = target->height;
+                int bottom = 0;
+                for (int x = b * COMPOSE_BLOCK; x < (b + 1) * COMPOSE_BLOCK && x < target->width; x++) {
+                    if (wall_top[x] < wall_bottom[x]) {
+                        if (wall_top[x] < top) top = wall_top[x];
+                        if (wall_bottom[x] > bottom) bottom = wall_bottom[x];
+                    }
+                }
+                block_spans[2 * b] = top;
+                block_spans[2 * b + 1] = bottom;
+            }
+        }
+
+        ComposeJob compose = { history, target, wall_top, wall_bottom, block_spans, parity, spatial_fill, flat_fill };
+        run_bands(compose_band, &compose, target->y_stride == 1 ? target->width : target->height);
+
+        HistoryKey key = { true, target->width, target->height, target->x_stride, target->indices != NULL,
+                           map_revision, parity, player->x, player->y,
+                           player->dir_x, player->dir_y, player->plane_x, player->plane_y };
+        history_key = key;
+    }
+
+    engine->stats.wall_pixels = 0;
+    engine->stats.rays_saved = 0;
+    engine->stats.rays_reused = 0;
+    for (int i = 0; i < MAX_RENDER_THREADS; i++) {
+        engine->stats.wall_pixels += pass.band_pixels[i];
+        engine->stats.rays_saved += pass.band_saved[i];
+        engine->stats.rays_reused += pass.band_reused[i];
+    }
+
+    // This frame's hits become the cache for the next one
+    RayHit* previous = cached_hits;
+    cached_hits = hits;
+    hits = previous;
+    HitCacheKey key = { true, engine->view_width, map_revision, player->x, player->y,
+                        player->dir_x, player->dir_y, player->plane_x, player->plane_y };
+    cache_key = key;
+
+    // Textured or flat floor and ceiling fill what the walls left, row by row
+    engine->stats.floor_pixels = 0;
+    if (!flat_fill) {
+        FloorJob job = { { target, player, map, tm, wall_top, wall_bottom, CEILING_COLOR, FLOOR_COLOR }, { 0 } };
+        run_bands(engine->textured_floors ? render_floor_band : render_flat_band, &job, engine->view_height);
+        for (int i = 0; i < MAX_RENDER_THREADS; i++) {
+            engine->stats.floor_pixels += job.band_pixels[i];
+        }
+    }
+}
+
+void raycaster_render(Engine* engine, Player* player, const Map* map, TextureManager* tm, SpriteManager* sm, EnemyManager* em, PickupManager* pm) {
+    if (z_buffer_size < engine->view_width) {
+        free(z_buffer);
+        free(wall_top);
+        free(wall_bottom);
+        free(hits);
+        free(cached_hits);
+        z_buffer = (float*)malloc(engine->view_width * sizeof(float));
+        wall_top = (int*)malloc(engine->view_width * sizeof(int));
+        wall_bottom = (int*)malloc(engine->view_width * sizeof(int));
+        hits = (RayHit*)malloc(engine->view_width * sizeof(RayHit));
+        cached_hits = (RayHit*)malloc(engine->view_width * sizeof(RayHit));
+        z_buffer_size = engine->view_width;
+        cache_key.valid = false;
+    }
+
+    // Palette mode draws 8-bit indices, expanded by engine_render; otherwise
+    // column-major render mode draws into a transposed buffer first. The
+    // floor caster walks rows, which would step a whole column per pixel
+    // there, so with textured floors the view is always drawn row-major.
+    RenderTarget target;
+    bool transposed = engine->column_major && !engine->textured_floors &&
+                      !(engine->palette_mode && engine->view_indexed);
+    if (engine->palette_mode && engine->view_indexed) {
+        render_target_init_indexed(&target, engine->view_indexed, engine->view_width, engine->view_height);
+    } else if (transposed) {
+        int size = engine->view_width * engine->view_height;
+        if (column_buffer_size < size) {
+            free(column_buffer);
+            column_buffer = (uint32_t*)malloc(size * sizeof(uint32_t));
+            column_buffer_size = size;
+        }
+        render_target_init_columns(&target, column_buffer, engine->view_width, engine->view_height);
+    } else {
+        render_target_init_rows(&target, engine->view_pixels, engine->view_width, engine->view_height);
+    }
+
+    // (Re)start the worker pool when the thread count setting changes
+    if (!render_pool_started || render_pool.thread_count != engine->render_threads) {
+        if (render_pool_started) {
+            render_pool_cleanup(&render_pool);
+        }
+        render_pool_started = render_pool_init(&render_pool, engine->render_threads);
+
+        // Could not start every thread - report what we actually got
+        engine->render_threads = render_pool_started ? render_pool.thread_count : 1;
+    }
+
+    // A camera that has not moved since the saved frame sees the same
+    // walls and floors: copy them back instead of rendering. The first
+    // frame standing still renders and saves them.
+    uint8_t* target_data = target.indices ? target.indices : (uint8_t*)target.pixels;
+    size_t target_bytes = (size_t)target.width * target.height * (target.indices ? 1 : sizeof(uint32_t));
+    CacheMode cache_mode = hit_cache_mode(engine, player);
+    if (cache_mode == CACHE_SAME && still_frame_matches(engine, &target, player)) {
+        CopyJob copy = { still_frame, target_data, target_bytes / target.height };
+        run_bands(copy_history_band, &copy, target.height);
+
+        engine->stats.wall_pixels = 0;
+        engine->stats.floor_pixels = 0;
+        engine->stats.rays_saved = 0;
+        engine->stats.rays_reused = engine->view_width;
+        engine->stats.interlaced_columns = 0;
+    } else {
+        render_view(engine, player, map, tm, &target, cache_mode);
+
+        still_key.valid = false;
+        if (cache_mode == CACHE_SAME) {
+            if (still_frame_size < target_bytes) {
+                free(still_frame);
+                still_frame = (uint8_t*)malloc(target_bytes);
+                still_frame_size = still_frame ? target_bytes : 0;
+            }
+            if (still_frame) {
+                CopyJob copy = { target_data, still_frame, target_bytes / target.height };
+                run_bands(copy_history_band, &copy, target.height);
+                still_key = still_frame_key(engine, &target, player);
+            }
         }
     }
 
     // Render sprites after walls
+    engine->stats.sprites_listed = 0;
+    engine->stats.sprite_radix_sorts = 0;
+    engine->stats.sprites_occluded = 0;
+    engine->stats.sprite_pixels = 0;
     if (sm) {
-        render_sprites(engine, player, sm, em, pm, z_buffer);
+        render_sprites(engine, &target, player, map, sm, em, pm, z_buffer);
+    }
+
+    // Bring the column-major view back to the SDL framebuffer before HUD/minimap
+    if (transposed) {
+        TransposeJob job = { &target, engine->view_pixels };
+        run_bands(transpose_band, &job, engine->view_height);
+    }
+}
+
+void raycaster_cleanup(void) {
+    if (render_pool_started) {
+        render_pool_cleanup(&render_pool);
+        render_pool_started = false;
     }
+    free(column_buffer);
+    column_buffer = NULL;
+    column_buffer_size = 0;
+    free(history);
+    history = NULL;
+    history_size = 0;
+    free(block_spans);
+    block_spans = NULL;
+    block_spans_size = 0;
+    history_key.valid = false;
+    free(still_frame);
+    still_frame = NULL;
+    still_frame_size = 0;
+    still_key.valid = false;
+    sprite_renderer_cleanup();
 }
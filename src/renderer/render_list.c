@@ -0,0 +1,140 @@
+#include "render_list.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool render_list_init(RenderList* list, int capacity) {
+    memset(list, 0, sizeof(*list));
+    list->entries = (RenderEntry*)malloc((size_t)capacity * sizeof(RenderEntry));
+    list->scratch = (RenderEntry*)malloc((size_t)capacity * sizeof(RenderEntry));
+    list->position = (int*)malloc((size_t)capacity * sizeof(int));
+    if (!list->entries || !list->scratch || !list->position) {
+        fprintf(stderr, "Failed to allocate a render list of %d entries\n", capacity);
+        render_list_free(list);
+        return false;
+    }
+    list->capacity = capacity;
+    render_list_clear(list);
+    return true;
+}
+
+void render_list_free(RenderList* list) {
+    free(list->entries);
+    free(list->scratch);
+    free(list->position);
+    memset(list, 0, sizeof(*list));
+}
+
+void render_list_clear(RenderList* list) {
+    for (int i = 0; i < list->capacity; i++) {
+        list->position[i] = -1;
+    }
+    list->count = 0;
+}
+
+// Drop removed entries, keeping the order of the rest
+static void render_list_compact(RenderList* list) {
+    int count = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (list->entries[i].index >= 0) {
+            list->position[list->entries[i].index] = count;
+            list->entries[count++] = list->entries[i];
+        }
+    }
+    list->count = count;
+}
+
+void render_list_add(RenderList* list, int index) {
+    if (index < 0 || index >= list->capacity || list->position[index] >= 0) {
+        return;
+    }
+    // Each slot is listed at most once, so compacting always makes room
+    if (list->count == list->capacity) {
+        render_list_compact(list);
+    }
+    RenderEntry entry = { 0.0f, index };
+    list->position[index] = list->count;
+    list->entries[list->count++] = entry;
+}
+
+void render_list_remove(RenderList* list, int index) {
+    if (index < 0 || index >= list->capacity || list->position[index] < 0) {
+        return;
+    }
+    list->entries[list->position[index]].index = -1;
+    list->position[index] = -1;
+}
+
+// Depths are non-negative, so their float bits order like integers; the
+// top 16 bits, inverted for far-to-near, sort to within a few percent
+static uint32_t render_list_key(float depth) {
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return 0xFFFF - (bits >> 15);
+}
+
+// Two byte-wide counting passes, each stable
+static void render_list_radix(RenderList* list) {
+    RenderEntry* from = list->entries;
+    RenderEntry* to = list->scratch;
+    for (int shift = 0; shift < 16; shift += 8) {
+        int offsets[256] = { 0 };
+        for (int i = 0; i < list->count; i++) {
+            offsets[(render_list_key(from[i].depth) >> shift) & 0xFF]++;
+        }
+        int sum = 0;
+        for (int b = 0; b < 256; b++) {
+            int n = offsets[b];
+            offsets[b] = sum;
+            sum += n;
+        }
+        for (int i = 0; i < list->count; i++) {
+            to[offsets[(render_list_key(from[i].depth) >> shift) & 0xFF]++] = from[i];
+        }
+        RenderEntry* swap = from;
+        from = to;
+        to = swap;
+    }
+    // An even number of passes leaves the result back in entries
+}
+
+// Stable insertion sort by depth, giving up once it has shifted more than
+// budget entries (the entries are still all there, partly sorted)
+static bool render_list_insertion(RenderList* list, long long budget) {
+    RenderEntry* e = list->entries;
+    long long moves = 0;
+    for (int i = 1; i < list->count; i++) {
+        RenderEntry entry = e[i];
+        int j = i;
+        while (j > 0 && e[j - 1].depth < entry.depth) {
+            e[j] = e[j - 1];
+            j--;
+        }
+        e[j] = entry;
+        moves += i - j;
+        if (moves > budget) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void render_list_sort(RenderList* list) {
+    render_list_compact(list);
+    int n = list->count;
+
+    // A coherent list needs a few shifts per entry; past that, a radix
+    // pass gets close first and the insertion sort finishes exactly
+    list->radix_used = false;
+    if (n < RENDER_LIST_RADIX_MIN) {
+        render_list_insertion(list, LLONG_MAX);
+    } else if (!render_list_insertion(list, (long long)n * RENDER_LIST_MOVES)) {
+        render_list_radix(list);
+        render_list_insertion(list, LLONG_MAX);
+        list->radix_used = true;
+    }
+    for (int i = 0; i < n; i++) {
+        list->position[list->entries[i].index] = i;
+    }
+}
@@ -0,0 +1,113 @@
+#include "render_pool.h"
+#include <stdio.h>
+
+static void render_pool_run_band(RenderPool* pool, int band) {
+    int start = (int)((long long)pool->item_count * band / pool->thread_count);
+    int end = (int)((long long)pool->item_count * (band + 1) / pool->thread_count);
+    if (start < end) {
+        pool->func(pool->ctx, band, start, end);
+    }
+}
+
+static int render_worker_main(void* data) {
+    RenderWorker* worker = (RenderWorker*)data;
+    RenderPool* pool = worker->pool;
+
+    for (;;) {
+        SDL_SemWait(worker->start);
+        if (pool->quit) {
+            break;
+        }
+        render_pool_run_band(pool, worker->band);
+        SDL_SemPost(pool->done);
+    }
+
+    return 0;
+}
+
+bool render_pool_init(RenderPool* pool, int thread_count) {
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > MAX_RENDER_THREADS) thread_count = MAX_RENDER_THREADS;
+
+    pool->thread_count = 1;
+    pool->quit = false;
+    pool->func = NULL;
+    pool->ctx = NULL;
+    pool->item_count = 0;
+    pool->done = NULL;
+
+    if (thread_count == 1) {
+        return true;
+    }
+
+    pool->done = SDL_CreateSemaphore(0);
+    if (!pool->done) {
+        fprintf(stderr, "Render pool: semaphore creation failed: %s\n", SDL_GetError());
+        return false;
+    }
+
+    // Band 0 is rendered by the calling thread
+    for (int i = 1; i < thread_count; i++) {
+        RenderWorker* worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->band = i;
+        worker->start = SDL_CreateSemaphore(0);
+        worker->thread = NULL;
+        if (worker->start) {
+            worker->thread = SDL_CreateThread(render_worker_main, "render", worker);
+        }
+        if (!worker->thread) {
+            fprintf(stderr, "Render pool: only %d of %d threads started: %s\n",
+                    i, thread_count, SDL_GetError());
+            SDL_DestroySemaphore(worker->start);
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    return true;
+}
+
+void render_pool_cleanup(RenderPool* pool) {
+    pool->quit = true;
+    for (int i = 1; i < pool->thread_count; i++) {
+        SDL_SemPost(pool->workers[i].start);
+    }
+    for (int i = 1; i < pool->thread_count; i++) {
+        SDL_WaitThread(pool->workers[i].thread, NULL);
+        SDL_DestroySemaphore(pool->workers[i].start);
+    }
+    if (pool->done) {
+        SDL_DestroySemaphore(pool->done);
+        pool->done = NULL;
+    }
+    pool->thread_count = 1;
+    pool->quit = false;
+}
+
+void render_pool_run(RenderPool* pool, RenderJobFunc func, void* ctx, int item_count) {
+    pool->func = func;
+    pool->ctx = ctx;
+    pool->item_count = item_count;
+
+    // Wake workers, render our own band, then wait for the rest
+    for (int i = 1; i < pool->thread_count; i++) {
+        SDL_SemPost(pool->workers[i].start);
+    }
+    render_pool_run_band(pool, 0);
+    for (int i = 1; i < pool->thread_count; i++) {
+        SDL_SemWait(pool->done);
+    }
+}
+
+int render_pool_default_threads(void) {
+#ifdef __EMSCRIPTEN__
+    // WASM build is compiled without pthreads
+    return 1;
+#else
+    int count = SDL_GetCPUCount();
+    if (count < 1) count = 1;
+    if (count > MAX_RENDER_THREADS) count = MAX_RENDER_THREADS;
+    return count;
+#endif
+}
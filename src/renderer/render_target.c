@@ -0,0 +1,93 @@
+#include "render_target.h"
+#include <stddef.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Block edge in pixels; a 32x32 block of 32-bit pixels is 4KB per side
+#define TRANSPOSE_BLOCK 32
+
+void render_target_init_rows(RenderTarget* target, uint32_t* pixels, int width, int height) {
+    target->pixels = pixels;
+    target->indices = NULL;
+    target->width = width;
+    target->height = height;
+    target->x_stride = 1;
+    target->y_stride = width;
+}
+
+void render_target_init_indexed(RenderTarget* target, uint8_t* indices, int width, int height) {
+    target->pixels = NULL;
+    target->indices = indices;
+    target->width = width;
+    target->height = height;
+    target->x_stride = 1;
+    target->y_stride = width;
+}
+
+void render_target_init_columns(RenderTarget* target, uint32_t* pixels, int width, int height) {
+    target->pixels = pixels;
+    target->indices = NULL;
+    target->width = width;
+    target->height = height;
+    target->x_stride = height;
+    target->y_stride = 1;
+}
+
+// Transpose one block [x0, x1) x [y0, y1)
+static void transpose_block(const uint32_t* src, int height, uint32_t* dst, int width,
+                            int x0, int x1, int y0, int y1) {
+    int y = y0;
+
+#ifdef __SSE2__
+    // 4x4 tiles: four source columns in, four destination rows out
+    for (; y + 4 <= y1; y += 4) {
+        int x = x0;
+        for (; x + 4 <= x1; x += 4) {
+            const uint32_t* s = src + x * height + y;
+            __m128i a = _mm_loadu_si128((const __m128i*)(s));
+            __m128i b = _mm_loadu_si128((const __m128i*)(s + height));
+            __m128i c = _mm_loadu_si128((const __m128i*)(s + 2 * height));
+            __m128i d = _mm_loadu_si128((const __m128i*)(s + 3 * height));
+
+            __m128i ab_lo = _mm_unpacklo_epi32(a, b);
+            __m128i cd_lo = _mm_unpacklo_epi32(c, d);
+            __m128i ab_hi = _mm_unpackhi_epi32(a, b);
+            __m128i cd_hi = _mm_unpackhi_epi32(c, d);
+
+            uint32_t* o = dst + y * width + x;
+            _mm_storeu_si128((__m128i*)(o), _mm_unpacklo_epi64(ab_lo, cd_lo));
+            _mm_storeu_si128((__m128i*)(o + width), _mm_unpackhi_epi64(ab_lo, cd_lo));
+            _mm_storeu_si128((__m128i*)(o + 2 * width), _mm_unpacklo_epi64(ab_hi, cd_hi));
+            _mm_storeu_si128((__m128i*)(o + 3 * width), _mm_unpackhi_epi64(ab_hi, cd_hi));
+        }
+        // Leftover columns of these four rows
+        for (; x < x1; x++) {
+            for (int i = 0; i < 4; i++) {
+                dst[(y + i) * width + x] = src[x * height + y + i];
+            }
+        }
+    }
+#endif
+
+    // Leftover rows
+    for (; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            dst[y * width + x] = src[x * height + y];
+        }
+    }
+}
+
+void render_target_transpose(const RenderTarget* src, uint32_t* dst, int row_start, int row_end) {
+    int width = src->width;
+    int height = src->height;
+
+    for (int y0 = row_start; y0 < row_end; y0 += TRANSPOSE_BLOCK) {
+        int y1 = y0 + TRANSPOSE_BLOCK < row_end ? y0 + TRANSPOSE_BLOCK : row_end;
+        for (int x0 = 0; x0 < width; x0 += TRANSPOSE_BLOCK) {
+            int x1 = x0 + TRANSPOSE_BLOCK < width ? x0 + TRANSPOSE_BLOCK : width;
+            transpose_block(src->pixels, height, dst, width, x0, x1, y0, y1);
+        }
+    }
+}
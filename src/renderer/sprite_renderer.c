@@ -3,7 +3,12 @@
 #include "enemy.h"
 #include "engine.h"
 #include "player.h"
+#include "render_target.h"
+#include "palette.h"
+#include "render_list.h"
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 typedef struct {
@@ -12,86 +17,376 @@ typedef struct {
     int type;  // 0=static sprite, 1=enemy, 2=pickup
 } SpriteOrder;
 
-static int compare_sprites(const void* a, const void* b) {
-    SpriteOrder* sa = (SpriteOrder*)a;
-    SpriteOrder* sb = (SpriteOrder*)b;
-    if (sa->distance > sb->distance) return -1;
-    if (sa->distance < sb->distance) return 1;
-    return 0;
+// Refresh the squared distances of a manager's listed billboards, then
+// restore the draw order. Positions are read at x_offset and y_offset
+// (offsetof the element's x and y) into each element.
+static void sort_render_list(RenderList* list, const void* elements, size_t element_size, size_t x_offset,
+                             size_t y_offset, const Player* player, RenderStats* stats) {
+    for (int i = 0; i < list->count; i++) {
+        RenderEntry* entry = &list->entries[i];
+        if (entry->index < 0) continue;
+
+        const char* element = (const char*)elements + (size_t)entry->index * element_size;
+        float x, y;
+        memcpy(&x, element + x_offset, sizeof(x));
+        memcpy(&y, element + y_offset, sizeof(y));
+        entry->depth = (player->x - x) * (player->x - x) + (player->y - y) * (player->y - y);
+    }
+    render_list_sort(list);
+    stats->sprites_listed += list->count;
+    stats->sprite_radix_sorts += list->radix_used;
+}
+
+// Texel row (before mip scaling) the column loop samples at screen row y
+static inline int sprite_tex_y(int y, int view_height, int sprite_height) {
+    int d = y * 256 - view_height * 128 + sprite_height * 128;
+    return ((d * TEXTURE_HEIGHT) / sprite_height) / 256;
+}
+
+// First screen row that samples texel row tex_y or below it: an estimate
+// from the inverse, settled with the exact mapping above
+static int sprite_first_row(int tex_y, int view_height, int sprite_height) {
+    int y = (int)(((long long)tex_y * 256 * sprite_height / TEXTURE_HEIGHT + (long long)(view_height - sprite_height) * 128) / 256);
+    while (sprite_tex_y(y, view_height, sprite_height) >= tex_y) y--;
+    while (sprite_tex_y(y, view_height, sprite_height) < tex_y) y++;
+    return y;
+}
+
+// Walks sprite_tex_y down a run of rows without a division per pixel: the
+// inner quotient is kept as a floored quotient and remainder
+typedef struct {
+    int quotient;
+    int remainder;
+    int step_quotient;
+    int step_remainder;
+    int divisor;
+} SpriteRowStep;
+
+static inline SpriteRowStep sprite_row_step(int y, int view_height, int sprite_height) {
+    int n = (y * 256 - view_height * 128 + sprite_height * 128) * TEXTURE_HEIGHT;
+    SpriteRowStep step = { n / sprite_height, n % sprite_height,
+                           256 * TEXTURE_HEIGHT / sprite_height, 256 * TEXTURE_HEIGHT % sprite_height, sprite_height };
+    if (step.remainder < 0) {
+        step.quotient--;
+        step.remainder += sprite_height;
+    }
+    return step;
+}
+
+// Texel row of the current screen row, then advance one row. Rows inside
+// a run never sample above row 0, so a negative quotient means row 0.
+static inline int sprite_row_next(SpriteRowStep* step) {
+    int tex_y = step->quotient > 0 ? step->quotient / 256 : 0;
+    step->quotient += step->step_quotient;
+    step->remainder += step->step_remainder;
+    if (step->remainder >= step->divisor) {
+        step->quotient++;
+        step->remainder -= step->divisor;
+    }
+    return tex_y;
+}
+
+// Depth pyramid over the wall z-buffer: the nearest and farthest wall of
+// every 8 and every 64 columns, rebuilt after the wall pass. A sprite is
+// hidden in a block whose farthest wall is no farther than the sprite.
+#define HIZ_FINE_SHIFT 3
+#define HIZ_COARSE_SHIFT 6
+
+typedef struct {
+    float* fine_min;
+    float* fine_max;
+    float* coarse_min;
+    float* coarse_max;
+    int width;
+    int capacity;
+} DepthPyramid;
+
+// Kept across frames, freed by sprite_renderer_cleanup
+static DepthPyramid wall_hiz = { NULL, NULL, NULL, NULL, 0, 0 };
+
+static bool depth_pyramid_build(DepthPyramid* hiz, const float* z_buffer, int width) {
+    int fine = (width >> HIZ_FINE_SHIFT) + 1;
+    int coarse = (width >> HIZ_COARSE_SHIFT) + 1;
+    if (hiz->capacity < width) {
+        free(hiz->fine_min);
+        hiz->fine_min = (float*)malloc((size_t)(fine + coarse) * 2 * sizeof(float));
+        if (!hiz->fine_min) {
+            hiz->capacity = 0;
+            return false;
+        }
+        hiz->fine_max = hiz->fine_min + fine;
+        hiz->coarse_min = hiz->fine_max + fine;
+        hiz->coarse_max = hiz->coarse_min + coarse;
+        hiz->capacity = width;
+    }
+    hiz->width = width;
+
+    for (int b = 0; b < fine; b++) {
+        int start = b << HIZ_FINE_SHIFT;
+        int end = start + (1 << HIZ_FINE_SHIFT) < width ? start + (1 << HIZ_FINE_SHIFT) : width;
+        float lo = INFINITY, hi = -INFINITY;
+        for (int x = start; x < end; x++) {
+            if (z_buffer[x] < lo) lo = z_buffer[x];
+            if (z_buffer[x] > hi) hi = z_buffer[x];
+        }
+        hiz->fine_min[b] = lo;
+        hiz->fine_max[b] = hi;
+    }
+    int per_coarse = 1 << (HIZ_COARSE_SHIFT - HIZ_FINE_SHIFT);
+    for (int b = 0; b < coarse; b++) {
+        float lo = INFINITY, hi = -INFINITY;
+        for (int f = b * per_coarse; f < (b + 1) * per_coarse && f < fine; f++) {
+            if (hiz->fine_min[f] < lo) lo = hiz->fine_min[f];
+            if (hiz->fine_max[f] > hi) hi = hiz->fine_max[f];
+        }
+        hiz->coarse_min[b] = lo;
+        hiz->coarse_max[b] = hi;
+    }
+    return true;
 }
 
-void render_sprites(Engine* engine, Player* player, SpriteManager* sm, EnemyManager* em, PickupManager* pm, float* z_buffer) {
-    // Calculate sprite distances and sort
-    // Combined static sprites + enemies + pickups
-    SpriteOrder sprite_order[MAX_SPRITES + MAX_ENEMIES + MAX_PICKUPS];
-    int sprite_count = 0;
-
-    // Add static sprites
-    for (int i = 0; i < MAX_SPRITES; i++) {
-        if (!sm->sprites[i].active) continue;
-
-        sprite_order[sprite_count].sprite_index = i;
-        sprite_order[sprite_count].type = 0;  // Static sprite
-        sprite_order[sprite_count].distance =
-            (player->x - sm->sprites[i].x) * (player->x - sm->sprites[i].x) +
-            (player->y - sm->sprites[i].y) * (player->y - sm->sprites[i].y);
-        sprite_count++;
-    }
-
-    // Add enemy sprites
-    if (em) {
-        for (int i = 0; i < MAX_ENEMIES; i++) {
-            if (!em->enemies[i].active) continue;
-
-            sprite_order[sprite_count].sprite_index = i;
-            sprite_order[sprite_count].type = 1;  // Enemy
-            sprite_order[sprite_count].distance =
-                (player->x - em->enemies[i].x) * (player->x - em->enemies[i].x) +
-                (player->y - em->enemies[i].y) * (player->y - em->enemies[i].y);
-            sprite_count++;
+// Narrow columns [*start, *end) to the first and last that a sprite at
+// depth shows in, skipping hidden 64- and 8-column blocks whole. False if
+// it is hidden everywhere. *in_front is set when no wall in the remaining
+// range is nearer than the sprite, so its columns need no depth test.
+static bool depth_pyramid_clip(const DepthPyramid* hiz, const float* z_buffer, float depth,
+                               int* start, int* end, bool* in_front) {
+    const int coarse = 1 << HIZ_COARSE_SHIFT;
+    const int fine = 1 << HIZ_FINE_SHIFT;
+    int x0 = *start, x1 = *end;
+
+    while (x0 < x1) {
+        if ((x0 & (coarse - 1)) == 0 && x0 + coarse <= x1 && hiz->coarse_max[x0 >> HIZ_COARSE_SHIFT] <= depth) {
+            x0 += coarse;
+        } else if ((x0 & (fine - 1)) == 0 && x0 + fine <= x1 && hiz->fine_max[x0 >> HIZ_FINE_SHIFT] <= depth) {
+            x0 += fine;
+        } else if (depth >= z_buffer[x0]) {
+            x0++;
+        } else {
+            break;
+        }
+    }
+    if (x0 == x1) {
+        return false;
+    }
+    while (x1 > x0) {
+        if ((x1 & (coarse - 1)) == 0 && x1 - coarse >= x0 && hiz->coarse_max[(x1 - 1) >> HIZ_COARSE_SHIFT] <= depth) {
+            x1 -= coarse;
+        } else if ((x1 & (fine - 1)) == 0 && x1 - fine >= x0 && hiz->fine_max[(x1 - 1) >> HIZ_FINE_SHIFT] <= depth) {
+            x1 -= fine;
+        } else if (depth >= z_buffer[x1 - 1]) {
+            x1--;
+        } else {
+            break;
+        }
+    }
+
+    // Nearest wall over [x0, x1): ragged ends column by column, whole
+    // blocks from the pyramid
+    float nearest = INFINITY;
+    for (int x = x0; x < x1;) {
+        if ((x & (coarse - 1)) == 0 && x + coarse <= x1) {
+            if (hiz->coarse_min[x >> HIZ_COARSE_SHIFT] < nearest) nearest = hiz->coarse_min[x >> HIZ_COARSE_SHIFT];
+            x += coarse;
+        } else if ((x & (fine - 1)) == 0 && x + fine <= x1) {
+            if (hiz->fine_min[x >> HIZ_FINE_SHIFT] < nearest) nearest = hiz->fine_min[x >> HIZ_FINE_SHIFT];
+            x += fine;
+        } else {
+            if (z_buffer[x] < nearest) nearest = z_buffer[x];
+            x++;
         }
     }
 
-    // Add pickup sprites
-    if (pm) {
-        for (int i = 0; i < MAX_PICKUPS; i++) {
-            if (!pm->pickups[i].active) continue;
+    *start = x0;
+    *end = x1;
+    *in_front = depth < nearest;
+    return true;
+}
+
+// Advance rows screen rows without sampling them
+static inline void sprite_row_skip(SpriteRowStep* step, int rows) {
+    long long remainder = step->remainder + (long long)rows * step->step_remainder;
+    step->quotient += rows * step->step_quotient + (int)(remainder / step->divisor);
+    step->remainder = (int)(remainder % step->divisor);
+}
+
+// Write count rows of a sprite column from out down, in palette indices
+static inline void sprite_rows_indexed(uint8_t* out, int y_stride, int count, SpriteRowStep* step,
+                                       const uint8_t* tex_indices, int mip, const uint8_t* flash_map) {
+    for (int i = 0; i < count; i++, out += y_stride) {
+        *out = flash_map[tex_indices[sprite_row_next(step) >> mip]];
+    }
+}
+
+// Write count rows of a sprite column from out down, in ARGB, blended
+// towards white by flash
+static inline void sprite_rows_argb(uint32_t* out, int y_stride, int count, SpriteRowStep* step,
+                                    const uint32_t* tex_column, int mip, float flash) {
+    for (int i = 0; i < count; i++, out += y_stride) {
+        uint32_t color = tex_column[sprite_row_next(step) >> mip];
+
+        if (flash > 0.0f) {
+            uint32_t r = ((color >> 16) & 0xFF);
+            uint32_t g = ((color >> 8) & 0xFF);
+            uint32_t b = (color & 0xFF);
 
-            sprite_order[sprite_count].sprite_index = i;
-            sprite_order[sprite_count].type = 2;  // Pickup
-            sprite_order[sprite_count].distance =
-                (player->x - pm->pickups[i].x) * (player->x - pm->pickups[i].x) +
-                (player->y - pm->pickups[i].y) * (player->y - pm->pickups[i].y);
-            sprite_count++;
+            r = r + (255 - r) * flash;
+            g = g + (255 - g) * flash;
+            b = b + (255 - b) * flash;
+
+            color = (r << 16) | (g << 8) | b;
         }
+        *out = color & 0x00FFFFFF;
+    }
+}
+
+// Front-to-back drawing: which rows of each column already hold a sprite
+// pixel (one bit per row), how many drawable rows are still open, and the
+// depth each column rejects sprites at: the wall's, or 0 once every row
+// is covered
+typedef struct {
+    uint64_t* rows;
+    int* open_rows;
+    float* depth;
+    int words;                  // Mask words per column
+    size_t capacity;            // Mask words allocated
+    int columns;                // Columns allocated
+} SpriteCoverage;
+
+static SpriteCoverage sprite_cover = { NULL, NULL, NULL, 0, 0, 0 };
+
+static bool sprite_coverage_reset(SpriteCoverage* cover, const float* z_buffer, int width, int height) {
+    int words = (height + 63) / 64;
+    size_t needed = (size_t)width * words;
+    if (cover->capacity < needed) {
+        free(cover->rows);
+        cover->rows = (uint64_t*)malloc(needed * sizeof(uint64_t));
+        cover->capacity = cover->rows ? needed : 0;
+    }
+    if (cover->columns < width) {
+        free(cover->open_rows);
+        free(cover->depth);
+        cover->open_rows = (int*)malloc((size_t)width * sizeof(int));
+        cover->depth = (float*)malloc((size_t)width * sizeof(float));
+        cover->columns = cover->open_rows && cover->depth ? width : 0;
+    }
+    if (!cover->capacity || !cover->columns) {
+        return false;
+    }
+
+    cover->words = words;
+    memset(cover->rows, 0, needed * sizeof(uint64_t));
+    for (int x = 0; x < width; x++) {
+        cover->open_rows[x] = height - 1;  // Sprites never draw the bottom row
+        cover->depth[x] = z_buffer[x];
     }
+    return true;
+}
+
+// Column x was just covered: refresh the blocks that hold it, so later
+// sprites behind it are rejected by the pyramid
+static void depth_pyramid_update(DepthPyramid* hiz, const float* depth, int x) {
+    int fine = x >> HIZ_FINE_SHIFT;
+    int start = fine << HIZ_FINE_SHIFT;
+    int end = start + (1 << HIZ_FINE_SHIFT) < hiz->width ? start + (1 << HIZ_FINE_SHIFT) : hiz->width;
+    float lo = INFINITY, hi = -INFINITY;
+    for (int i = start; i < end; i++) {
+        if (depth[i] < lo) lo = depth[i];
+        if (depth[i] > hi) hi = depth[i];
+    }
+    hiz->fine_min[fine] = lo;
+    hiz->fine_max[fine] = hi;
+
+    int coarse = x >> HIZ_COARSE_SHIFT;
+    int per_coarse = 1 << (HIZ_COARSE_SHIFT - HIZ_FINE_SHIFT);
+    int fine_count = (hiz->width >> HIZ_FINE_SHIFT) + 1;
+    lo = INFINITY;
+    hi = -INFINITY;
+    for (int f = coarse * per_coarse; f < (coarse + 1) * per_coarse && f < fine_count; f++) {
+        if (hiz->fine_min[f] < lo) lo = hiz->fine_min[f];
+        if (hiz->fine_max[f] > hi) hi = hiz->fine_max[f];
+    }
+    hiz->coarse_min[coarse] = lo;
+    hiz->coarse_max[coarse] = hi;
+}
 
-    // Sort all sprites from far to near
-    qsort(sprite_order, sprite_count, sizeof(SpriteOrder), compare_sprites);
+void render_sprites(Engine* engine, RenderTarget* target, Player* player, const Map* map, SpriteManager* sm, EnemyManager* em, PickupManager* pm, float* z_buffer) {
+    // Each manager keeps its own list in draw order; sort them and merge.
+    // Ties go to static sprites, then enemies, then pickups.
+    RenderList* lists[3] = { &sm->render_list, em ? &em->render_list : NULL, pm ? &pm->render_list : NULL };
+    sort_render_list(lists[0], sm->sprites, sizeof(Sprite), offsetof(Sprite, x), offsetof(Sprite, y),
+                     player, &engine->stats);
+    if (em) sort_render_list(lists[1], em->enemies, sizeof(Enemy), offsetof(Enemy, x), offsetof(Enemy, y),
+                             player, &engine->stats);
+    if (pm) sort_render_list(lists[2], pm->pickups, sizeof(Pickup), offsetof(Pickup, x), offsetof(Pickup, y),
+                             player, &engine->stats);
+    if (engine->stats.sprites_listed == 0) return;
+
+    // Front to back, the first opaque texel to reach a pixel is the one
+    // painter's order would have written last, so each pixel is written
+    // at most once and columns stop taking sprites once they are covered
+    bool front_to_back = engine->sprites_front_to_back &&
+                         sprite_coverage_reset(&sprite_cover, z_buffer, engine->view_width, engine->view_height);
+    const float* column_depth = front_to_back ? sprite_cover.depth : z_buffer;
+
+    bool use_hiz = depth_pyramid_build(&wall_hiz, column_depth, engine->view_width);
+
+    int next[3];
+    for (int t = 0; t < 3; t++) {
+        next[t] = front_to_back && lists[t] ? lists[t]->count - 1 : 0;
+    }
+
+    for (;;) {
+        SpriteOrder order = { -1.0f, -1, -1 };
+        if (front_to_back) {
+            // Exactly the far-to-near merge reversed: nearest first, ties
+            // to pickups, then enemies, then static sprites
+            order.distance = INFINITY;
+            for (int t = 2; t >= 0; t--) {
+                if (lists[t] && next[t] >= 0 && lists[t]->entries[next[t]].depth < order.distance) {
+                    order.distance = lists[t]->entries[next[t]].depth;
+                    order.sprite_index = lists[t]->entries[next[t]].index;
+                    order.type = t;
+                }
+            }
+            if (order.type < 0) break;
+            next[order.type]--;
+        } else {
+            for (int t = 0; t < 3; t++) {
+                if (lists[t] && next[t] < lists[t]->count && lists[t]->entries[next[t]].depth > order.distance) {
+                    order.distance = lists[t]->entries[next[t]].depth;
+                    order.sprite_index = lists[t]->entries[next[t]].index;
+                    order.type = t;
+                }
+            }
+            if (order.type < 0) break;
+            next[order.type]++;
+        }
 
-    // Render each sprite
-    for (int i = 0; i < sprite_count; i++) {
         float sprite_x, sprite_y;
         int tex_id;
 
         // Get sprite position and texture based on type
-        if (sprite_order[i].type == 1) {  // Enemy
-            Enemy* enemy = &em->enemies[sprite_order[i].sprite_index];
+        if (order.type == 1) {  // Enemy
+            Enemy* enemy = &em->enemies[order.sprite_index];
             sprite_x = enemy->x;
             sprite_y = enemy->y;
             tex_id = enemy->animation_frame % em->texture_count;
-        } else if (sprite_order[i].type == 2) {  // Pickup
-            Pickup* pickup = &pm->pickups[sprite_order[i].sprite_index];
+        } else if (order.type == 2) {  // Pickup
+            Pickup* pickup = &pm->pickups[order.sprite_index];
             sprite_x = pickup->x;
             sprite_y = pickup->y;
             tex_id = pickup->type;  // Use pickup type as texture index
         } else {  // Static sprite
-            Sprite* sprite = &sm->sprites[sprite_order[i].sprite_index];
+            Sprite* sprite = &sm->sprites[order.sprite_index];
             sprite_x = sprite->x;
             sprite_y = sprite->y;
             tex_id = sprite->texture_id;
         }
 
+        // Billboards in chunks that aren't streamed in stay hidden
+        if (!map_loaded(map, (int)sprite_x, (int)sprite_y)) continue;
+
         // Translate sprite position to relative to camera
         float rel_x = sprite_x - player->x;
         float rel_y = sprite_y - player->y;
@@ -105,88 +400,167 @@ void render_sprites(Engine* engine, Player* player, SpriteManager* sm, EnemyMana
         if (transform_y <= 0.1f) continue;
 
         // Calculate sprite screen position
-        int sprite_screen_x = (int)((engine->screen_width / 2) * (1 + transform_x / transform_y));
+        int sprite_screen_x = (int)((engine->view_width / 2) * (1 + transform_x / transform_y));
 
         // Calculate sprite height and width
-        int sprite_height = abs((int)(engine->screen_height / transform_y));
-        int sprite_width = abs((int)(engine->screen_height / transform_y));
+        int sprite_height = abs((int)(engine->view_height / transform_y));
+        int sprite_width = abs((int)(engine->view_height / transform_y));
 
         // Calculate draw bounds
-        int draw_start_y = -sprite_height / 2 + engine->screen_height / 2;
+        int draw_start_y = -sprite_height / 2 + engine->view_height / 2;
         if (draw_start_y < 0) draw_start_y = 0;
-        int draw_end_y = sprite_height / 2 + engine->screen_height / 2;
-        if (draw_end_y >= engine->screen_height) draw_end_y = engine->screen_height - 1;
+        int draw_end_y = sprite_height / 2 + engine->view_height / 2;
+        if (draw_end_y >= engine->view_height) draw_end_y = engine->view_height - 1;
 
         int draw_start_x = -sprite_width / 2 + sprite_screen_x;
         if (draw_start_x < 0) draw_start_x = 0;
         int draw_end_x = sprite_width / 2 + sprite_screen_x;
-        if (draw_end_x >= engine->screen_width) draw_end_x = engine->screen_width - 1;
+        if (draw_end_x >= engine->view_width) draw_end_x = engine->view_width - 1;
+
+        // Clip to the columns where walls don't hide the sprite
+        bool in_front = false;
+        if (use_hiz && draw_start_x < draw_end_x &&
+            !depth_pyramid_clip(&wall_hiz, column_depth, transform_y, &draw_start_x, &draw_end_x, &in_front)) {
+            engine->stats.sprites_occluded++;
+            continue;
+        }
 
         // Get sprite texture based on type
         Texture* tex = NULL;
-        uint32_t* tex_pixels = NULL;
 
-        if (sprite_order[i].type == 1) {  // Enemy
+        if (order.type == 1) {  // Enemy
             if (tex_id < 0 || tex_id >= em->texture_count) tex_id = 0;
             tex = &em->textures[tex_id];
-            tex_pixels = tex->data;
-        } else if (sprite_order[i].type == 2) {  // Pickup
+        } else if (order.type == 2) {  // Pickup
             if (tex_id < 0 || tex_id >= PICKUP_COUNT) tex_id = 0;
             tex = &pm->textures[tex_id];
-            tex_pixels = tex->data;
         } else {  // Static sprite
             if (tex_id < 0 || tex_id >= sm->texture_count) tex_id = 0;
             tex = &sm->sprite_textures[tex_id];
-            tex_pixels = tex->data;
         }
 
-        // Cache screen buffer pointer
-        uint32_t* pixels = engine->pixels;
+        // Cache target layout
+        uint32_t* pixels = target->pixels;
+        uint8_t* indices = target->indices;
+        int x_stride = target->x_stride;
+        int y_stride = target->y_stride;
+
+        // Enemies flash white when hit: through a brighten colormap in
+        // palette mode, by blending each texel otherwise
+        float flash = 0.0f;
+        if (order.type == 1 && em->enemies[order.sprite_index].hit_flash_time > 0.0f) {
+            flash = em->enemies[order.sprite_index].hit_flash_time / 0.15f;
+        }
+        const uint8_t* flash_map = palette_get()->brighten[flash > 0.0f ? palette_tint_level(flash) : 0];
 
         // Pre-calculate sprite offset for tex_x calculation
         int sprite_offset = -sprite_width / 2 + sprite_screen_x;
 
+        // Distant sprites sample a smaller mip level
+        int mip = engine->mipmaps ? texture_mip_level(sprite_height) : 0;
+
         // Draw sprite
         for (int stripe = draw_start_x; stripe < draw_end_x; stripe++) {
-            // Check if sprite is in front of wall (z-buffer)
-            if (transform_y >= z_buffer[stripe]) continue;
+            // Check if sprite is in front of wall (z-buffer), a hidden
+            // block of columns at a time where possible
+            if (!in_front) {
+                const int block = 1 << HIZ_FINE_SHIFT;
+                if (use_hiz && (stripe & (block - 1)) == 0 && stripe + block <= draw_end_x &&
+                    wall_hiz.fine_max[stripe >> HIZ_FINE_SHIFT] <= transform_y) {
+                    stripe += block - 1;
+                    continue;
+                }
+                if (transform_y >= column_depth[stripe]) continue;
+            }
 
             // Draw textured sprite (all types now use textures)
             int tex_x = (int)((stripe - sprite_offset) * TEXTURE_WIDTH / sprite_width);
             if (tex_x < 0 || tex_x >= TEXTURE_WIDTH) continue;
 
-            for (int y = draw_start_y; y < draw_end_y; y++) {
-                int d = y * 256 - engine->screen_height * 128 + sprite_height * 128;
-                int tex_y = ((d * TEXTURE_HEIGHT) / sprite_height) / 256;
-
-                if (tex_y < 0 || tex_y >= TEXTURE_HEIGHT) continue;
-
-                uint32_t color = tex_pixels[tex_y * TEXTURE_WIDTH + tex_x];
-
-                // Apply hit flash for enemies
-                if (sprite_order[i].type == 1) {  // Enemy
-                    Enemy* enemy = &em->enemies[sprite_order[i].sprite_index];
-                    if (enemy->hit_flash_time > 0.0f) {
-                        // Flash white when hit
-                        float intensity = enemy->hit_flash_time / 0.15f;
-                        uint32_t r = ((color >> 16) & 0xFF);
-                        uint32_t g = ((color >> 8) & 0xFF);
-                        uint32_t b = (color & 0xFF);
-
-                        r = r + (255 - r) * intensity;
-                        g = g + (255 - g) * intensity;
-                        b = b + (255 - b) * intensity;
+            // Only the opaque runs of the column are visited, so there is
+            // no transparency test per pixel
+            int span_count;
+            const uint8_t* spans = texture_mip_spans(tex, mip, tex_x >> mip, &span_count);
+            const uint8_t* tex_indices = texture_index_mip_column(tex, mip, tex_x >> mip);
+            const uint32_t* tex_column = texture_mip_column(tex, mip, tex_x >> mip);
+
+            for (int s = 0; s < span_count; s++) {
+                int y = sprite_first_row(spans[2 * s] << mip, engine->view_height, sprite_height);
+                int end = sprite_first_row(spans[2 * s + 1] << mip, engine->view_height, sprite_height);
+                if (y < draw_start_y) y = draw_start_y;
+                if (end > draw_end_y) end = draw_end_y;
+                if (y >= end) continue;
+
+                SpriteRowStep step = sprite_row_step(y, engine->view_height, sprite_height);
+
+                if (!front_to_back) {
+                    if (indices) {
+                        sprite_rows_indexed(indices + stripe * x_stride + y * y_stride, y_stride, end - y, &step,
+                                            tex_indices, mip, flash_map);
+                    } else {
+                        sprite_rows_argb(pixels + stripe * x_stride + y * y_stride, y_stride, end - y, &step,
+                                         tex_column, mip, flash);
+                    }
+                    engine->stats.sprite_pixels += end - y;
+                    continue;
+                }
 
-                        color = (color & 0xFF000000) | (r << 16) | (g << 8) | b;
+                // Alternate between runs of rows still open, which are drawn
+                // and marked, and runs already covered, which are skipped
+                uint64_t* covered = sprite_cover.rows + (size_t)stripe * sprite_cover.words;
+                while (y < end) {
+                    int bit = y & 63;
+                    uint64_t open = ~covered[y >> 6] >> bit;
+                    uint64_t run_bits = (open & 1) ? ~open : open;
+                    int run = run_bits ? __builtin_ctzll(run_bits) : 64;
+                    if (run > 64 - bit) run = 64 - bit;
+                    if (run > end - y) run = end - y;
+
+                    if (open & 1) {
+                        if (indices) {
+                            sprite_rows_indexed(indices + stripe * x_stride + y * y_stride, y_stride, run, &step,
+                                                tex_indices, mip, flash_map);
+                        } else {
+                            sprite_rows_argb(pixels + stripe * x_stride + y * y_stride, y_stride, run, &step,
+                                             tex_column, mip, flash);
+                        }
+                        covered[y >> 6] |= (run == 64 ? ~0ull : (((uint64_t)1 << run) - 1)) << bit;
+                        sprite_cover.open_rows[stripe] -= run;
+                        engine->stats.sprite_pixels += run;
+                    } else {
+                        sprite_row_skip(&step, run);
                     }
+                    y += run;
                 }
+            }
 
-                // Check alpha (transparency) - only render if alpha > 128 (more than 50% opaque)
-                uint8_t alpha = (color >> 24) & 0xFF;
-                if (alpha > 128) {
-                    pixels[y * engine->screen_width + stripe] = color & 0x00FFFFFF;
+            // Nothing behind a fully covered column can show
+            if (front_to_back && sprite_cover.open_rows[stripe] == 0 && sprite_cover.depth[stripe] > 0.0f) {
+                sprite_cover.depth[stripe] = 0.0f;
+                if (use_hiz) {
+                    depth_pyramid_update(&wall_hiz, sprite_cover.depth, stripe);
                 }
             }
         }
     }
 }
+
+// Free what render_sprites keeps between frames; called by raycaster_cleanup
+void sprite_renderer_cleanup(void) {
+    free(sprite_cover.rows);
+    free(sprite_cover.open_rows);
+    free(sprite_cover.depth);
+    sprite_cover.rows = NULL;
+    sprite_cover.open_rows = NULL;
+    sprite_cover.depth = NULL;
+    sprite_cover.capacity = 0;
+    sprite_cover.columns = 0;
+
+    free(wall_hiz.fine_min);
+    wall_hiz.fine_min = NULL;
+    wall_hiz.fine_max = NULL;
+    wall_hiz.coarse_min = NULL;
+    wall_hiz.coarse_max = NULL;
+    wall_hiz.width = 0;
+    wall_hiz.capacity = 0;
+}
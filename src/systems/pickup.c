@@ -103,6 +103,9 @@ static void generate_pickup_texture(Texture* tex, PickupType type) {
             tex->data[y * TEXTURE_WIDTH + x] = color;
         }
     }
+
+    texture_build_columns(tex);
+    texture_build_spans(tex);
 }
 
 bool pickup_manager_init(PickupManager* pm) {
@@ -120,24 +123,34 @@ bool pickup_manager_init(PickupManager* pm) {
     generate_pickup_texture(&pm->textures[PICKUP_HEALTH_SMALL], PICKUP_HEALTH_SMALL);
     generate_pickup_texture(&pm->textures[PICKUP_HEALTH_LARGE], PICKUP_HEALTH_LARGE);
 
-    return true;
+    return render_list_init(&pm->render_list, MAX_PICKUPS);
 }
 
 void pickup_manager_cleanup(PickupManager* pm) {
     pm->count = 0;
+    render_list_free(&pm->render_list);
+}
+
+// Take pickup i out of the world
+static void pickup_remove(PickupManager* pm, int i) {
+    pm->pickups[i].active = false;
+    pm->count--;
+    render_list_remove(&pm->render_list, i);
 }
 
-void pickup_manager_update(PickupManager* pm, float delta_time) {
+void pickup_manager_update(PickupManager* pm, const Map* map, float delta_time) {
     for (int i = 0; i < MAX_PICKUPS; i++) {
         Pickup* p = &pm->pickups[i];
         if (!p->active) continue;
 
+        // Lifetimes don't run out while the chunk isn't streamed in
+        if (!map_loaded(map, (int)p->x, (int)p->y)) continue;
+
         // Update lifetime
         if (p->lifetime > 0.0f) {
             p->lifetime -= delta_time;
             if (p->lifetime <= 0.0f) {
-                p->active = false;
-                pm->count--;
+                pickup_remove(pm, i);
             }
         }
     }
@@ -158,6 +171,7 @@ bool pickup_add(PickupManager* pm, float x, float y, PickupType type, float life
             p->active = true;
             p->lifetime = lifetime;
             pm->count++;
+            render_list_add(&pm->render_list, i);
             return true;
         }
     }
@@ -165,6 +179,50 @@ bool pickup_add(PickupManager* pm, float x, float y, PickupType type, float life
     return false;
 }
 
+int pickup_add_bulk(PickupManager* pm, const MapEntity* entities, int count) {
+    int added = 0;
+    int slot = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (entities[i].kind != MAP_ENTITY_PICKUP || entities[i].type >= PICKUP_COUNT) {
+            continue;
+        }
+        while (slot < MAX_PICKUPS && pm->pickups[slot].active) {
+            slot++;
+        }
+        if (slot == MAX_PICKUPS) {
+            break;
+        }
+        Pickup* p = &pm->pickups[slot];
+        p->x = entities[i].x;
+        p->y = entities[i].y;
+        p->type = (PickupType)entities[i].type;
+        p->active = true;
+        p->lifetime = 0.0f;
+        render_list_add(&pm->render_list, slot);
+        added++;
+    }
+
+    pm->count += added;
+    return added;
+}
+
+void pickup_remove_bulk(PickupManager* pm, const MapEntity* entities, int count) {
+    for (int i = 0; i < count; i++) {
+        if (entities[i].kind != MAP_ENTITY_PICKUP) {
+            continue;
+        }
+        for (int j = 0; j < MAX_PICKUPS; j++) {
+            Pickup* p = &pm->pickups[j];
+            if (p->active && p->lifetime == 0.0f && p->x == entities[i].x && p->y == entities[i].y &&
+                p->type == (PickupType)entities[i].type) {
+                pickup_remove(pm, j);
+                break;
+            }
+        }
+    }
+}
+
 void pickup_check_collision(PickupManager* pm, Player* player) {
     for (int i = 0; i < MAX_PICKUPS; i++) {
         Pickup* p = &pm->pickups[i];
@@ -183,8 +241,7 @@ void pickup_check_collision(PickupManager* pm, Player* player) {
                     int added = weapon_add_ammo(weapon, 20);
                     if (added > 0) {
                         printf("Picked up +%d ammo\n", added);
-                        p->active = false;
-                        pm->count--;
+                        pickup_remove(pm, i);
                     }
                     break;
                 }
@@ -194,8 +251,7 @@ void pickup_check_collision(PickupManager* pm, Player* player) {
                     int added = weapon_add_ammo(weapon, 50);
                     if (added > 0) {
                         printf("Picked up +%d ammo\n", added);
-                        p->active = false;
-                        pm->count--;
+                        pickup_remove(pm, i);
                     }
                     break;
                 }
@@ -207,8 +263,7 @@ void pickup_check_collision(PickupManager* pm, Player* player) {
                             player->health = player->max_health;
                         }
                         printf("Picked up +25 health (Health: %d)\n", player->health);
-                        p->active = false;
-                        pm->count--;
+                        pickup_remove(pm, i);
                     }
                     break;
 
@@ -219,8 +274,7 @@ void pickup_check_collision(PickupManager* pm, Player* player) {
                             player->health = player->max_health;
                         }
                         printf("Picked up +50 health (Health: %d)\n", player->health);
-                        p->active = false;
-                        pm->count--;
+                        pickup_remove(pm, i);
                     }
                     break;
 
@@ -0,0 +1,84 @@
+// Convert a text .map file to the binary format the engine maps straight
+// into memory, then load both back and compare their grids and load times.
+// With --chunked, write a chunked world for streaming instead.
+//
+// Usage: map_convert [--chunked] input.map output
+
+#include "map.h"
+#include "map_stream.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+static double ms_since(Uint64 start) {
+    return 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static bool maps_equal(const Map* a, const Map* b) {
+    size_t grid = (size_t)a->tile_count + 1;
+    return a->width == b->width && a->height == b->height &&
+           a->player_spawn_x == b->player_spawn_x && a->player_spawn_y == b->player_spawn_y &&
+           memcmp(a->tiles, b->tiles, grid) == 0 && memcmp(a->floor, b->floor, grid) == 0 &&
+           memcmp(a->ceiling, b->ceiling, grid) == 0 && memcmp(a->distance, b->distance, grid) == 0 &&
+           memcmp(a->solid, b->solid, ((size_t)a->block_count + 1) * sizeof(uint64_t)) == 0 &&
+           a->entity_total == b->entity_total &&
+           (a->entity_total == 0 || memcmp(a->entities, b->entities, (size_t)a->entity_total * sizeof(MapEntity)) == 0);
+}
+
+int main(int argc, char* argv[]) {
+    bool chunked = argc == 4 && strcmp(argv[1], "--chunked") == 0;
+    if (argc != 3 && !chunked) {
+        fprintf(stderr, "Usage: %s [--chunked] input.map output\n", argv[0]);
+        return 1;
+    }
+    const char* input = argv[argc - 2];
+    const char* output = argv[argc - 1];
+
+    static Map text, binary;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (!map_load(&text, input)) {
+        map_free(&text);
+        return 1;
+    }
+    double text_ms = ms_since(start);
+
+    if (chunked) {
+        start = SDL_GetPerformanceCounter();
+        bool ok = map_stream_save(&text, output);
+        if (ok) {
+            printf("Wrote %s: %dx%d in %dx%d chunks, %.3f ms\n", output, text.width, text.height,
+                   (text.height + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE, (text.width + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE,
+                   ms_since(start));
+        }
+        map_free(&text);
+        return ok ? 0 : 1;
+    }
+
+    if (!map_save_binary(&text, output)) {
+        map_free(&text);
+        return 1;
+    }
+
+    start = SDL_GetPerformanceCounter();
+    if (!map_load_binary(&binary, output)) {
+        map_free(&binary);
+        map_free(&text);
+        return 1;
+    }
+    double binary_ms = ms_since(start);
+
+    bool same = maps_equal(&text, &binary);
+    printf("Wrote %s: %dx%d, %.1f MB\n", output, binary.width, binary.height, binary.file_size / 1e6);
+    printf("  Text load:   %9.3f ms\n", text_ms);
+    printf("  Binary load: %9.3f ms\n", binary_ms);
+
+    map_free(&binary);
+    map_free(&text);
+
+    if (!same) {
+        fprintf(stderr, "Binary map differs from the text map\n");
+        return 1;
+    }
+    return 0;
+}
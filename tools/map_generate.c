@@ -0,0 +1,453 @@
+// Generate large stress-test maps: mazes, open arenas, pillar forests and
+// long corridors, with sprites, enemies and pickups placed in empty tiles.
+// The output depends only on the options and the seed, so benchmark runs
+// on different builds and machines see the same map.
+//
+// Usage: map_generate [options] output
+//   --type maze|arena|pillars|corridors   Topology (default maze)
+//   --size N or WxH                       Map size in tiles (default 1024)
+//   --seed N                              Random seed (default 1)
+//   --density F                           Wall density, 0 to 1; see below
+//   --sprites N --enemies N --pickups N   Entities to place (default: the engine maximum)
+//   --binary | --chunked                  Write a binary map or a chunked world instead of text
+//
+// Density per topology: maze, the share of walls kept after carving
+// (1 = a perfect maze, lower opens loops; default 1); arena, the share of
+// the floor covered by rectangular blocks (default 0.05); pillars, the
+// chance of a pillar on each even tile (default 0.3); corridors, the share
+// of each dividing wall left without doors (default 0.98).
+
+#include "map.h"
+#include "map_stream.h"
+#include "sprite.h"
+#include "enemy.h"
+#include "pickup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    GEN_MAZE,
+    GEN_ARENA,
+    GEN_PILLARS,
+    GEN_CORRIDORS,
+    GEN_TYPE_COUNT
+} GenType;
+
+static const char* const gen_type_names[GEN_TYPE_COUNT] = { "maze", "arena", "pillars", "corridors" };
+static const float gen_default_density[GEN_TYPE_COUNT] = { 1.0f, 0.05f, 0.3f, 0.98f };
+
+// xorshift64*, seeded through splitmix64 so nearby seeds give unrelated maps
+typedef struct {
+    uint64_t state;
+} Rng;
+
+static void rng_seed(Rng* rng, uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    rng->state = (z ^ (z >> 31)) | 1;
+}
+
+static uint64_t rng_next(Rng* rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1Dull;
+}
+
+// Uniform in [0, n)
+static uint32_t rng_below(Rng* rng, uint32_t n) {
+    return (uint32_t)(((rng_next(rng) >> 32) * n) >> 32);
+}
+
+// True with probability p
+static bool rng_chance(Rng* rng, double p) {
+    return (double)(rng_next(rng) >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+static uint8_t gen_wall(Rng* rng) {
+    return (uint8_t)(1 + rng_below(rng, 8));
+}
+
+static void gen_border(Map* map, Rng* rng) {
+    for (int x = 0; x < map->height; x++) {
+        for (int y = 0; y < map->width; y++) {
+            if (x == 0 || y == 0 || x == map->height - 1 || y == map->width - 1) {
+                map->tiles[x * map->width + y] = gen_wall(rng);
+            }
+        }
+    }
+}
+
+// Carve a perfect maze with an iterative depth-first search over the odd
+// tiles, then knock out walls between cells to open loops
+static bool gen_maze(Map* map, Rng* rng, float density) {
+    int cells_x = (map->height - 1) / 2;
+    int cells_y = (map->width - 1) / 2;
+    if (cells_x < 1 || cells_y < 1) {
+        fprintf(stderr, "Maps must be at least 3x3 for a maze\n");
+        return false;
+    }
+    int* stack = (int*)malloc((size_t)cells_x * cells_y * sizeof(int));
+    if (!stack) {
+        fprintf(stderr, "Out of memory carving a %dx%d maze\n", map->width, map->height);
+        return false;
+    }
+
+    for (int i = 0; i < map->tile_count; i++) {
+        map->tiles[i] = gen_wall(rng);
+    }
+
+    static const int step[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+    int top = 0;
+    stack[top++] = (int)rng_below(rng, (uint32_t)(cells_x * cells_y));
+    map->tiles[(2 * (stack[0] / cells_y) + 1) * map->width + 2 * (stack[0] % cells_y) + 1] = 0;
+
+    while (top > 0) {
+        int cell = stack[top - 1];
+        int cx = cell / cells_y;
+        int cy = cell % cells_y;
+
+        int options[4];
+        int option_count = 0;
+        for (int d = 0; d < 4; d++) {
+            int nx = cx + step[d][0];
+            int ny = cy + step[d][1];
+            if (nx >= 0 && ny >= 0 && nx < cells_x && ny < cells_y &&
+                map->tiles[(2 * nx + 1) * map->width + 2 * ny + 1]) {
+                options[option_count++] = d;
+            }
+        }
+        if (option_count == 0) {
+            top--;
+            continue;
+        }
+
+        int d = options[rng_below(rng, (uint32_t)option_count)];
+        int nx = cx + step[d][0];
+        int ny = cy + step[d][1];
+        map->tiles[(2 * cx + 1 + step[d][0]) * map->width + 2 * cy + 1 + step[d][1]] = 0;
+        map->tiles[(2 * nx + 1) * map->width + 2 * ny + 1] = 0;
+        stack[top++] = nx * cells_y + ny;
+    }
+    free(stack);
+
+    // Walls between two cells sit on tiles with one odd and one even coordinate
+    for (int x = 1; x < 2 * cells_x; x++) {
+        for (int y = 1; y < 2 * cells_y; y++) {
+            if (((x ^ y) & 1) && map->tiles[x * map->width + y] && !rng_chance(rng, density)) {
+                map->tiles[x * map->width + y] = 0;
+            }
+        }
+    }
+    return true;
+}
+
+// Open floor with rectangular blocks until density of it is covered,
+// leaving the middle clear for the spawn
+static void gen_arena(Map* map, Rng* rng, float density) {
+    gen_border(map, rng);
+    long long target = (long long)(density * (double)(map->height - 2) * (double)(map->width - 2));
+    long long covered = 0;
+    int mid_x = map->height / 2;
+    int mid_y = map->width / 2;
+
+    for (long long attempt = 0; covered < target && attempt < 16 * target + 64; attempt++) {
+        int rows = 1 + (int)rng_below(rng, 8);
+        int cols = 1 + (int)rng_below(rng, 8);
+        int x0 = 1 + (int)rng_below(rng, (uint32_t)(map->height > 2 ? map->height - 2 : 1));
+        int y0 = 1 + (int)rng_below(rng, (uint32_t)(map->width > 2 ? map->width - 2 : 1));
+        uint8_t wall = gen_wall(rng);
+
+        for (int x = x0; x < x0 + rows && x < map->height - 1; x++) {
+            for (int y = y0; y < y0 + cols && y < map->width - 1; y++) {
+                if (abs(x - mid_x) <= 4 && abs(y - mid_y) <= 4) {
+                    continue;
+                }
+                if (!map->tiles[x * map->width + y]) {
+                    map->tiles[x * map->width + y] = wall;
+                    covered++;
+                }
+            }
+        }
+    }
+}
+
+// Single-tile pillars on even tiles; odd rows and columns stay open, so
+// every empty tile is reachable
+static void gen_pillars(Map* map, Rng* rng, float density) {
+    gen_border(map, rng);
+    for (int x = 2; x < map->height - 1; x += 2) {
+        for (int y = 2; y < map->width - 1; y += 2) {
+            if (rng_chance(rng, density)) {
+                map->tiles[x * map->width + y] = gen_wall(rng);
+            }
+        }
+    }
+}
+
+// Corridors three tiles wide running the full width of the map, divided
+// by one-tile walls with at least one door each
+static void gen_corridors(Map* map, Rng* rng, float density) {
+    gen_border(map, rng);
+    for (int x = 4; x < map->height - 1; x += 4) {
+        uint8_t* row = map->tiles + x * map->width;
+        for (int y = 1; y < map->width - 1; y++) {
+            if (rng_chance(rng, density)) {
+                row[y] = gen_wall(rng);
+            }
+        }
+        if (map->width > 2) {
+            row[1 + rng_below(rng, (uint32_t)(map->width - 2))] = 0;
+        }
+    }
+}
+
+// Put the spawn on the empty tile nearest the middle
+static bool gen_spawn(Map* map) {
+    int mid_x = map->height / 2;
+    int mid_y = map->width / 2;
+    int max_radius = map->width > map->height ? map->width : map->height;
+
+    for (int r = 0; r <= max_radius; r++) {
+        for (int x = mid_x - r; x <= mid_x + r; x++) {
+            for (int y = mid_y - r; y <= mid_y + r; y++) {
+                bool ring = x == mid_x - r || x == mid_x + r || y == mid_y - r || y == mid_y + r;
+                if (ring && map_inside(map, x, y) && !map->tiles[x * map->width + y]) {
+                    map->player_spawn_x = x + 0.5f;
+                    map->player_spawn_y = y + 0.5f;
+                    return true;
+                }
+            }
+        }
+    }
+    fprintf(stderr, "Generated map has no empty tiles\n");
+    return false;
+}
+
+// Place entities on distinct empty tiles away from the spawn, grouped by
+// kind. Counts are lowered to the number of tiles available.
+static bool gen_entities(Map* map, Rng* rng, int counts[MAP_ENTITY_KINDS]) {
+    int total = counts[0] + counts[1] + counts[2];
+    if (total == 0) {
+        return true;
+    }
+
+    uint32_t* cells = (uint32_t*)malloc((size_t)map->tile_count * sizeof(uint32_t));
+    if (!cells) {
+        fprintf(stderr, "Out of memory placing entities\n");
+        return false;
+    }
+    int free_count = 0;
+    for (int x = 0; x < map->height; x++) {
+        for (int y = 0; y < map->width; y++) {
+            float dx = x + 0.5f - map->player_spawn_x;
+            float dy = y + 0.5f - map->player_spawn_y;
+            if (!map->tiles[x * map->width + y] && dx * dx + dy * dy > 9.0f) {
+                cells[free_count++] = (uint32_t)(x * map->width + y);
+            }
+        }
+    }
+    if (total > free_count) {
+        fprintf(stderr, "Only %d empty tiles for %d entities; placing fewer\n", free_count, total);
+        for (int k = 0; k < MAP_ENTITY_KINDS; k++) {
+            counts[k] = (int)((long long)counts[k] * free_count / total);
+        }
+        total = counts[0] + counts[1] + counts[2];
+    }
+
+    map->entities = (MapEntity*)malloc((size_t)(total ? total : 1) * sizeof(MapEntity));
+    if (!map->entities) {
+        fprintf(stderr, "Out of memory placing entities\n");
+        free(cells);
+        return false;
+    }
+
+    // Partial Fisher-Yates shuffle: the first total cells are a uniform pick
+    int i = 0;
+    for (int k = 0; k < MAP_ENTITY_KINDS; k++) {
+        for (int n = 0; n < counts[k]; n++, i++) {
+            uint32_t j = (uint32_t)i + rng_below(rng, (uint32_t)(free_count - i));
+            uint32_t cell = cells[j];
+            cells[j] = cells[i];
+            cells[i] = cell;
+
+            MapEntity* e = &map->entities[i];
+            e->x = (float)(cell / (uint32_t)map->width) + 0.5f;
+            e->y = (float)(cell % (uint32_t)map->width) + 0.5f;
+            e->kind = (uint16_t)k;
+            if (k == MAP_ENTITY_ENEMY) {
+                // Same mix as random spawns: 50% normal, 30% fast, 20% tank
+                uint32_t roll = rng_below(rng, 100);
+                e->type = roll < 50 ? ENEMY_TYPE_NORMAL : roll < 80 ? ENEMY_TYPE_FAST : ENEMY_TYPE_TANK;
+            } else {
+                e->type = (uint16_t)rng_below(rng, k == MAP_ENTITY_SPRITE ? 4 : PICKUP_COUNT);
+            }
+        }
+        map->entity_count[k] = counts[k];
+    }
+    map->entity_total = total;
+    free(cells);
+    return true;
+}
+
+static bool write_text_map(const Map* map, const char* filename, const char* description) {
+    FILE* file = fopen(filename, "w");
+    char* row = (char*)malloc((size_t)map->width * 2);
+    if (!file || !row) {
+        fprintf(stderr, "Failed to create %s\n", filename);
+        if (file) fclose(file);
+        free(row);
+        return false;
+    }
+
+    fprintf(file, "# Generated by map_generate: %s\n%d %d\n", description, map->width, map->height);
+    bool ok = true;
+    for (int x = 0; x < map->height && ok; x++) {
+        const uint8_t* tiles = map->tiles + x * map->width;
+        char* p = row;
+        // Generated tile ids are all one digit
+        for (int y = 0; y < map->width; y++) {
+            *p++ = (char)('0' + tiles[y]);
+            *p++ = ' ';
+        }
+        p[-1] = '\n';
+        ok = fwrite(row, 1, (size_t)(p - row), file) == (size_t)(p - row);
+    }
+    fprintf(file, "%.1f %.1f\n", map->player_spawn_x, map->player_spawn_y);
+    for (int i = 0; i < map->entity_total; i++) {
+        static const char* const names[MAP_ENTITY_KINDS] = { "sprite", "enemy", "pickup" };
+        const MapEntity* e = &map->entities[i];
+        fprintf(file, "%s %.1f %.1f %u\n", names[e->kind], e->x, e->y, e->type);
+    }
+
+    free(row);
+    if (ferror(file)) {
+        ok = false;
+    }
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write %s\n", filename);
+        remove(filename);
+    }
+    return ok;
+}
+
+static int usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--type maze|arena|pillars|corridors] [--size N|WxH] [--seed N] [--density F]\n"
+            "       [--sprites N] [--enemies N] [--pickups N] [--binary|--chunked] output\n",
+            program);
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    GenType type = GEN_MAZE;
+    int width = 1024, height = 1024;
+    unsigned long long seed = 1;
+    float density = -1.0f;
+    int counts[MAP_ENTITY_KINDS] = { MAX_SPRITES, MAX_ENEMIES, MAX_PICKUPS };
+    bool binary = false, chunked = false;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool takes_value = true;
+
+        if (strcmp(arg, "--type") == 0 && value) {
+            type = GEN_TYPE_COUNT;
+            for (int t = 0; t < GEN_TYPE_COUNT; t++) {
+                if (strcmp(value, gen_type_names[t]) == 0) type = (GenType)t;
+            }
+            if (type == GEN_TYPE_COUNT) return usage(argv[0]);
+        } else if (strcmp(arg, "--size") == 0 && value) {
+            int n = sscanf(value, "%dx%d", &width, &height);
+            if (n == 1) height = width;
+            if (n < 1) return usage(argv[0]);
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--density") == 0 && value) {
+            density = strtof(value, NULL);
+            if (!(density >= 0.0f && density <= 1.0f)) return usage(argv[0]);
+        } else if (strcmp(arg, "--sprites") == 0 && value) {
+            counts[MAP_ENTITY_SPRITE] = atoi(value);
+        } else if (strcmp(arg, "--enemies") == 0 && value) {
+            counts[MAP_ENTITY_ENEMY] = atoi(value);
+        } else if (strcmp(arg, "--pickups") == 0 && value) {
+            counts[MAP_ENTITY_PICKUP] = atoi(value);
+        } else {
+            takes_value = false;
+            if (strcmp(arg, "--binary") == 0) {
+                binary = true;
+            } else if (strcmp(arg, "--chunked") == 0) {
+                chunked = true;
+            } else if (arg[0] != '-' && !output) {
+                output = arg;
+            } else {
+                return usage(argv[0]);
+            }
+        }
+        i += takes_value;
+    }
+    if (!output || (binary && chunked)) {
+        return usage(argv[0]);
+    }
+    if (density < 0.0f) {
+        density = gen_default_density[type];
+    }
+
+    // The engine ignores entities beyond its capacity
+    static const int limits[MAP_ENTITY_KINDS] = { MAX_SPRITES, MAX_ENEMIES, MAX_PICKUPS };
+    for (int k = 0; k < MAP_ENTITY_KINDS; k++) {
+        if (counts[k] < 0) counts[k] = 0;
+        if (counts[k] > limits[k]) counts[k] = limits[k];
+    }
+
+    static Map map;
+    if (!map_set_size(&map, width, height) || !map_allocate(&map)) {
+        return 1;
+    }
+
+    Rng rng;
+    rng_seed(&rng, seed);
+    bool ok = true;
+    switch (type) {
+    case GEN_MAZE:      ok = gen_maze(&map, &rng, density); break;
+    case GEN_ARENA:     gen_arena(&map, &rng, density); break;
+    case GEN_PILLARS:   gen_pillars(&map, &rng, density); break;
+    default:            gen_corridors(&map, &rng, density); break;
+    }
+    ok = ok && gen_spawn(&map) && gen_entities(&map, &rng, counts);
+    if (!ok) {
+        map_free(&map);
+        return 1;
+    }
+    map_update(&map);
+
+    long long walls = 0;
+    for (int i = 0; i < map.tile_count; i++) {
+        walls += map.tiles[i] != 0;
+    }
+    char description[128];
+    snprintf(description, sizeof(description), "%s %dx%d, seed %llu, density %.3f",
+             gen_type_names[type], width, height, seed, density);
+
+    if (chunked) {
+        ok = map_stream_save(&map, output);
+    } else if (binary) {
+        ok = map_save_binary(&map, output);
+    } else {
+        ok = write_text_map(&map, output, description);
+    }
+    if (ok) {
+        printf("Wrote %s: %s, %.1f%% walls, %d sprites, %d enemies, %d pickups\n", output, description,
+               100.0 * walls / map.tile_count, map.entity_count[MAP_ENTITY_SPRITE],
+               map.entity_count[MAP_ENTITY_ENEMY], map.entity_count[MAP_ENTITY_PICKUP]);
+    }
+    map_free(&map);
+    return ok ? 0 : 1;
+}